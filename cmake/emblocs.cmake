@@ -21,6 +21,14 @@
 #   EMBLOCS_DIR - path to the root of the emblocs repository.
 #                 e.g. set(EMBLOCS_DIR ${CMAKE_CURRENT_SOURCE_DIR}/../../submodules/emblocs)
 #
+# Optional variables:
+#
+#   BLOCS_OPTIONS - extra options for blocs_compiler.py.
+#                 e.g. set(BLOCS_OPTIONS --fold --loops)
+#
+# The system is compiled at build time, and needs CMake 3.20 or later
+# for its depfile.
+#
 # After including this file, the following variable is available:
 #
 #   EMBLOCS_INC - path to emblocs headers (src/emblocs/), already added to
@@ -30,30 +38,64 @@
 set(EMBLOCS_INC ${EMBLOCS_DIR}/src/emblocs)
 set(EMBLOCS_MISC ${EMBLOCS_DIR}/src/misc)
 
-# Re-run configure if the system definition or config file changes
-set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS
-    ${CMAKE_CURRENT_SOURCE_DIR}/${BLOCS_FILE}.blocs
-    ${CMAKE_CURRENT_SOURCE_DIR}/emblocs.json
+set(BLOCS_SOURCE ${CMAKE_CURRENT_SOURCE_DIR}/${BLOCS_FILE}.blocs)
+set(BLOCS_STAMP ${CMAKE_BINARY_DIR}/${BLOCS_FILE}.stamp)
+set(BLOCS_COMMAND python
+    ${EMBLOCS_DIR}/python/blocs_compiler.py
+    ${BLOCS_SOURCE}
+    ${CMAKE_BINARY_DIR}
+    ${BLOCS_OPTIONS}
 )
 
-# Run blocs_compiler.py at configure time to generate variant source files
-execute_process(
-    COMMAND python
-        ${EMBLOCS_DIR}/python/blocs_compiler.py
-        ${CMAKE_CURRENT_SOURCE_DIR}/${BLOCS_FILE}.blocs
-        ${CMAKE_BINARY_DIR}
-    RESULT_VARIABLE BLOCS_COMP_RESULT
-    OUTPUT_VARIABLE BLOCS_COMP_OUTPUT
-    ERROR_VARIABLE BLOCS_COMP_OUTPUT
-)
-if(NOT BLOCS_COMP_RESULT EQUAL 0)
-    message(FATAL_ERROR "blocs_compiler.py failed:\n${BLOCS_COMP_OUTPUT}")
-else()
-    message(STATUS "${BLOCS_COMP_OUTPUT}")
+# The generated source list comes from blocs_compiler.py, so run it
+# once at configure time if there is none yet
+if(NOT EXISTS ${CMAKE_BINARY_DIR}/${BLOCS_FILE}.cmake)
+    execute_process(
+        COMMAND ${BLOCS_COMMAND}
+        RESULT_VARIABLE BLOCS_COMP_RESULT
+        OUTPUT_VARIABLE BLOCS_COMP_OUTPUT
+        ERROR_VARIABLE BLOCS_COMP_OUTPUT
+    )
+    if(NOT BLOCS_COMP_RESULT EQUAL 0)
+        message(FATAL_ERROR "blocs_compiler.py failed:\n${BLOCS_COMP_OUTPUT}")
+    else()
+        message(STATUS "${BLOCS_COMP_OUTPUT}")
+    endif()
 endif()
 
+# Re-run configure only if the generated source list changes
+set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS
+    ${CMAKE_BINARY_DIR}/${BLOCS_FILE}.cmake
+)
+
 # Include generated compile rules - adds generated source files to TARGET
+# and sets BLOCS_OUTPUTS
 include(${CMAKE_BINARY_DIR}/${BLOCS_FILE}.cmake)
+list(TRANSFORM BLOCS_OUTPUTS PREPEND ${CMAKE_BINARY_DIR}/)
+
+# Changing BLOCS_OPTIONS must re-run the system compiler; this file
+# is only rewritten when they change
+file(CONFIGURE OUTPUT ${CMAKE_BINARY_DIR}/${BLOCS_FILE}.options
+    CONTENT "${BLOCS_OPTIONS}\n")
+
+# Run blocs_compiler.py at build time, whenever the .blocs file or any
+# .bloc, .c or .h it read (listed in the depfile) changes.  It only
+# rewrites outputs whose content changed, so only those are rebuilt.
+file(GLOB BLOCS_COMPILER_SOURCES ${EMBLOCS_DIR}/python/*.py)
+add_custom_command(
+    OUTPUT ${BLOCS_STAMP}
+    BYPRODUCTS ${BLOCS_OUTPUTS}
+    COMMAND ${BLOCS_COMMAND} --depfile
+    DEPENDS
+        ${BLOCS_SOURCE}
+        ${CMAKE_BINARY_DIR}/${BLOCS_FILE}.options
+        ${BLOCS_COMPILER_SOURCES}
+    DEPFILE ${CMAKE_BINARY_DIR}/${BLOCS_FILE}.d
+    COMMENT "Compiling ${BLOCS_FILE}.blocs"
+    VERBATIM
+)
+add_custom_target(${BLOCS_FILE}_blocs DEPENDS ${BLOCS_STAMP})
+add_dependencies(${TARGET} ${BLOCS_FILE}_blocs)
 
 # Add generated headers and emblocs headers to the include path
 target_include_directories(${TARGET} PRIVATE
@@ -72,4 +114,6 @@ target_compile_definitions(${TARGET} PRIVATE
 # Add core libraries
 target_sources(${TARGET} PRIVATE
     ${EMBLOCS_MISC}/bundle.c
+    ${EMBLOCS_MISC}/mailbox.c
+    ${EMBLOCS_INC}/emblocs_profile.c
 )
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+# bench_parser.py
+# Measures how fast the .blocs and .bloc parsers are on large designs.
+#
+# Usage: bench_parser.py [--sizes 1000,10000,100000] [--memory] [--profile N]
+#
+# Synthetic sources are generated for each size, counted in statements
+# (logical lines of a .blocs file, statements of a .bloc file):
+#
+#   .blocs  chains of integrator, limit1 and mux blocks from
+#           src/components, each with its signals, pin values and
+#           thread links, so that lookups, links and array pins are all
+#           exercised
+#   .bloc   one block with that many params, array pins, vars and
+#           functions, most with descriptions, some continued over
+#           several lines, and some inside #if
+#
+# Only parsing is timed, after the text is in memory; the .bloc files
+# that the .blocs design uses are parsed and resolved once, up front.
+# --memory repeats each run under tracemalloc and reports the peak per
+# statement, which should not grow with the size.  --profile N prints
+# the top N functions of a cProfile run of the largest size.
+
+from __future__ import annotations
+from pathlib import Path
+import argparse
+import cProfile
+import gc
+import io
+import pstats
+import sys
+import time
+import tracemalloc
+from contextlib import redirect_stderr
+
+from parse_common import ctx
+from blocs_parser import parse_blocs_string, set_get_block_spec, set_expand_path
+from bloc_parser import parse_bloc_file, parse_bloc_string
+from emblocs import Design, BlockSpec
+
+EMBLOCS_ROOT = Path(__file__).parent.parent
+COMPONENTS_DIR = EMBLOCS_ROOT / "src" / "components"
+
+BLOCS_HEADER = (
+    "# synthetic design for bench_parser.py\n"
+    "search $EMBLOCS/src/components\n"
+    "blockdef integ integrator HAS_ENABLE=1\n"
+    "blockdef lim limit1\n"
+    "blockdef mux44 mux NUM_CHAN=4 NUM_INPUT=4\n"
+    "thread fast 1000000\n"
+    "thread slow 10000000\n"
+    "signal sel u32 =1\n"
+    "signal t0 float\n"
+)
+BLOCS_HEADER_STATEMENTS = 8
+# statements in each unit of synth_blocs()
+BLOCS_UNIT = 12
+# statements in each unit of synth_bloc()
+BLOC_UNIT = 8
+
+
+def synth_blocs(statements: int) -> str:
+    """ A .blocs design with about 'statements' logical lines """
+    parts = [BLOCS_HEADER]
+    for k in range(1, max(statements - BLOCS_HEADER_STATEMENTS, 0) // BLOCS_UNIT + 1):
+        parts.append(
+            f"block i{k} integ\n"
+            f"block l{k} lim\n"
+            f"block m{k} mux44\n"
+            f"signal s{k} float +i{k}.out +l{k}.in\n"
+            f"signal t{k} float +l{k}.out \\\n"
+            f"    +m{k}.ch01_in1   # continued\n"
+            f"l{k}.min =-1.5\n"
+            f"l{k}.max =2.5e0\n"
+            f"i{k}.in +t{k - 1}\n"
+            f"i{k}.enable =true\n"
+            f"m{k}.select +sel\n"
+            f"i{k}.update +fast\n"
+            f"m{k}.update +slow\n")
+    return "".join(parts)
+
+
+def synth_bloc(statements: int) -> str:
+    """ A .bloc file with about 'statements' statements """
+    parts = [
+        "/// Synthetic block for bench_parser.py.\n"
+        "/// It has a great many pins.\n"
+        "param u32 N default=8 min=1 max=64  /// size of the arrays\n"
+        "param bool EXTRA default=1  /// if true, export the extra pins\n"
+    ]
+    units = max(statements - 2, 0) // BLOC_UNIT
+    # every param has to come before anything else
+    for k in range(units):
+        parts.append(f"param u32 P{k} default={k} min=0 max=1000000  /// parameter {k}\n")
+    for k in range(units):
+        parts.append(
+            f"function f{k}  on_change  /// function {k}\n"
+            f"                          /// which does very little\n"
+            f"pin float input  a{k}_{{i:2}}[i=N]  /// input array {k}\n"
+            f"pin float output b{k}              /// output {k}\n"
+            f"#if EXTRA\n"
+            f"pin bool  input  c{k}_{{i:1}}[i=4]  if (P{k}>>i)&1  /// extra input {k}\n"
+            f"#endif\n"
+            f"var uint32_t v{k}[4];  // state {k}\n"
+        )
+    return "".join(parts)
+
+
+def _blockspec_getter():
+    specs: dict[str, BlockSpec | None] = {}
+    def get(name: str, design: Design) -> BlockSpec | None:
+        if name not in specs:
+            specs[name] = parse_bloc_file((COMPONENTS_DIR / f"{name}.bloc").as_posix())
+        spec = specs[name]
+        if spec is not None:
+            design.add_block_spec(spec)
+        return spec
+    return get
+
+
+def _expand(raw: str) -> Path:
+    return EMBLOCS_ROOT / raw.removeprefix("$EMBLOCS/")
+
+
+def parse_blocs_text(text: str) -> Design:
+    design = Design(abs_path="/bench/synthetic.blocs")
+    assert parse_blocs_string(text, design, source="synthetic.blocs"), "parse failed"
+    return design
+
+
+def parse_bloc_text(text: str) -> BlockSpec:
+    spec = parse_bloc_string(text, source="synthetic.bloc")
+    assert spec is not None, "parse failed"
+    return spec
+
+
+def _timed(func, text: str, memory: bool) -> tuple[float, int]:
+    # best of three, since the smaller sizes are noisy
+    best = None
+    for _ in range(3 if len(text) < 1_000_000 else 1):
+        gc.collect()
+        start = time.perf_counter()
+        result = func(text)
+        elapsed = time.perf_counter() - start
+        del result
+        best = elapsed if best is None else min(best, elapsed)
+    peak = 0
+    if memory:
+        gc.collect()
+        tracemalloc.start()
+        result = func(text)
+        peak = tracemalloc.get_traced_memory()[1]
+        tracemalloc.stop()
+        del result
+    return best, peak
+
+
+def main(args=None) -> int:
+    parser = argparse.ArgumentParser(description="EMBLOCS parser benchmark")
+    parser.add_argument('--sizes', default="1000,10000,100000",
+                        help="comma separated list of statement counts")
+    parser.add_argument('--memory', action='store_true',
+                        help="also measure the peak memory of each parse")
+    parser.add_argument('--profile', type=int, default=0, metavar='N',
+                        help="print the top N functions of a profile of the largest size")
+    parsed_args = parser.parse_args(args)
+    sizes = [int(size) for size in parsed_args.sizes.split(",")]
+    ctx.push(source="bench_parser.py")
+    set_get_block_spec(_blockspec_getter())
+    set_expand_path(_expand)
+    cases = (("blocs", synth_blocs, parse_blocs_text), ("bloc", synth_bloc, parse_bloc_text))
+    print(f"{'file':6} {'statements':>10} {'lines':>8} {'seconds':>9} {'stmt/s':>9}"
+          + (f" {'peak MB':>8} {'B/stmt':>7}" if parsed_args.memory else ""))
+    # the parsers report infos about defaults; only the timing is wanted
+    with redirect_stderr(io.StringIO()):
+        for kind, synth, parse in cases:
+            for size in sizes:
+                text = synth(size)
+                seconds, peak = _timed(parse, text, parsed_args.memory)
+                line = (f"{kind:6} {size:10} {text.count(chr(10)):8} "
+                        f"{seconds:9.3f} {size / seconds:9.0f}")
+                if parsed_args.memory:
+                    line += f" {peak / 1e6:8.1f} {peak / size:7.0f}"
+                print(line, file=sys.stdout)
+    if parsed_args.profile:
+        for kind, synth, parse in cases:
+            text = synth(max(sizes))
+            profiler = cProfile.Profile()
+            with redirect_stderr(io.StringIO()):
+                profiler.runcall(parse, text)
+            print(f"\n{kind}, {max(sizes)} statements:")
+            pstats.Stats(profiler).sort_stats("tottime").print_stats(parsed_args.profile)
+    ctx.pop()
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
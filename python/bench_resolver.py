@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+# bench_resolver.py
+# Measures how fast the resolver expands the blocks of the component
+# library.
+#
+# Usage: bench_resolver.py [--components DIR] [--repeat N] [--profile N]
+#
+# Every .bloc file in the component library (src/components by default)
+# is parsed once, then resolved with every combination of a few values
+# of each of its parameters:
+#
+#   bool           0 and 1
+#   u32 with range min, the middle of the range, and max
+#   u32 without    0, the default, 0x55555555 and 0xFFFFFFFF (the u32
+#                  params without a range are bit masks)
+#
+# so that conditional pins, array sizes, export conditions and name
+# templates are all exercised, including the largest arrays the
+# library allows.  Each block is timed twice: 'cold' starts with empty
+# expression and template caches, as a compiler run does; 'warm'
+# resolves every variant again with the caches full.
+#
+# Variants that resolve with errors (a mask selecting pins the block
+# doesn't have, for instance) are counted but not reported.
+
+from __future__ import annotations
+from pathlib import Path
+import argparse
+import cProfile
+import gc
+import io
+import itertools
+import pstats
+import sys
+import time
+from contextlib import redirect_stderr
+
+from parse_common import ctx
+from bloc_parser import parse_bloc_file
+from bloc_resolver import resolve, _compile_template
+from emblocs import BlockSpec, ParamSpec
+from expressions import compile_expression
+
+EMBLOCS_ROOT = Path(__file__).parent.parent
+COMPONENTS_DIR = EMBLOCS_ROOT / "src" / "components"
+
+U32_MAX = 0xFFFFFFFF
+
+
+def param_values(param: ParamSpec) -> list[int]:
+    """ The values of 'param' that the benchmark resolves with """
+    if param.param_type == "bool":
+        values = [0, 1]
+    elif param.min_val == 0 and param.max_val == U32_MAX:
+        values = [0, param.default, 0x55555555, U32_MAX]
+    else:
+        values = [param.min_val, (param.min_val + param.max_val) // 2, param.max_val]
+    return list(dict.fromkeys(values))
+
+
+def variants(spec: BlockSpec) -> list[dict[str, int]]:
+    """ Every combination of the values of the params of 'spec' """
+    names = [param.name for param in spec.params]
+    choices = [param_values(param) for param in spec.params]
+    return [dict(zip(names, combo)) for combo in itertools.product(*choices)]
+
+
+def resolve_all(spec: BlockSpec, params_list: list[dict[str, int]]) -> tuple[int, int]:
+    """ Resolve every variant; returns (pins produced, variants that failed) """
+    pins = failed = 0
+    for k, params in enumerate(params_list):
+        ctx.push(source=spec.abs_path)
+        block_def = resolve(spec, f"v{k}", spec.name, params)
+        ctx.pop()
+        if block_def is None:
+            failed += 1
+        else:
+            pins += len(block_def.pins)
+    return pins, failed
+
+
+def _timed(spec: BlockSpec, params_list: list[dict[str, int]], cold: bool) -> float:
+    gc.collect()
+    if cold:
+        compile_expression.cache_clear()
+        _compile_template.cache_clear()
+    start = time.perf_counter()
+    resolve_all(spec, params_list)
+    return time.perf_counter() - start
+
+
+def main(args=None) -> int:
+    parser = argparse.ArgumentParser(description="EMBLOCS resolver benchmark")
+    parser.add_argument('--components', default=COMPONENTS_DIR.as_posix(),
+                        help="directory of .bloc files to resolve")
+    parser.add_argument('--repeat', type=int, default=3,
+                        help="times to time each block; the best is reported")
+    parser.add_argument('--profile', type=int, default=0, metavar='N',
+                        help="print the top N functions of a profile of all the blocks")
+    parsed_args = parser.parse_args(args)
+    ctx.push(source="bench_resolver.py")
+    cases = []
+    # the parser and resolver report infos about defaults; only the timing is wanted
+    with redirect_stderr(io.StringIO()):
+        for bloc_path in sorted(Path(parsed_args.components).glob("*.bloc")):
+            spec = parse_bloc_file(bloc_path.as_posix())
+            if spec is not None:
+                cases.append((spec, variants(spec)))
+    print(f"{'block':12} {'variants':>8} {'failed':>6} {'pins':>7} "
+          f"{'cold ms':>8} {'warm ms':>8} {'pins/s':>9}")
+    totals = [0, 0, 0, 0.0, 0.0]
+    with redirect_stderr(io.StringIO()):
+        for spec, params_list in cases:
+            pins, failed = resolve_all(spec, params_list)
+            cold = min(_timed(spec, params_list, True) for _ in range(parsed_args.repeat))
+            warm = min(_timed(spec, params_list, False) for _ in range(parsed_args.repeat))
+            print(f"{spec.name:12} {len(params_list):8} {failed:6} {pins:7} "
+                  f"{cold * 1e3:8.1f} {warm * 1e3:8.1f} {pins / warm:9.0f}",
+                  file=sys.stdout)
+            for i, value in enumerate((len(params_list), failed, pins, cold, warm)):
+                totals[i] += value
+    variant_count, failed, pins, cold, warm = totals
+    print(f"{'total':12} {variant_count:8} {failed:6} {pins:7} "
+          f"{cold * 1e3:8.1f} {warm * 1e3:8.1f} {pins / warm:9.0f}")
+    if parsed_args.profile:
+        profiler = cProfile.Profile()
+        with redirect_stderr(io.StringIO()):
+            for spec, params_list in cases:
+                profiler.runcall(resolve_all, spec, params_list)
+        print()
+        pstats.Stats(profiler).sort_stats("tottime").print_stats(parsed_args.profile)
+    ctx.pop()
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,429 @@
+#!/usr/bin/env python3
+# bench_scale.py
+# Measures the whole toolchain on synthetic systems of growing size.
+#
+# Usage: bench_scale.py [--sizes 100,300,1000] [--signals R] [--fanout F]
+#                       [--threads T] [--mix "integrator HAS_ENABLE=1;..."]
+#                       [--options "--fold --loops"] [--seed N] [--repeat N]
+#                       [--cc CMD] [--cflags FLAGS] [--host-cc CMD]
+#                       [--size-cmd CMD] [--ticks N] [--timeout SECONDS]
+#                       [--json FILE] [--compare FILE] [--tolerance PERCENT]
+#                       [--keep DIR]
+#
+# For each size, counted in blocks, a .blocs design is generated:
+#
+#   blocks    taken in turn from the variant mix, a ';' separated list
+#             of blockdef tails from src/components (a variant may be
+#             listed more than once to weight it)
+#   signals   R per block, each driven by an output and read by up to
+#             F inputs of the same type (or raw) of blocks further down
+#             the list, so that the design has no loops
+#   threads   T threads, of 1 ms, 2 ms, 4 ms ..., each running the
+#             functions of a contiguous run of the blocks
+#
+# The connections are random, from --seed, so every run of the same
+# knobs generates the same design.  Each design is then put through the
+# stages a build goes through, and each stage is timed or measured:
+#
+#   compile   wall time of blocs_compiler.py, with --no-cache and the
+#             --options given, best of --repeat
+#   code      text, data and bss of the generated .c files, compiled
+#             with --cc --cflags (-Os) and summed by --size-cmd;
+#             the core needs 32-bit pointers, so the default is gcc -m32,
+#             and a cross compiler gives the sizes for the target
+#   tick      host time of one call of <system>_tick(), the average of
+#             --ticks calls, linked with --host-cc -O2 (gcc -m32, which
+#             needs the 32-bit C library)
+#
+# A stage whose tools are missing, fail or take longer than --timeout
+# is recorded as skipped, with the reason, and the rest go on.  GCC's
+# time at -Os grows much faster than the length of the thread
+# functions: with gcc 12, 20 s for 1000 blocks, most of it in code
+# hoisting, and more than five minutes for 3000, so past a thousand or
+# so blocks the C stages need a long --timeout, or --cflags -O1.
+#
+# The results are printed as a table and, with --json, written as
+# JSON; --compare reads an earlier JSON file and lists every number
+# that is more than --tolerance percent worse for the same size, and
+# exits with 1 if there are any.
+
+from __future__ import annotations
+from pathlib import Path
+from concurrent.futures import ThreadPoolExecutor
+import argparse
+import io
+import json
+import os
+import platform
+import random
+import shlex
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+from contextlib import redirect_stderr
+
+from parse_common import ctx
+from bloc_parser import parse_bloc_file
+from bloc_resolver import resolve
+from emblocs import BlockDef, PinDir, PinType
+
+EMBLOCS_ROOT = Path(__file__).parent.parent
+COMPONENTS_DIR = EMBLOCS_ROOT / "src" / "components"
+COMPILER = Path(__file__).parent / "blocs_compiler.py"
+
+# the portable components; the gpio blocks need their targets' headers
+DEFAULT_MIX = "integrator HAS_ENABLE=1;limit1;mux NUM_CHAN=4 NUM_INPUT=4;not"
+BASE_PERIOD_NS = 1_000_000
+# readers are picked from the blocks up to this far down the list
+READER_WINDOW = 64
+
+SIGNAL_TYPE_NAMES = {PinType.BOOL: "bool", PinType.U32: "u32",
+                     PinType.S32: "s32", PinType.FLOAT: "float"}
+
+# the numbers --compare looks at; all of them are worse when larger
+METRICS = ("compile_s", "text", "data", "bss", "tick_ns")
+
+HOST_MAIN = """\
+// Generated by bench_scale.py - calls {stem}_tick() and times it.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "{stem}.h"
+
+int main(int argc, char **argv)
+{{
+    long ticks = argc > 1 ? atol(argv[1]) : 1000;
+    struct timespec start, end;
+    double ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for ( long n = 0 ; n < ticks ; n++ ) {{
+        {stem}_tick();
+    }}
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("%.1f\\n", ns / ticks);
+    return 0;
+}}
+"""
+
+
+def parse_mix(mix: str) -> list[tuple[str, dict[str, int]]]:
+    """ The (bloc name, params) of each entry of a --mix string """
+    entries = []
+    for entry in mix.split(";"):
+        words = entry.split()
+        if words:
+            params = dict(word.split("=", 1) for word in words[1:])
+            entries.append((words[0], {name: int(value, 0) for name, value in params.items()}))
+    return entries
+
+
+def resolve_mix(entries: list[tuple[str, dict[str, int]]]) -> list[BlockDef]:
+    """ The BlockDef of each entry of the mix; raises ValueError if one fails """
+    block_defs = []
+    with redirect_stderr(io.StringIO()):
+        for k, (bloc_name, params) in enumerate(entries):
+            path = COMPONENTS_DIR / f"{bloc_name}.bloc"
+            spec = parse_bloc_file(path.as_posix())
+            block_def = None
+            if spec is not None:
+                ctx.push(source=path.as_posix())
+                block_def = resolve(spec, f"v{k}", bloc_name, params)
+                ctx.pop()
+            if block_def is None:
+                raise ValueError(f"can't resolve '{bloc_name}' with {params} from {COMPONENTS_DIR}")
+            block_defs.append(block_def)
+    return block_defs
+
+
+def synth_design(blocks: int, entries: list[tuple[str, dict[str, int]]],
+                 block_defs: list[BlockDef], signals_per_block: float, fanout: int,
+                 threads: int, seed: int) -> tuple[str, dict[str, int]]:
+    """
+    A .blocs design of 'blocks' blocks, and the counts of what it holds:
+    blocks, signals, connections (signal to pin, driver included),
+    threads and function links
+    """
+    rng = random.Random(seed)
+    parts = [f"# synthetic design for bench_scale.py, {blocks} blocks\n"
+             f"search $EMBLOCS/src/components\n"]
+    for k, (bloc_name, params) in enumerate(entries):
+        values = "".join(f" {name}={value}" for name, value in params.items())
+        parts.append(f"blockdef v{k} {bloc_name}{values}\n")
+    for t in range(threads):
+        parts.append(f"thread t{t} {BASE_PERIOD_NS << t}\n")
+    kinds = [block_defs[k % len(block_defs)] for k in range(blocks)]
+    outputs = []
+    inputs = []
+    for k, block_def in enumerate(kinds):
+        parts.append(f"block b{k} v{k % len(block_defs)}\n")
+        outputs.extend((k, pin) for pin in block_def.pins.values()
+                       if pin.field.direction == PinDir.OUTPUT)
+        inputs.append([pin for pin in block_def.pins.values()
+                       if pin.field.direction == PinDir.INPUT])
+    # each signal is driven by a different output
+    wanted = min(round(blocks * signals_per_block), len(outputs))
+    drivers = sorted(rng.sample(range(len(outputs)), wanted))
+    connections = 0
+    for s, index in enumerate(drivers):
+        k, pin = outputs[index]
+        sig_type = pin.field.pin_type
+        if sig_type == PinType.RAW:
+            sig_type = PinType.FLOAT
+        readers = []
+        for _ in range(4 * fanout):
+            if len(readers) == fanout or k + 1 >= blocks:
+                break
+            j = rng.randint(k + 1, min(blocks - 1, k + READER_WINDOW))
+            free = [p for p in inputs[j] if p.field.pin_type in (sig_type, PinType.RAW)]
+            if free:
+                reader = free[rng.randrange(len(free))]
+                inputs[j].remove(reader)
+                readers.append(f" +b{j}.{reader.name}")
+        connections += 1 + len(readers)
+        parts.append(f"signal s{s} {SIGNAL_TYPE_NAMES[sig_type]} +b{k}.{pin.name}"
+                     f"{''.join(readers)}\n")
+    links = 0
+    for k, block_def in enumerate(kinds):
+        for funct_name in block_def.functions:
+            parts.append(f"b{k}.{funct_name} +t{k * threads // blocks}\n")
+            links += 1
+    counts = {"blocks": blocks, "signals": len(drivers), "connections": connections,
+              "threads": threads, "links": links}
+    return "".join(parts), counts
+
+
+def _run(cmd: list[str], timeout: float | None = None) -> tuple[bool, str]:
+    # (succeeded, output); a missing tool is a failure like any other.  The
+    # command runs in a session of its own, so that a timeout stops what
+    # it started too (cc1 under gcc)
+    try:
+        proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                text=True, start_new_session=True)
+    except OSError as e:
+        return False, str(e)
+    try:
+        output = proc.communicate(timeout=timeout)[0]
+    except subprocess.TimeoutExpired:
+        os.killpg(proc.pid, signal.SIGKILL)
+        proc.communicate()
+        return False, f"error: {Path(cmd[0]).name} timed out after {timeout:g} s"
+    return proc.returncode == 0, output
+
+
+def _reason(output: str) -> str:
+    # the first line that says what went wrong
+    lines = [line.strip() for line in output.splitlines() if line.strip()]
+    return next((line for line in lines if "error" in line.lower()), lines[0] if lines else "failed")
+
+
+def _include_dirs(build_dir: Path) -> list[str]:
+    return [f"-I{build_dir}", f"-I{EMBLOCS_ROOT / 'src' / 'emblocs'}",
+            f"-I{EMBLOCS_ROOT / 'src' / 'misc'}"]
+
+
+def stage_compile(design: Path, build_dir: Path, options: list[str],
+                  repeat: int) -> tuple[float | None, str]:
+    """ Best wall time of the system compiler, or None and why it failed """
+    cmd = [sys.executable, COMPILER.as_posix(), design.as_posix(), build_dir.as_posix(),
+           "--no-cache", *options]
+    best = None
+    for _ in range(repeat):
+        start = time.perf_counter()
+        ok, output = _run(cmd)
+        elapsed = time.perf_counter() - start
+        if not ok:
+            return None, _reason(output)
+        best = elapsed if best is None else min(best, elapsed)
+    return best, ""
+
+
+def stage_code(build_dir: Path, cc: list[str], cflags: list[str], size_cmd: list[str],
+               timeout: float) -> tuple[dict | None, str]:
+    """ Summed text, data and bss of the generated code, or None and why not """
+    sources = sorted(build_dir.glob("*.c"))
+    def compile_one(source: Path) -> tuple[bool, str]:
+        return _run([*cc, *cflags, "-w", "-ffreestanding", "-ffunction-sections",
+                     "-fdata-sections", *_include_dirs(build_dir), "-c", source.as_posix(),
+                     "-o", source.with_suffix(".o").as_posix()], timeout)
+    with ThreadPoolExecutor(os.cpu_count()) as pool:
+        results = list(pool.map(compile_one, sources))
+    for ok, output in results:
+        if not ok:
+            return None, _reason(output)
+    ok, output = _run([*size_cmd, *(source.with_suffix(".o").as_posix() for source in sources)])
+    if not ok:
+        return None, _reason(output)
+    code = {"text": 0, "data": 0, "bss": 0}
+    # Berkeley format: text data bss dec hex filename
+    for line in output.splitlines()[1:]:
+        fields = line.split()
+        if len(fields) >= 3 and all(f.isdigit() for f in fields[:3]):
+            for name, value in zip(("text", "data", "bss"), fields[:3]):
+                code[name] += int(value)
+    return code, ""
+
+
+def stage_tick(build_dir: Path, stem: str, host_cc: list[str], ticks: int,
+               timeout: float) -> tuple[float | None, str]:
+    """ Host nanoseconds per call of <stem>_tick(), or None and why not """
+    main_c = build_dir / "bench_scale_main.c"
+    main_c.write_text(HOST_MAIN.format(stem=stem))
+    exe = build_dir / "bench_scale_host"
+    sources = [source.as_posix() for source in sorted(build_dir.glob("*.c"))]
+    ok, output = _run([*host_cc, "-O2", "-w", *_include_dirs(build_dir), *sources,
+                       "-o", exe.as_posix()], timeout)
+    main_c.unlink()
+    if not ok:
+        return None, _reason(output)
+    # the first run warms the caches
+    _run([exe.as_posix(), str(max(ticks // 10, 1))], timeout)
+    ok, output = _run([exe.as_posix(), str(ticks)], timeout)
+    if not ok:
+        return None, _reason(output)
+    return float(output.split()[0]), ""
+
+
+def measure(size: int, work_dir: Path, entries, block_defs, parsed_args) -> dict:
+    """ Generate the design of 'size' blocks and put it through every stage """
+    text, counts = synth_design(size, entries, block_defs, parsed_args.signals,
+                                parsed_args.fanout, parsed_args.threads, parsed_args.seed)
+    stem = f"scale{size}"
+    design = work_dir / f"{stem}.blocs"
+    design.write_text(text)
+    build_dir = work_dir / stem
+    build_dir.mkdir(exist_ok=True)
+    result = {**counts, "lines": text.count("\n"), "compile_s": None,
+              "text": None, "data": None, "bss": None, "tick_ns": None, "skipped": {}}
+    result["compile_s"], why = stage_compile(design, build_dir, shlex.split(parsed_args.options),
+                                             parsed_args.repeat)
+    if result["compile_s"] is None:
+        result["skipped"] = {"compile": why, "code": "no compiled system",
+                             "tick": "no compiled system"}
+        return result
+    code, why = stage_code(build_dir, shlex.split(parsed_args.cc), shlex.split(parsed_args.cflags),
+                           shlex.split(parsed_args.size_cmd), parsed_args.timeout)
+    if code is None:
+        result["skipped"]["code"] = why
+    else:
+        result.update(code)
+    result["tick_ns"], why = stage_tick(build_dir, stem, shlex.split(parsed_args.host_cc),
+                                        parsed_args.ticks, parsed_args.timeout)
+    if result["tick_ns"] is None:
+        result["skipped"]["tick"] = why
+    return result
+
+
+def compare(results: list[dict], old: dict, tolerance: float) -> list[str]:
+    """ A line for every number that is more than 'tolerance' percent worse than in 'old' """
+    old_results = {r["blocks"]: r for r in old.get("results", [])}
+    worse = []
+    for result in results:
+        before = old_results.get(result["blocks"])
+        if before is None:
+            continue
+        for metric in METRICS:
+            now, then = result.get(metric), before.get(metric)
+            if now is not None and then and now > then * (1 + tolerance / 100):
+                worse.append(f"{result['blocks']} blocks: {metric} {then} -> {now}"
+                             f" ({100 * (now - then) / then:+.1f}%)")
+    return worse
+
+
+def _cell(value, fmt: str, width: int) -> str:
+    return f"{'-':>{width}}" if value is None else f"{value:{width}{fmt}}"
+
+
+def main(args=None) -> int:
+    parser = argparse.ArgumentParser(description="EMBLOCS toolchain scale benchmark")
+    parser.add_argument('--sizes', default="100,300,1000",
+                        help="comma separated list of block counts")
+    parser.add_argument('--signals', type=float, default=1.0, metavar='R',
+                        help="signals per block")
+    parser.add_argument('--fanout', type=int, default=2, metavar='F',
+                        help="inputs each signal drives")
+    parser.add_argument('--threads', type=int, default=2, metavar='T',
+                        help="number of threads")
+    parser.add_argument('--mix', default=DEFAULT_MIX,
+                        help="';' separated blockdefs from src/components, used in turn")
+    parser.add_argument('--options', default="",
+                        help="extra options for blocs_compiler.py, e.g. '--fold --loops'")
+    parser.add_argument('--seed', type=int, default=1,
+                        help="seed for the random connections")
+    parser.add_argument('--repeat', type=int, default=3,
+                        help="times to run the system compiler; the best is reported")
+    parser.add_argument('--cc', default="gcc -m32",
+                        help="C compiler for the code sizes")
+    parser.add_argument('--cflags', default="-Os",
+                        help="optimisation flags for the code sizes")
+    parser.add_argument('--host-cc', default="gcc -m32",
+                        help="C compiler for the host tick timing")
+    parser.add_argument('--size-cmd', default="size",
+                        help="size tool for the objects --cc makes")
+    parser.add_argument('--ticks', type=int, default=10000,
+                        help="calls of the tick function to time")
+    parser.add_argument('--timeout', type=float, default=300.0, metavar='SECONDS',
+                        help="longest a C compiler or the host run may take")
+    parser.add_argument('--json', metavar='FILE',
+                        help="write the results to FILE as JSON")
+    parser.add_argument('--compare', metavar='FILE',
+                        help="compare with the JSON results of an earlier run")
+    parser.add_argument('--tolerance', type=float, default=10.0, metavar='PERCENT',
+                        help="how much worse a number may get before --compare lists it")
+    parser.add_argument('--keep', metavar='DIR',
+                        help="generate into DIR and keep the designs and builds")
+    parsed_args = parser.parse_args(args)
+    sizes = [int(size) for size in parsed_args.sizes.split(",")]
+    ctx.push(source="bench_scale.py")
+    entries = parse_mix(parsed_args.mix)
+    try:
+        block_defs = resolve_mix(entries)
+    except ValueError as e:
+        print(f"bench_scale.py: error: {e}", file=sys.stderr)
+        return 1
+    print(f"{'blocks':>7} {'signals':>7} {'conns':>7} {'lines':>7} {'compile s':>9} "
+          f"{'text':>8} {'data':>7} {'bss':>7} {'tick ns':>9}")
+    results = []
+    with tempfile.TemporaryDirectory(prefix="bench_scale_") as tmp:
+        work_dir = Path(parsed_args.keep or tmp)
+        work_dir.mkdir(parents=True, exist_ok=True)
+        for size in sizes:
+            r = measure(size, work_dir, entries, block_defs, parsed_args)
+            results.append(r)
+            print(f"{r['blocks']:7} {r['signals']:7} {r['connections']:7} {r['lines']:7} "
+                  f"{_cell(r['compile_s'], '.2f', 9)} {_cell(r['text'], 'd', 8)} "
+                  f"{_cell(r['data'], 'd', 7)} {_cell(r['bss'], 'd', 7)} "
+                  f"{_cell(r['tick_ns'], '.1f', 9)}", file=sys.stdout)
+    skipped = {f"{stage}: {why}" for r in results for stage, why in r["skipped"].items()}
+    for line in sorted(skipped):
+        print(f"skipped {line}")
+    report = {
+        "benchmark": "bench_scale",
+        "config": {"mix": parsed_args.mix, "signals": parsed_args.signals,
+                   "fanout": parsed_args.fanout, "threads": parsed_args.threads,
+                   "options": parsed_args.options, "seed": parsed_args.seed,
+                   "cc": parsed_args.cc, "cflags": parsed_args.cflags, "host_cc": parsed_args.host_cc,
+                   "ticks": parsed_args.ticks, "python": platform.python_version(),
+                   "machine": platform.machine()},
+        "results": results,
+    }
+    if parsed_args.json:
+        Path(parsed_args.json).write_text(json.dumps(report, indent=2) + "\n")
+    status = 0
+    if parsed_args.compare:
+        worse = compare(results, json.loads(Path(parsed_args.compare).read_text()),
+                        parsed_args.tolerance)
+        print()
+        print(f"{len(worse)} number(s) more than {parsed_args.tolerance:g}% worse"
+              f" than {parsed_args.compare}")
+        for line in worse:
+            print(f"  {line}")
+        status = 1 if worse else 0
+    ctx.pop()
+    return status
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,301 @@
+# bloc_cache.py
+# A persistent cache of parsed BlockSpecs and resolved BlockDefs.
+#
+# Every run of the system compiler parses the .bloc file of each block
+# it uses, and resolves it once for every blockdef; a design with dozens
+# of variants spends most of its time doing that, getting the same
+# results as last time.  The cache keeps those results in the build
+# directory, one pickle per entry, named by a hash of everything that
+# went into them:
+#
+#   BlockSpec  the compiler version, the .bloc file's path and contents
+#   BlockDef   the key of its BlockSpec, the variant name, the name the
+#              blockdef command gave the .bloc, and the parameter values
+#
+# The compiler version is a hash of the source of the modules that do
+# the parsing and resolving, so editing any of them starts a new cache
+# rather than reusing results the new code might not produce.  Stale
+# entries are never removed; deleting the directory is always safe.
+#
+# Only results whose parse or resolve reported nothing at all are kept,
+# so that a warning or info is reported again on every run rather than
+# only on the first one.
+#
+# Before the .blocs file is parsed, prefetch() scans it for its search
+# and blockdef commands, and parses and resolves whatever the cache is
+# missing, in parallel worker processes.  The scan is only a guess at
+# what the parser will do; anything it gets wrong, or that fails in a
+# worker, is simply not in the cache, and the parser handles it the
+# usual way, reporting any errors in context.
+
+from __future__ import annotations
+from concurrent.futures import ProcessPoolExecutor
+from collections.abc import Callable
+from contextlib import redirect_stderr
+from dataclasses import dataclass, field
+from pathlib import Path
+import hashlib
+import io
+import os
+import pickle
+
+from emblocs import BlockSpec, BlockDef
+from bloc_parser import parse_bloc_file
+from bloc_resolver import resolve
+from blocs_parser import lex_lines
+from parse_common import ctx, read_source_file
+
+
+CACHE_DIR_NAME = ".blocs_cache"
+
+# the modules whose source determines what is cached
+VERSION_SOURCES = (
+    "bloc_cache.py", "bloc_parser.py", "bloc_resolver.py",
+    "emblocs.py", "expressions.py", "parse_common.py",
+)
+
+_version: str | None = None
+
+def compiler_version() -> str:
+    """ A hash of the source of the modules that parse and resolve .bloc files """
+    global _version
+    if _version is None:
+        h = hashlib.blake2s(digest_size=16)
+        for name in VERSION_SOURCES:
+            h.update((Path(__file__).parent / name).read_bytes())
+        _version = h.hexdigest()
+    return _version
+
+
+def _digest(*parts: str | bytes) -> str:
+    h = hashlib.blake2s(digest_size=16)
+    for part in parts:
+        h.update(part.encode("utf-8") if isinstance(part, str) else part)
+        h.update(b"\0")
+    return h.hexdigest()
+
+
+@dataclass
+class VariantCache:
+    """
+    The cache directory, and what was found in it on this run.
+
+    Fields:
+        directory -- where the entries are kept
+        hits      -- BlockDefs that came from the cache
+        misses    -- BlockDefs that had to be resolved
+        resolved  -- misses that were resolved by prefetch()
+        workers   -- worker processes prefetch() used, 0 if none
+    """
+    directory: Path
+    hits:      int = 0
+    misses:    int = 0
+    resolved:  int = 0
+    workers:   int = 0
+    _spec_keys: dict[str, str | None] = field(default_factory=dict, repr=False)
+
+    def spec_key(self, bloc_path: str | Path) -> str | None:
+        """ The key of the BlockSpec parsed from 'bloc_path', or None if it can't be read """
+        abs_path = Path(bloc_path).resolve().as_posix()
+        if abs_path not in self._spec_keys:
+            try:
+                content = Path(abs_path).read_bytes()
+            except OSError:
+                key = None
+            else:
+                key = _digest(compiler_version(), abs_path, content)
+            self._spec_keys[abs_path] = key
+        return self._spec_keys[abs_path]
+
+    def def_key(self, spec: BlockSpec, variant: str, orig_path: str,
+                params: dict[str, int]) -> str | None:
+        """ The key of the BlockDef resolved from 'spec' with these arguments """
+        spec_key = self.spec_key(spec.abs_path)
+        if spec_key is None:
+            return None
+        param_text = ",".join(f"{name}={params[name]}" for name in sorted(params))
+        return _digest(spec_key, variant, orig_path, param_text)
+
+    def _path(self, key: str) -> Path:
+        return self.directory / f"{key}.pickle"
+
+    def contains(self, key: str | None) -> bool:
+        return key is not None and self._path(key).is_file()
+
+    def load(self, key: str | None) -> BlockSpec | BlockDef | None:
+        """ The entry stored under 'key', or None if there isn't a usable one """
+        if key is None:
+            return None
+        try:
+            with open(self._path(key), "rb") as f:
+                return pickle.load(f)
+        except (OSError, pickle.UnpicklingError, EOFError, AttributeError, ImportError):
+            return None
+
+    def store(self, key: str | None, entry: BlockSpec | BlockDef) -> None:
+        """
+        Store 'entry' under 'key'.  The file is written under a temporary
+        name and renamed, so that a reader never sees half of it.
+        """
+        if key is None:
+            return
+        try:
+            self.directory.mkdir(parents=True, exist_ok=True)
+            temp = self.directory / f"{key}.{os.getpid()}.tmp"
+            with open(temp, "wb") as f:
+                pickle.dump(entry, f, protocol=pickle.HIGHEST_PROTOCOL)
+            os.replace(temp, self._path(key))
+        except OSError:
+            # the cache is only an optimization
+            pass
+
+
+# ---------------------------------------------------------------------------
+# Parsing and resolving, quietly
+# ---------------------------------------------------------------------------
+
+def _quietly(func: Callable, *args):
+    # run func in a context frame of its own, with its reports
+    # discarded; returns its result only if it reported nothing
+    reports = io.StringIO()
+    ctx.push(source="<cache>")
+    try:
+        with redirect_stderr(reports):
+            result = func(*args)
+        clean = ctx.is_clean() and ctx.info_count == 0 and not reports.getvalue()
+    finally:
+        ctx.pop()
+    return result if clean else None
+
+
+def _parse_job(bloc_path: str) -> BlockSpec | None:
+    return _quietly(parse_bloc_file, bloc_path)
+
+
+def _resolve_job(spec: BlockSpec, variant: str, orig_path: str,
+                 params: dict[str, int]) -> BlockDef | None:
+    return _quietly(resolve, spec, variant, orig_path, params)
+
+
+# ---------------------------------------------------------------------------
+# Prefetching
+# ---------------------------------------------------------------------------
+
+@dataclass
+class VariantJob:
+    """
+    A blockdef command found by scan_blocs().
+
+    Fields:
+        bloc_path -- the .bloc file it would find on the search path
+        variant   -- the variant name
+        orig_path -- the .bloc name as given in the command
+        params    -- the parameter values it supplies
+    """
+    bloc_path: Path
+    variant:   str
+    orig_path: str
+    params:    dict[str, int]
+
+
+def scan_blocs(blocs_path: str, expand_path: Callable[[str], Path | None]) -> list[VariantJob]:
+    """
+    Find the blockdef commands in the .blocs file at 'blocs_path', and
+    the .bloc file each one would use, with the search paths set by the
+    search commands before it.  Commands that don't make sense are
+    skipped; the parser will report them.
+    """
+    jobs = []
+    search_paths: list[Path] = []
+    lines = read_source_file(blocs_path)
+    try:
+        for tokens in (lex_lines(lines) if lines is not None else []):
+            words = [tok.text for tok in tokens]
+            if words[0] == "search" and len(words) >= 2:
+                path = expand_path(words[1])
+                if path is not None and path.is_dir():
+                    search_paths.append(path)
+            elif words[0] == "blockdef" and len(words) >= 3:
+                params = {}
+                for word in words[3:]:
+                    name, sep, value = word.partition("=")
+                    if not sep:
+                        break
+                    try:
+                        params[name] = int(value, 0)
+                    except ValueError:
+                        break
+                bloc_path = next((d / f"{words[2]}.bloc" for d in search_paths
+                                  if (d / f"{words[2]}.bloc").is_file()), None)
+                if bloc_path is not None:
+                    jobs.append(VariantJob(bloc_path.resolve(), words[1], words[2], params))
+    finally:
+        ctx.pop()
+    return jobs
+
+
+class _Runner:
+    # runs jobs in worker processes, started the first time there are
+    # enough jobs to be worth it
+    def __init__(self, cache: VariantCache, workers: int):
+        self.cache = cache
+        self.workers = workers
+        self.pool: ProcessPoolExecutor | None = None
+
+    def map(self, func: Callable, *arg_lists) -> list:
+        count = len(arg_lists[0])
+        # starting processes costs more than a variant or two takes to resolve
+        if self.pool is None and self.workers > 1 and count > 2:
+            self.pool = ProcessPoolExecutor(max_workers=self.workers)
+        if self.pool is None:
+            return [func(*args) for args in zip(*arg_lists)]
+        self.cache.workers = max(self.cache.workers, min(self.workers, count))
+        return list(self.pool.map(func, *arg_lists))
+
+    def shutdown(self) -> None:
+        if self.pool is not None:
+            self.pool.shutdown()
+
+
+def prefetch(cache: VariantCache, blocs_path: str,
+             expand_path: Callable[[str], Path | None],
+             workers: int | None = None) -> None:
+    """
+    Parse and resolve every variant of the .blocs file at 'blocs_path'
+    that 'cache' doesn't have yet, with up to 'workers' processes (one
+    per CPU if None), and store the results.  Nothing is reported; the
+    parser reports whatever went wrong when it gets there.
+    """
+    with redirect_stderr(io.StringIO()):
+        jobs = scan_blocs(blocs_path, expand_path)
+    specs: dict[str, BlockSpec | None] = {}
+    for job in jobs:
+        path = job.bloc_path.as_posix()
+        if path not in specs:
+            specs[path] = cache.load(cache.spec_key(path))
+    runner = _Runner(cache, workers or os.cpu_count() or 1)
+    try:
+        to_parse = [path for path, spec in specs.items() if spec is None]
+        for path, spec in zip(to_parse, runner.map(_parse_job, to_parse)):
+            if spec is not None:
+                cache.store(cache.spec_key(path), spec)
+                specs[path] = spec
+        to_resolve = []
+        for job in jobs:
+            spec = specs[job.bloc_path.as_posix()]
+            if spec is None:
+                continue
+            key = cache.def_key(spec, job.variant, job.orig_path, job.params)
+            if key is not None and not cache.contains(key):
+                to_resolve.append((key, spec, job))
+        results = runner.map(_resolve_job,
+                             [spec for _key, spec, _job in to_resolve],
+                             [job.variant for _key, _spec, job in to_resolve],
+                             [job.orig_path for _key, _spec, job in to_resolve],
+                             [job.params for _key, _spec, job in to_resolve])
+        for (key, _spec, _job), block_def in zip(to_resolve, results):
+            if block_def is not None:
+                cache.store(key, block_def)
+                cache.resolved += 1
+    finally:
+        runner.shutdown()
@@ -8,6 +8,7 @@ import re
 import hashlib
 import base64
 from pathlib import Path
+from collections import ChainMap
 from dataclasses import dataclass, field
 from enum import Enum, auto
 from emblocs import (BlockSpec, ParamSpec, Statement, PinSpec,
@@ -15,7 +16,8 @@ from emblocs import (BlockSpec, ParamSpec, Statement, PinSpec,
 from expressions import evaluate, ExpressionError
 from parse_common import (Token, tokenize_line,
                           ctx, OMIT,
-                          read_source_file, read_source_string)
+                          read_source_file, read_source_string,
+                          collector_paused)
 
 # ---------------------------------------------------------------------------
 # Keyword tables
@@ -60,15 +62,19 @@ class ParseState:
         if_stack -- stack of #if condition expression strings currently
                     active; innermost condition is last in the list.
                     Empty outside any #if block.
+        params   -- names of the params declared so far, for finding
+                    duplicates without searching spec.params
     """
     section:  Section   = Section.HEADER
     if_stack: list[str] = field(default_factory=list)
+    params:   set[str]  = field(default_factory=set)
 
 # ---------------------------------------------------------------------------
 # Per-keyword parse functions
 # ---------------------------------------------------------------------------
 
-def parse_param(spec: BlockSpec, tokens: list[Token], description: str) -> None:
+def parse_param(spec: BlockSpec, state: ParseState,
+                tokens: list[Token], description: str) -> None:
     """
     Handle the 'param' declaration.
     Syntax: param <type> <NAME> default=<value> [min=<value>] [max=<value>]
@@ -95,7 +101,7 @@ def parse_param(spec: BlockSpec, tokens: list[Token], description: str) -> None:
                   token=name_tok)
         return
 
-    if any(p.name == name_tok.text for p in spec.params):
+    if name_tok.text in state.params:
         ctx.error(f"duplicate parameter name: {name_tok.text!r}",
                   token=name_tok)
         return
@@ -170,6 +176,7 @@ def parse_param(spec: BlockSpec, tokens: list[Token], description: str) -> None:
                   lineno=keyword.line, column=OMIT)
         return
 
+    state.params.add(name_tok.text)
     spec.params.append(ParamSpec(
         name        = name_tok.text,
         param_type  = param_type,
@@ -267,7 +274,10 @@ def parse_pin(spec: BlockSpec, tokens: list[Token], description: str) -> PinSpec
         return None
     # parse dimension specifiers, collecting index variables
     dims = []
-    template_vars = dict(spec.defaults)   # copy, grows as index vars are added
+    # params, and the index vars as they are added; the params are only
+    # looked through, not copied, since a block can have a great many
+    index_vars = {}
+    template_vars = ChainMap(index_vars, spec.defaults)
     for dim_string in dim_strings:
         if not dim_string.endswith(']'):
             ctx.error(f"missing closing ']' in dimension {dim_string!r}")
@@ -295,7 +305,7 @@ def parse_pin(spec: BlockSpec, tokens: list[Token], description: str) -> PinSpec
         if val < 1:
             ctx.error(f"invalid dimension: {val}; must be at least 1")
             return None
-        template_vars[index] = 0
+        index_vars[index] = 0
         dims.append(DimSpec(size_expr=expr, index_var=index))
 
     # derive field_name from template by replacing {expr:width} with 'width' zeros
@@ -409,17 +419,21 @@ def parse_var(spec: BlockSpec, tokens: list[Token], description: str) -> VarDef
 def parse_function(spec: BlockSpec, tokens: list[Token], description: str) -> FunctSpec | None:
     """
     Handle the 'function' declaration.
-    Syntax: function <name>  /// description
+    Syntax: function <name> [on_change] [cost[.<target>]=<expr> ...]  /// description
 
     Function names are always plain identifiers, never templates.
     dedup_name is name + '_', consistent with pin field names, so that
     a function and a pin with the same base name are detected as a collision.
+    The optional 'on_change' attribute lets the system compiler skip the
+    function when none of its input pins have changed since it last ran.
+    The optional 'cost' attributes give the cycles one call takes, on a
+    named target or on any other; they are expressions of the params.
     """
     keyword = tokens[0]
 
-    if len(tokens) != 2:
-        ctx.error("'function' declaration should be 'function <name>'",
-                  token=keyword)
+    if len(tokens) < 2:
+        ctx.error("'function' declaration should be "
+                  "'function <name> [on_change] [cost[.<target>]=<expr>]'", token=keyword)
         return None
 
     name_tok = tokens[1]
@@ -428,6 +442,34 @@ def parse_function(spec: BlockSpec, tokens: list[Token], description: str) -> Fu
         ctx.error(f"invalid function name: {name_tok.text!r}", token=name_tok)
         return None
 
+    on_change = False
+    costs = {}
+    for attr_tok in tokens[2:]:
+        if attr_tok.text == "on_change":
+            if on_change:
+                ctx.error("duplicate function attribute: 'on_change'", token=attr_tok)
+                return None
+            on_change = True
+            continue
+        key, sep, expr = attr_tok.text.partition('=')
+        target = key.removeprefix("cost.") if key.startswith("cost.") else ""
+        if not sep or not (key == "cost" or target.isidentifier()):
+            ctx.error(f"unknown function attribute: {attr_tok.text!r}", token=attr_tok)
+            return None
+        if target in costs:
+            ctx.error(f"duplicate function attribute: {key!r}", token=attr_tok)
+            return None
+        # validate the cost expression using the param defaults
+        try:
+            val = evaluate(expr, spec.defaults)
+        except ExpressionError as e:
+            ctx.error(f"invalid cost: {str(e)}", token=attr_tok)
+            return None
+        if val < 0:
+            ctx.error(f"invalid cost: {val}; must not be negative", token=attr_tok)
+            return None
+        costs[target] = expr
+
     dedup_name = name_tok.text + '_'
 
     if dedup_name in spec.namespace:
@@ -439,6 +481,8 @@ def parse_function(spec: BlockSpec, tokens: list[Token], description: str) -> Fu
         name        = name_tok.text,
         dedup_name  = dedup_name,
         description = description,
+        on_change   = on_change,
+        costs       = tuple(costs.items()),
     )
 
 
@@ -497,7 +541,7 @@ def parse_statement(spec: BlockSpec, state: ParseState,
 
     # Step 3: dispatch
     if keyword.text == "param":
-        parse_param(spec, tokens, description)
+        parse_param(spec, state, tokens, description)
     elif keyword.text == "include":
         parse_include(spec, tokens, description)
     elif keyword.text == "pin":
@@ -582,32 +626,33 @@ def parse_bloc(lines: list[str]) -> BlockSpec | None:
         pending_tokens      = []
         pending_description = ""
 
-    for lineno, line in enumerate(lines, start=1):
-        # split token section from comment/description
-        first_part, sep, last_part = line.partition("//")
-        new_tokens = tokenize_line(first_part, lineno)
-        # determine if last part is description or comment/nothing
-        if last_part.startswith("/"):
-            new_description = last_part[1:]
-        else:
-            new_description = ""
-        # apply language rules
-        if new_tokens:
-            # any previous statement is now complete
-            flush()
-            # begin new statement
-            pending_tokens = new_tokens
-            if not new_description:
-                # no description, can process immediately
+    with collector_paused():
+        for lineno, line in enumerate(lines, start=1):
+            # split token section from comment/description
+            first_part, sep, last_part = line.partition("//")
+            new_tokens = tokenize_line(first_part, lineno)
+            # determine if last part is description or comment/nothing
+            if last_part.startswith("/"):
+                new_description = last_part[1:]
+            else:
+                new_description = ""
+            # apply language rules
+            if new_tokens:
+                # any previous statement is now complete
                 flush()
+                # begin new statement
+                pending_tokens = new_tokens
+                if not new_description:
+                    # no description, can process immediately
+                    flush()
+                else:
+                    pending_description = new_description
             else:
-                pending_description = new_description
-        else:
-            # keep building description
-            pending_description += new_description
-            ctx.set(line=lineno)
-    # end of input
-    flush()
+                # keep building description
+                pending_description += new_description
+                ctx.set(line=lineno)
+        # end of input
+        flush()
     if not spec.description and ctx.no_errors():
         ctx.error("block description is required", lineno=OMIT)
     if state.if_stack:
@@ -6,6 +6,8 @@
 # concrete PinDef, VarDef, and FunctDef objects.
 
 from __future__ import annotations
+import functools
+import re
 import sys
 from emblocs import (
     BlockSpec, BlockDef,
@@ -16,7 +18,7 @@ from emblocs import (
     Statement,
     PinType, PinDir,
 )
-from expressions import evaluate, ExpressionError
+from expressions import compile_expression, ExpressionError
 from parse_common import ( ctx, OMIT)
 
 # ---------------------------------------------------------------------------
@@ -68,6 +70,9 @@ def _recurse_pin(pin_spec: PinSpec, dims: list[DimSpec],
 
      Returns a list of PinDef objects for all slots of the pin for which
      the export condition is true.
+
+     variables is updated in place as each index is stepped, rather than
+     copied for every slot; _expand_pin() gives each pin its own copy.
     """
     if not dims:
         # base case: no more dimensions, produce a PinDef
@@ -76,7 +81,7 @@ def _recurse_pin(pin_spec: PinSpec, dims: list[DimSpec],
             return []
         if pin_spec.export_condition is not None:
             try:
-                exported = evaluate(pin_spec.export_condition, variables)
+                exported = compile_expression(pin_spec.export_condition)(variables)
             except ExpressionError as e:
                 ctx.error(f"export condition error in pin "
                           f"{pin_spec.name_template!r}: {e}")
@@ -96,8 +101,8 @@ def _recurse_pin(pin_spec: PinSpec, dims: list[DimSpec],
         size = field.dims[dim_index]
         results = []
         for idx in range(size):
-            slot_vars = {**variables, dim.index_var: idx}
-            results.extend(_recurse_pin(pin_spec, dims[1:], slot_vars, field))
+            variables[dim.index_var] = idx
+            results.extend(_recurse_pin(pin_spec, dims[1:], variables, field))
         return results
 
 
@@ -114,7 +119,7 @@ def _expand_pin(pin_spec: PinSpec,
     dims = []
     for d in pin_spec.dims:
         try:
-            dims.append(evaluate(d.size_expr, variables))
+            dims.append(compile_expression(d.size_expr)(variables))
         except ExpressionError as e:
             ctx.error(f"dimension size error in pin {pin_spec.name_template!r}: {e}")
             return None, []
@@ -125,7 +130,7 @@ def _expand_pin(pin_spec: PinSpec,
         direction = pin_spec.direction,
         c_decl    = None,
     )
-    return field, _recurse_pin(pin_spec, pin_spec.dims, variables, field)
+    return field, _recurse_pin(pin_spec, pin_spec.dims, dict(variables), field)
 
 
 def _expand_var(var_def: VarDef,
@@ -147,12 +152,25 @@ def _expand_var(var_def: VarDef,
 def _expand_funct(funct_spec: FunctSpec,
                   variables: dict[str, int]) -> tuple[None, list[FunctDef]]:
     """
-    Convert a FunctSpec to a FunctDef.
-    Variables dict is unused but present for dispatcher symmetry.
+    Convert a FunctSpec to a FunctDef, evaluating its cost expressions.
+    Returns (None, []) if a cost expression fails.
     """
+    costs = []
+    for target, expr in funct_spec.costs:
+        try:
+            cycles = compile_expression(expr)(variables)
+        except ExpressionError as e:
+            ctx.error(f"cost expression error in function {funct_spec.name!r}: {e}")
+            return None, []
+        if cycles < 0:
+            ctx.error(f"cost of function {funct_spec.name!r} is {cycles}; must not be negative")
+            return None, []
+        costs.append((target, cycles))
     return None, [FunctDef(
         name        = funct_spec.name,
         description = funct_spec.description,
+        on_change   = funct_spec.on_change,
+        costs       = tuple(costs),
     )]
 
 
@@ -166,7 +184,7 @@ def _expand_statement(statement: Statement,
     # evaluate all active #if conditions
     for cond in statement.conditions:
         try:
-            result = evaluate(cond, variables)
+            result = compile_expression(cond)(variables)
         except ExpressionError as e:
             ctx.error(f"condition expression error {cond!r}: {e}")
             return None, []
@@ -189,8 +207,6 @@ def _expand_statement(statement: Statement,
 # Template evaluation
 # ---------------------------------------------------------------------------
 
-import re
-
 _TEMPLATE_SPEC_RE = re.compile(r"""
     \{              # opening brace
     (?P<expr>       # expression
@@ -204,6 +220,23 @@ _TEMPLATE_SPEC_RE = re.compile(r"""
 """, re.VERBOSE)
 
 
+@functools.lru_cache(maxsize=1024)
+def _compile_template(template: str) -> tuple[tuple, ...]:
+    """
+    Split a template string into its parts: literal text as a str, and
+    each {expr:N} format specifier as (expr, compiled expr, N).
+    """
+    parts = []
+    pos = 0
+    for m in _TEMPLATE_SPEC_RE.finditer(template):
+        parts.append(template[pos:m.start()])
+        expr_str = m.group('expr')
+        parts.append((expr_str, compile_expression(expr_str), int(m.group('width'))))
+        pos = m.end()
+    parts.append(template[pos:])
+    return tuple(part for part in parts if part != "")
+
+
 def _evaluate_template(template: str,
                        variables: dict[str, int]) -> str | None:
     """
@@ -211,17 +244,19 @@ def _evaluate_template(template: str,
     substituting the integer result zero-padded to N digits.
     Returns the expanded string, or None if any expression fails.
     """
-    result = template
-    for m in _TEMPLATE_SPEC_RE.finditer(template):
-        expr_str = m.group('expr')
-        width    = int(m.group('width'))
+    result = []
+    for part in _compile_template(template):
+        if isinstance(part, str):
+            result.append(part)
+            continue
+        expr_str, expr, width = part
         try:
-            val = evaluate(expr_str, variables)
+            val = expr(variables)
         except ExpressionError as e:
             ctx.error(f"template expression error {expr_str!r}: {e}")
             return None
-        result = result.replace(m.group(0), str(int(val)).zfill(width), 1)
-    return result
+        result.append(str(int(val)).zfill(width))
+    return "".join(result)
 
 
 # ---------------------------------------------------------------------------
@@ -0,0 +1,151 @@
+# blocs_budget.py
+# Checks at build time that the threads of a Design fit in their periods.
+#
+# A .bloc file may give the cycles one call of a function takes, as
+# 'cost=<expr>' for any target or 'cost.<target>=<expr>' for one, where
+# the expression may use the params; the resolver evaluates it for each
+# variant.  Cycle counts measured on the target can be used instead:
+# read_measured() reads what bl_show_thread() prints in a build with
+# EBL_PROFILE, and takes the longest time each function has taken.
+#
+# plan_budget() sets FunctInstance.cycles for every function in a
+# thread, from the measurements if there are any, otherwise from the
+# annotation for the target, and sums them for each thread.  Given the
+# core clock, a thread's load is its cycles per run over the cycles in
+# its period, and a core's load is the sum of the loads of its threads.
+# The scheduler balances its ticks with the same cycles; see
+# blocs_scheduler.py.
+#
+# Functions with no cost are left out of the sums, and listed, so the
+# loads are lower bounds until every function has one.
+
+from __future__ import annotations
+from dataclasses import dataclass, field
+import re
+
+from emblocs import Design, Thread, FunctInstance
+from parse_common import ctx, OMIT, read_source_file
+
+
+@dataclass
+class ThreadBudget:
+    """
+    The cost of one run of a thread.
+
+    Fields:
+        thread  -- the Thread
+        cycles  -- sum of the cycles of its functions that have a cost
+        unknown -- its functions that have no cost
+        period  -- cycles in one period at the core clock, 0 if the
+                   clock is unknown
+    """
+    thread:  Thread
+    cycles:  int = 0
+    unknown: list[FunctInstance] = field(default_factory=list)
+    period:  int = 0
+
+    @property
+    def load(self) -> float:
+        """ percent of the period that one run takes, 0.0 if the clock is unknown """
+        return 100.0 * self.cycles / self.period if self.period else 0.0
+
+
+@dataclass
+class Budget:
+    """
+    The costs of the threads of a Design.
+
+    Fields:
+        threads  -- a ThreadBudget for every thread with functions, in
+                    Design order
+        clock_hz -- core clock, 0 if unknown
+        measured -- number of functions whose cycles were measured
+    """
+    threads:  list[ThreadBudget] = field(default_factory=list)
+    clock_hz: int = 0
+    measured: int = 0
+
+    def core_loads(self) -> dict[int, float]:
+        """ percent of each core's time that its threads take """
+        loads: dict[int, float] = {}
+        for tb in self.threads:
+            loads[tb.thread.core] = loads.get(tb.thread.core, 0.0) + tb.load
+        return loads
+
+
+# bl_show_thread() prints each function as "     <block>.<function>",
+# then its profile as "        last 1, min 1, max 1, mean 1, 1 calls"
+_SHOW_FUNCT_RE = re.compile(r"^\s+(\w+\.\w+)( \(off\))?\s*$")
+_SHOW_PROFILE_RE = re.compile(
+    r"^\s+last \d+, min \d+, max (?P<max>\d+), mean \d+, (?P<calls>\d+) calls\s*$")
+# or one function per line, "<block>.<function> <cycles>"
+_PLAIN_RE = re.compile(r"^\s*(\w+\.\w+)\s+(\d+)\s*$")
+
+
+def read_measured(path: str) -> dict[str, int] | None:
+    """
+    Read measured cycle counts from the file at 'path', either the
+    output of bl_show_thread() with EBL_PROFILE, or lines of the form
+    '<block>.<function> <cycles>'; '#' starts a comment.  Returns the
+    cycles of each function by full name, the maximum of a profile,
+    or None if the file couldn't be read.  Functions that were never
+    called are skipped.
+    """
+    lines = read_source_file(path)
+    try:
+        if lines is None:
+            return None
+        measured = {}
+        funct_name = None
+        for lineno, line in enumerate(lines, start=1):
+            text = line.split("#", 1)[0].rstrip()
+            if m := _SHOW_PROFILE_RE.match(text):
+                if funct_name is not None and int(m.group('calls')) > 0:
+                    measured[funct_name] = int(m.group('max'))
+                funct_name = None
+            elif m := _SHOW_FUNCT_RE.match(text):
+                funct_name = m.group(1)
+            elif m := _PLAIN_RE.match(text):
+                measured[m.group(1)] = int(m.group(2))
+                funct_name = None
+            else:
+                funct_name = None
+        return measured
+    finally:
+        ctx.pop()
+
+
+def plan_budget(design: Design, target: str = "", measured: dict[str, int] | None = None,
+                clock_hz: int = 0) -> Budget | None:
+    """
+    Set the cycles of every function of 'design' that runs in a thread,
+    and sum them per thread.  'target' picks the cost annotations to
+    use, and 'measured' holds cycles by full function name, which are
+    used in place of them.  Returns None if no function has a cost, so
+    there is nothing to report.
+    """
+    measured = measured or {}
+    budget = Budget(clock_hz=clock_hz)
+    known = 0
+    for thread in design.threads.values():
+        if not thread.functions:
+            continue
+        tb = ThreadBudget(thread, period=thread.period_ns * clock_hz // 1_000_000_000)
+        for func in thread.functions:
+            if func.full_name in measured:
+                func.cycles = measured[func.full_name]
+                budget.measured += 1
+            else:
+                func.cycles = func.funct_def.cost(target)
+            if func.cycles is None:
+                tb.unknown.append(func)
+            else:
+                tb.cycles += func.cycles
+                known += 1
+        budget.threads.append(tb)
+    running = {func.full_name for thread in design.threads.values() for func in thread.functions}
+    missing = sorted(set(measured) - running)
+    if missing:
+        ctx.warning(f"budget: measured function(s) not in any thread: {', '.join(missing)}",
+                    lineno=OMIT, column=OMIT)
+    return budget if known else None
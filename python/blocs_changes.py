@@ -0,0 +1,174 @@
+# blocs_changes.py
+# Plans the change tracking that lets 'on_change' functions be skipped.
+#
+# A block function declared 'on_change' in its .bloc file promises that
+# its outputs depend only on its input pins.  When none of those inputs
+# have changed since it last ran, calling it again would just write the
+# same outputs, so the generated thread skips the call.
+#
+# Each on_change function in a thread gets a flag that says it needs to
+# run; flags start set, so every function runs at least once.  Changes
+# are found by the writers rather than the readers: right after a
+# function that drives a tracked signal, the thread compares the signal
+# with a shadow copy of its last value, and if it differs, updates the
+# shadow and sets the flag of every on_change function that reads it.
+# Each write is checked once no matter how many functions read it, and
+# a skipped function costs only a test of its flag.  Flags are bytes
+# that are only ever stored, never read-modify-written, so a thread that
+# preempts another can't lose a flag set by it.
+#
+# Signals carried from another core are checked after the mailbox that
+# brings them is taken.  Signals that no thread function drives can only
+# be changed by the application, so each reader checks them itself just
+# before it would run.  Unconnected input pins can't change at all, and
+# neither can signals folded into constants (see blocs_constants.py).
+#
+# None of that holds for a --meta system, where the application can
+# link a pin to another signal or set an unconnected one at run time.
+# There, with 'pin_pointers', each on_change function checks every one
+# of its inputs itself, through the pin pointer in its instance data,
+# just before it would run; that sees whatever the pin points at now.
+
+from __future__ import annotations
+from dataclasses import dataclass, field
+
+from emblocs import Design, Signal, FunctInstance, PinInstance, PinDir, PinType
+from blocs_mailboxes import Routing, local_copy_name
+from blocs_constants import ConstantPlan
+
+
+@dataclass
+class ChangeCheck:
+    """
+    A comparison of a signal with its shadow copy.
+
+    Fields:
+        value  -- C name of the signal (or its local copy) to check
+        shadow -- C name of the shadow copy of its last value
+        signal -- the Signal, for its type and initial value
+        flags  -- C names of the flags to set when it has changed
+        pin    -- the pin it reads through, for a check made through
+                  the pin pointer, otherwise None
+    """
+    value:  str
+    shadow: str
+    signal: Signal
+    flags:  list[str] = field(default_factory=list)
+    pin:    PinInstance | None = None
+
+
+@dataclass
+class ChangePlan:
+    """
+    The change tracking for a Design.
+
+    Fields:
+        flags  -- C name of the run flag of each on_change function,
+                  keyed by id() of the FunctInstance
+        checks -- every check, in the order they were planned
+        after  -- checks to make after a function runs, keyed by id()
+                  of the FunctInstance
+        before -- checks that an on_change function makes itself before
+                  testing its flag, keyed by id() of the FunctInstance
+        taken  -- checks to make after a mailbox is taken, keyed by the
+                  mailbox name
+    """
+    flags:  dict[int, str] = field(default_factory=dict)
+    checks: list[ChangeCheck] = field(default_factory=list)
+    after:  dict[int, list[ChangeCheck]] = field(default_factory=dict)
+    before: dict[int, list[ChangeCheck]] = field(default_factory=dict)
+    taken:  dict[str, list[ChangeCheck]] = field(default_factory=dict)
+
+
+def flag_name(func: FunctInstance) -> str:
+    return f"chg_{func.block.name}_{func.funct_def.name}"
+
+
+def _input_pins(func: FunctInstance, folded: dict[int, Signal]) -> list[PinInstance]:
+    return [pin for pin in func.pins
+            if pin.direction == PinDir.INPUT and not pin.signal.is_dummy
+            and id(pin.signal) not in folded]
+
+
+def _pin_check(func: FunctInstance, pin: PinInstance, flag: str) -> ChangeCheck:
+    # raw pins are compared as the word they point at
+    pin_def = pin.pin_def
+    sig_type = pin.pin_type if pin.pin_type != PinType.RAW else PinType.U32
+    indices = "".join(f"[{i}]" for i in pin_def.field_indices)
+    shadow = f"{flag}_{pin_def.name}"
+    return ChangeCheck(f"*blk_{func.block.name}.{pin_def.field.name}{indices}", shadow,
+                       Signal(name=shadow, sig_type=sig_type), [flag], pin)
+
+
+def plan_changes(design: Design, routing: Routing | None = None,
+                 constants: ConstantPlan | None = None,
+                 pin_pointers: bool = False) -> ChangePlan:
+    """
+    Plan the change tracking for the on_change functions in the threads
+    of 'design'.  'routing' is the cross-core routing from
+    plan_mailboxes(), if any, and 'constants' holds the signals that
+    are folded, if any.  With 'pin_pointers', every input is checked
+    through its pin pointer instead, so that pins can be relinked at
+    run time.  Designs without on_change functions get an empty
+    ChangePlan.
+    """
+    plan = ChangePlan()
+    if pin_pointers:
+        for thread in design.threads.values():
+            for func in thread.functions:
+                if func.funct_def.on_change:
+                    flag = flag_name(func)
+                    plan.flags[id(func)] = flag
+                    checks = [_pin_check(func, pin, flag) for pin in func.pins
+                              if pin.direction == PinDir.INPUT]
+                    plan.checks.extend(checks)
+                    plan.before[id(func)] = checks
+        return plan
+    folded = constants.signals if constants else {}
+    targets = routing.targets if routing else {}
+    # which mailbox brings each local copy
+    copy_mailbox: dict[str, str] = {}
+    for mbox in (routing.mailboxes if routing else []):
+        for signal in mbox.signals:
+            copy_mailbox[local_copy_name(signal, mbox.consumer.core)] = mbox.name
+    # the thread functions that drive each signal
+    writers: dict[int, list[FunctInstance]] = {}
+    for thread in design.threads.values():
+        for func in thread.functions:
+            for pin in func.block.pins.values():
+                if pin.direction == PinDir.OUTPUT and not pin.signal.is_dummy:
+                    writers.setdefault(id(pin.signal), []).append(func)
+    # one shared check per signal or local copy that writers maintain
+    shared: dict[str, ChangeCheck] = {}
+    for thread in design.threads.values():
+        for func in thread.functions:
+            if not func.funct_def.on_change:
+                continue
+            flag = flag_name(func)
+            plan.flags[id(func)] = flag
+            for pin in _input_pins(func, folded):
+                signal = pin.signal
+                value = targets.get(id(pin), f"sig_{signal.name}")
+                if value in copy_mailbox or id(signal) in writers:
+                    check = shared.get(value)
+                    if check is None:
+                        check = ChangeCheck(value, f"chg_{value}", signal)
+                        shared[value] = check
+                        plan.checks.append(check)
+                        if value in copy_mailbox:
+                            plan.taken.setdefault(copy_mailbox[value], []).append(check)
+                        else:
+                            for writer in writers[id(signal)]:
+                                plan.after.setdefault(id(writer), []).append(check)
+                else:
+                    # only the application can change it
+                    shadow = f"{flag}_{signal.name}"
+                    check = shared.get(shadow)
+                    if check is None:
+                        check = ChangeCheck(value, shadow, signal)
+                        shared[shadow] = check
+                        plan.checks.append(check)
+                        plan.before.setdefault(id(func), []).append(check)
+                if flag not in check.flags:
+                    check.flags.append(flag)
+    return plan
@@ -1,9 +1,68 @@
 #!/usr/bin/env python3
 # blocs_compiler.py
-# Given foo.blocs, create complete system foo.c, foo.h and foo.cmake,
+# Given foo.blocs, create complete system foo.c, foo.h, foo_pools.h and foo.cmake,
 # as well as *.c and *.c for each blockdef in the .blocs file
 #
 # Usage: blocs_compiler.py file.blocs build_dir/ [-c path/to/emblocs.json]
+#                          [--direct | --amalgamate [thread,...] | --meta]
+#                          [--fold] [--drop-dead] [--reorder] [--flash-pins]
+#                          [--loops] [--depfile] [--no-cache] [-j N]
+#                          [--target NAME] [--clock-hz HZ] [--max-load PERCENT]
+#                          [--costs FILE] [--footprint] [--sizes FILE]
+#
+# With --direct, each block that runs in a thread also gets a
+# direct_<block>.c, a copy of its functions specialised for that
+# instance, with its pins addressing their signals directly.
+#
+# With --amalgamate, each of the named threads (all of them if none
+# are named) gets its own foo_<thread>.c, with every block function
+# it calls inlined into it.  The calls and cycles of a run of each
+# thread are reported, with its code size as calls and inlined, from
+# the object sizes that --sizes reads.
+#
+# With --fold, signals that nothing drives are emitted as const, and
+# with --drop-dead, functions whose outputs nothing reads are left out
+# of their threads; see blocs_constants.py.
+#
+# With --reorder, the functions in each thread are sorted so that every
+# value passes from writer to reader on the same run; without it, an
+# order that delays a value is only warned about.  See blocs_dataflow.py.
+#
+# With --flash-pins, the pin pointers of each block are a const table
+# in flash, and only a pointer to it and the block's vars stay in RAM.
+#
+# With --loops, consecutive calls in a thread to the same function of
+# the same variant are made by one loop over a table of the instances.
+#
+# With --meta, foo.c also holds the metadata that the core would build
+# at startup, as const data in flash, and the realtime data as the RT
+# pool it points into; build it with EBL_STATIC_META.  It can't be
+# combined with --fold, --flash-pins or threads on other cores, since
+# their data lies outside the pools.
+#
+# With --depfile, the compiler also writes foo.d, listing every file it
+# read, --costs included but not --sizes, which the link writes, and
+# touches foo.stamp; this is the build rule that emblocs.cmake
+# sets up, so that editing the .blocs file rebuilds only what changed
+# without reconfiguring.  If the list of generated files in foo.cmake
+# changes, the build stops so that CMake can reconfigure.
+#
+# Parsed and resolved blocks are cached in build_dir/.blocs_cache, and
+# those that aren't are resolved by -j N worker processes (one per CPU
+# by default) before the .blocs file is parsed; see bloc_cache.py.
+# --no-cache turns both off.
+#
+# If any function has a cost, the cycles of each thread are reported,
+# using the 'cost.NAME' annotations with --target NAME.  With
+# --clock-hz, so is the load of each thread and core, and a core loaded
+# more than --max-load percent (100 by default) fails the build.
+# --costs reads measured cycles that replace the annotations; see
+# blocs_budget.py.
+#
+# With --footprint, the compiler also writes foo_footprint.txt and
+# foo_footprint.json, the RAM and flash of every variant, block and
+# thread.  They are estimates, unless --sizes names the linker map (or
+# 'nm --print-size' output) of the last build; see blocs_footprint.py.
 
 from __future__ import annotations
 from pathlib import Path
@@ -12,27 +71,69 @@ import sys
 import argparse
 
 from parse_common import ctx, OMIT, short_path
-from blocs_parser import parse_blocs_file, set_get_block_spec, set_expand_path
+from blocs_parser import (
+    parse_blocs_file, set_get_block_spec, set_expand_path, set_resolve_block_def,
+)
 from bloc_parser import parse_bloc_file
-from emblocs import Design, BlockSpec
+from bloc_resolver import resolve
+from bloc_cache import VariantCache, CACHE_DIR_NAME, prefetch
+from emblocs import Design, BlockSpec, BlockDef
+from blocs_scheduler import Schedule, plan_schedule
+from blocs_budget import Budget, ThreadBudget, plan_budget, read_measured
+from blocs_footprint import Footprint, plan_footprint, read_sizes
+from blocs_mailboxes import Routing, plan_mailboxes
+from blocs_changes import ChangePlan, plan_changes
+from blocs_constants import ConstantPlan, plan_constants, drop_functions
+from blocs_dataflow import DataflowPlan, plan_dataflow, late_links, apply_order
+from blocs_pools import (
+    PoolCounts, count_pools, index_bits, DISPATCH_ENTRY_SIZE, SIG_DATA_SIZE,
+)
 from emblocs_output import (
     write_file_if_changed,
     blockdef_as_h_variant,
     blockdef_as_c_variant,
+    block_as_c_direct,
+    direct_blocks,
+    thread_as_c_amalgamated,
+    thread_file_name,
+    thread_variants,
+    thread_loops,
     design_as_cmake,
+    design_as_depfile,
     design_as_c_system,
     design_as_h_system,
+    pools_as_h_system,
+    footprint_as_text,
+    footprint_as_json,
 )
 
 EMBLOCS_ROOT: Path = Path(__file__).parent.parent
 blocs_dir: Path = Path('.')
+direct_pins: bool = False
+amalgamate: list[str] | None = None     # None is off, [] is every thread
+fold_constants: bool = False
+drop_dead: bool = False
+reorder: bool = False
+flash_pins: bool = False
+loops: bool = False
+meta: bool = False
+depfile: bool = False
+variant_cache: VariantCache | None = None
+target: str = ""
+clock_hz: int = 0
+max_load: float = 100.0
+measured: dict[str, int] | None = None
+costs_path: Path | None = None
+footprint: bool = False
+sizes: dict[str, int] | None = None
 
 def get_blockspec(name: str, design: Design) -> BlockSpec | None:
     '''
     Callback for blockdef command in blocs_parser.py.
     Searches design.search_paths for the named .bloc file, verifies that
     the corresponding .h and .c files exist and are newer than the .bloc
-    file, then calls parse_bloc_file to create a valid BlockSpec.
+    file, then calls parse_bloc_file to create a valid BlockSpec, unless
+    variant_cache already has it.
     Returns the BlockSpec, or None on error.
     '''
     # is BlockSpec already in the Design?
@@ -78,8 +179,12 @@ def get_blockspec(name: str, design: Design) -> BlockSpec | None:
         ctx.info(f"run bloc_compiler.py on {bloc_path.name} and/or"
                  f" edit {c_path.name} to bring block up to date")
         return None
-    # parse the bloc
-    spec = parse_bloc_file(bloc_path.as_posix())
+    # parse the bloc, if it isn't in the cache
+    spec = None
+    if variant_cache is not None:
+        spec = variant_cache.load(variant_cache.spec_key(bloc_path))
+    if spec is None:
+        spec = parse_bloc_file(bloc_path.as_posix())
     if spec is None:
         ctx.error(f"failed to parse {short_path(bloc_path)!r}")
         return None
@@ -87,6 +192,22 @@ def get_blockspec(name: str, design: Design) -> BlockSpec | None:
     design.add_block_spec(spec)
     return spec
 
+def resolve_blockdef(spec: BlockSpec, name: str, orig_path: str,
+                     params: dict[str, int]) -> BlockDef | None:
+    '''
+    Callback for blockdef command in blocs_parser.py.
+    Returns the BlockDef from variant_cache if it is there, otherwise
+    resolves it.
+    '''
+    if variant_cache is None:
+        return resolve(spec, name, orig_path, params)
+    block_def = variant_cache.load(variant_cache.def_key(spec, name, orig_path, params))
+    if block_def is not None:
+        variant_cache.hits += 1
+        return block_def
+    variant_cache.misses += 1
+    return resolve(spec, name, orig_path, params)
+
 def expand_path(raw: str) -> Path | None:
     """
     Expand a raw search path string to a resolved absolute Path.
@@ -114,20 +235,35 @@ def expand_path(raw: str) -> Path | None:
         return (base / rest).resolve() if sep else base.resolve()
     return (blocs_dir / normalized).resolve()
 
+def report_cache(cache: VariantCache | None) -> None:
+    if cache is None or not (cache.hits or cache.misses):
+        return
+    # what prefetch() resolved came from the cache as far as the parser knew
+    cached = cache.hits - cache.resolved
+    message = f"variants: {cached} from cache, {cache.resolved + cache.misses} resolved"
+    if cache.workers:
+        message += f", {cache.resolved} of them in {cache.workers} worker processes"
+    ctx.info(message, lineno=OMIT, column=OMIT)
+
 def generate_variants(design: Design, build_dir: Path) -> None:
+    report_cache(variant_cache)
+    # each block's .c is read once, however many variants it has
+    block_sources: dict[str, list[str]] = {}
     # generate variant files
     for name, block_def in design.block_defs.items():
         # generate <variant>.h
         h_lines = []
-        blockdef_as_h_variant(h_lines, block_def)
+        blockdef_as_h_variant(h_lines, block_def, flash_pins)
         h_path = build_dir / f"{name}.h"
         if write_file_if_changed(h_path, h_lines):
             ctx.info(f"wrote {short_path(h_path)}", lineno=OMIT, column=OMIT)
         else:
             ctx.info(f"no change: {short_path(h_path)}", lineno=OMIT, column=OMIT)
         # generate <variant>.c
-        block_c = Path(block_def.abs_path).with_suffix(".c")
-        c_lines = block_c.read_text().splitlines()
+        if block_def.abs_path not in block_sources:
+            block_c = Path(block_def.abs_path).with_suffix(".c")
+            block_sources[block_def.abs_path] = block_c.read_text().splitlines()
+        c_lines = list(block_sources[block_def.abs_path])
         blockdef_as_c_variant(c_lines, block_def)
         c_path = build_dir / f"{name}.c"
         if write_file_if_changed(c_path, c_lines):
@@ -135,12 +271,289 @@ def generate_variants(design: Design, build_dir: Path) -> None:
         else:
             ctx.info(f"no change: {short_path(c_path)}", lineno=OMIT, column=OMIT)
 
+def generate_direct_files(design: Design, build_dir: Path, routing: Routing,
+                          constants: ConstantPlan | None) -> None:
+    # generate direct_<block>.c for each block that runs in a thread
+    folded = constants.signals if constants else {}
+    for block in direct_blocks(design):
+        block_c = Path(block.block_def.abs_path).with_suffix(".c")
+        c_lines = block_c.read_text().splitlines()
+        block_as_c_direct(c_lines, block, routing.targets, folded)
+        c_path = build_dir / f"direct_{block.name}.c"
+        if write_file_if_changed(c_path, c_lines):
+            ctx.info(f"wrote {short_path(c_path)}", lineno=OMIT, column=OMIT)
+        else:
+            ctx.info(f"no change: {short_path(c_path)}", lineno=OMIT, column=OMIT)
+
+def amalgamated_threads(design: Design) -> list[str]:
+    # the threads named by --amalgamate, or all of them; threads that
+    # call nothing gain nothing
+    if amalgamate is None:
+        return []
+    for name in amalgamate:
+        if name not in design.threads:
+            ctx.warning(f"--amalgamate: no thread named {name!r}", lineno=OMIT, column=OMIT)
+    return [thread.name for thread in design.threads.values()
+            if thread.functions and ( not amalgamate or thread.name in amalgamate )]
+
+def read_bodies(design: Design) -> dict[str, list[str]]:
+    # the lines of the <block>.c file of each variant
+    return {name: Path(block_def.abs_path).with_suffix(".c").read_text().splitlines()
+            for name, block_def in design.block_defs.items()}
+
+def amalgamation_summary(calls: list[str], sizes: dict[str, int], cycles: int,
+                         uncosted: int, inlined: int | None = None) -> str:
+    '''
+    Sums up the choice for one thread: 'calls' names the object of the
+    function each call (or loop) of a run makes, as <variant>_<function>,
+    'cycles' is what a run takes by the budget, leaving out 'uncosted'
+    functions, and 'inlined' is the size of the thread function of an
+    image where it was already amalgamated.  Code sizes come from
+    'sizes', the symbol sizes of the last build.
+    '''
+    speed = f"{len(calls)} call(s) per run"
+    if cycles:
+        speed += f", {cycles} cycles"
+        if uncosted:
+            speed += f" + {uncosted} function(s) without a cost"
+    else:
+        speed += ", cycles unknown"
+    if inlined is not None:
+        return f"{speed}; {inlined} bytes inlined"
+    known = [sizes.get(name) for name in calls]
+    if None in known:
+        return f"{speed}; code size unknown, see --sizes"
+    separate = sum(dict(zip(calls, known)).values())
+    return f"{speed}; {separate} bytes as calls vs ~{sum(known)} bytes inlined"
+
+def report_amalgamation(design: Design, selected: list[str], changes: ChangePlan,
+                        budget: Budget | None) -> None:
+    # inlining saves a call per function per run, and costs a copy of
+    # the function for every call after the first; a loop needs only
+    # one copy for all of its calls
+    stem = Path(design.abs_path).stem
+    budgets = {tb.thread.name: tb for tb in budget.threads} if budget else {}
+    for thread in design.threads.values():
+        if not thread.functions:
+            continue
+        runs = thread_loops(thread, changes) if loops else [[f] for f in thread.functions]
+        calls = [f"{run[0].block.block_def.name}_{run[0].funct_def.name}" for run in runs]
+        tb = budgets.get(thread.name, ThreadBudget(thread, unknown=thread.functions))
+        # in an image where the thread was amalgamated, its functions
+        # have no objects of their own
+        inlined = None
+        if sizes and not any(name in sizes for name in calls):
+            inlined = sizes.get(f"{stem}_{thread.name}")
+        choice = "amalgamated" if thread.name in selected else "separate"
+        summary = amalgamation_summary(calls, sizes or {}, tb.cycles, len(tb.unknown), inlined)
+        ctx.info(f"amalgamate: thread {thread.name}: {summary}: {choice}",
+                 lineno=OMIT, column=OMIT)
+
+def report_loops(design: Design, changes: ChangePlan) -> None:
+    for thread in design.threads.values():
+        for run in thread_loops(thread, changes):
+            if len(run) < 2:
+                continue
+            funct = f"{run[0].block.block_def.name}_{run[0].funct_def.name}"
+            if direct_pins:
+                what = "not looped, --direct calls a function per instance"
+            else:
+                what = "looped" if loops else "--loops loops them"
+            names = ", ".join(func.block.name for func in run)
+            ctx.info(f"loops: thread {thread.name}: {len(run)} consecutive calls to {funct}"
+                     f" ({what}): {names}", lineno=OMIT, column=OMIT)
+
+def report_pools(counts: PoolCounts) -> None:
+    # the defaults in emblocs_priv.h
+    for pool, used, default in (("RT", counts.rt_bytes, 2048), ("meta", counts.meta_bytes, 4096)):
+        bits = index_bits(used)
+        ctx.info(f"pools: {pool} pool needs {used} bytes in the base configuration,"
+                 f" {bits} index bits, {(4 << bits) - used} bytes of headroom before"
+                 f" the next bit", lineno=OMIT, column=OMIT)
+        if used > default:
+            ctx.warning(f"pools: {pool} pool needs more than the default {default} bytes;"
+                        f" size it with EBL_POOL_HEADER", lineno=OMIT, column=OMIT)
+    if counts.guessed:
+        ctx.info(f"pools: assumed one word for var(s) of unknown type: {', '.join(counts.guessed)}",
+                 lineno=OMIT, column=OMIT)
+
+def report_meta(counts: PoolCounts) -> None:
+    # no dispatch tables or moved signals; the threads call directly
+    rt_bytes = counts.rt_bytes - (counts.table_entries * DISPATCH_ENTRY_SIZE
+                                  + counts.layout_signals * SIG_DATA_SIZE)
+    ctx.info(f"meta: realtime data {rt_bytes} bytes, metadata {counts.meta_bytes} bytes"
+             f" in flash, in the base configuration", lineno=OMIT, column=OMIT)
+
+def report_constants(constants: ConstantPlan) -> None:
+    if constants.signals:
+        names = ", ".join(signal.name for signal in constants.signals.values())
+        what = "folded" if fold_constants else "--fold makes them const"
+        ctx.info(f"constants: {len(constants.signals)} undriven signal(s) never change"
+                 f" ({what}): {names}", lineno=OMIT, column=OMIT)
+    for func in constants.dead:
+        what = "dropped" if drop_dead else "--drop-dead drops it"
+        ctx.info(f"dead: nothing that runs reads the outputs of {func.full_name}"
+                 f" ({what})", lineno=OMIT, column=OMIT)
+
+def report_dataflow(dataflow: DataflowPlan, design: Design) -> None:
+    in_loop = {}
+    for n, loop in enumerate(dataflow.loops):
+        names = ", ".join(func.full_name for func in loop)
+        ctx.warning(f"algebraic loop in thread {loop[0].thread.name}: {names};"
+                    f" one of its signals is always a run late", lineno=OMIT, column=OMIT)
+        for func in loop:
+            in_loop[id(func)] = n
+    # the delay each late signal adds, in the order the threads run now
+    for link in late_links(dataflow, design):
+        thread = link.writer.thread
+        fixable = in_loop.get(id(link.writer), -1) != in_loop.get(id(link.reader), -2)
+        if fixable:
+            ctx.warning(f"thread {thread.name}: {link.reader.full_name} runs before"
+                        f" {link.writer.full_name}, so {link.signal.name} reaches it a run late"
+                        f" (--reorder fixes it)", lineno=OMIT, column=OMIT)
+        else:
+            ctx.info(f"delay: {link.signal.name}: {link.writer.full_name} -> {link.reader.full_name}:"
+                     f" one run of thread {thread.name} ({thread.period_ns} ns)",
+                     lineno=OMIT, column=OMIT)
+    for link in dataflow.crossing:
+        ctx.info(f"delay: {link.signal.name}: {link.writer.full_name} ({link.writer.thread.name}) ->"
+                 f" {link.reader.full_name} ({link.reader.thread.name}): up to one run of"
+                 f" thread {link.writer.thread.name} ({link.writer.thread.period_ns} ns)",
+                 lineno=OMIT, column=OMIT)
+
+def report_budget(budget: Budget | None) -> None:
+    if budget is None:
+        return
+    if budget.measured:
+        ctx.info(f"budget: {budget.measured} function(s) measured", lineno=OMIT, column=OMIT)
+    for tb in budget.threads:
+        message = f"budget: thread {tb.thread.name}: {tb.cycles} cycles per run"
+        if tb.period:
+            message += f", {tb.load:.1f}% of {tb.period} cycles"
+        if tb.unknown:
+            names = ", ".join(func.full_name for func in tb.unknown)
+            message += f"; no cost for {names}"
+        ctx.info(message, lineno=OMIT, column=OMIT)
+    if not budget.clock_hz:
+        return
+    for core, load in sorted(budget.core_loads().items()):
+        message = f"budget: core {core} is {load:.1f}% loaded at {budget.clock_hz} Hz"
+        if load > max_load:
+            ctx.error(f"{message}, more than --max-load {max_load:g}%", lineno=OMIT, column=OMIT)
+        else:
+            ctx.info(message, lineno=OMIT, column=OMIT)
+
+def report_footprint(fp: Footprint) -> None:
+    code = f"{fp.code} of code" if fp.measured else "code unknown"
+    ctx.info(f"footprint: {fp.ram} bytes of RAM in blocks and dummy signals, {fp.flash} of"
+             f" flash in pin tables, {code}{'' if fp.measured else ' (estimated)'}",
+             lineno=OMIT, column=OMIT)
+
+def generate_footprint_files(design: Design, build_dir: Path) -> None:
+    stem = Path(design.abs_path).stem
+    fp = plan_footprint(design, sizes, flash_pins)
+    report_footprint(fp)
+    for suffix, writer in (("txt", lambda lines: footprint_as_text(lines, design, fp)),
+                           ("json", lambda lines: footprint_as_json(lines, fp))):
+        f_lines = []
+        writer(f_lines)
+        f_path = build_dir / f"{stem}_footprint.{suffix}"
+        if write_file_if_changed(f_path, f_lines):
+            ctx.info(f"wrote {short_path(f_path)}", lineno=OMIT, column=OMIT)
+        else:
+            ctx.info(f"no change: {short_path(f_path)}", lineno=OMIT, column=OMIT)
+
+def report_schedule(schedule: Schedule | None) -> None:
+    if schedule is None:
+        return
+    phases = ", ".join(f"{entry.thread.name} 1/{entry.divisor} @{entry.phase}"
+                       for entry in schedule.entries)
+    ctx.info(f"scheduler: base tick {schedule.base_ns} ns, peak load {schedule.peak},"
+             f" total {sum(schedule.loads)} over {len(schedule.loads)} tick(s): {phases}",
+             lineno=OMIT, column=OMIT)
+
+def report_routing(routing: Routing) -> None:
+    for mbox in routing.mailboxes:
+        names = ", ".join(signal.name for signal in mbox.signals)
+        ctx.info(f"cross-core: {mbox.producer.name} (core {mbox.producer.core}) to"
+                 f" {mbox.consumer.name} (core {mbox.consumer.core}): {names}",
+                 lineno=OMIT, column=OMIT)
+
+def report_changes(changes: ChangePlan) -> None:
+    if not changes.flags:
+        return
+    ctx.info(f"on_change: {len(changes.flags)} function(s) skipped while their inputs"
+             f" are unchanged, {len(changes.checks)} signal check(s)",
+             lineno=OMIT, column=OMIT)
+
 def generate_system_files(design: Design, build_dir: Path) -> None:
 
     stem = Path(design.abs_path).stem
+    if meta:
+        cores = sorted({thread.core for thread in design.threads.values()} - {0})
+        if cores:
+            ctx.error(f"--meta: threads on core(s) {', '.join(map(str, cores))} aren't supported;"
+                      f" their signal copies are outside the RT pool", lineno=OMIT, column=OMIT)
+            return
+    # find signals that never change and functions that do nothing useful
+    constants = plan_constants(design)
+    report_constants(constants)
+    if drop_dead:
+        drop_functions(constants.dead)
+    folding = constants if fold_constants else None
+    # order thread functions by the flow of data between them
+    dataflow = plan_dataflow(design)
+    if reorder:
+        for thread in apply_order(dataflow, design):
+            names = ", ".join(func.full_name for func in thread.functions)
+            ctx.info(f"dataflow: thread {thread.name} reordered: {names}", lineno=OMIT, column=OMIT)
+    report_dataflow(dataflow, design)
+    # check that the threads fit in their periods
+    budget = plan_budget(design, target, measured, clock_hz)
+    report_budget(budget)
+    # plan the multi-rate scheduler
+    schedule = plan_schedule(design)
+    report_schedule(schedule)
+    # route signals that cross cores through mailboxes
+    routing = plan_mailboxes(design)
+    report_routing(routing)
+    # track input changes for on_change functions; pins of a --meta
+    # system can be relinked, so they are checked through their pointers
+    changes = plan_changes(design, routing, folding, pin_pointers=meta)
+    report_changes(changes)
+    report_loops(design, changes)
+    # specialise thread functions for their instances
+    if direct_pins:
+        generate_direct_files(design, build_dir, routing, folding)
+    # inline block functions into their threads
+    amalgamated = amalgamated_threads(design)
+    if amalgamate is not None:
+        bodies = read_bodies(design)
+        report_amalgamation(design, amalgamated, changes, budget)
+        for name in amalgamated:
+            t_lines = []
+            thread_as_c_amalgamated(t_lines, design.threads[name], stem, bodies, routing, changes,
+                                    loops)
+            t_path = build_dir / thread_file_name(design.threads[name], stem)
+            if write_file_if_changed(t_path, t_lines):
+                ctx.info(f"wrote {short_path(t_path)}", lineno=OMIT, column=OMIT)
+            else:
+                ctx.info(f"no change: {short_path(t_path)}", lineno=OMIT, column=OMIT)
+    # count what a run time build of the system takes from the pools
+    pools = count_pools(design)
+    report_pools(pools)
+    if meta:
+        report_meta(pools)
+    p_lines = []
+    pools_as_h_system(p_lines, design, pools)
+    p_path = build_dir / f"{stem}_pools.h"
+    if write_file_if_changed(p_path, p_lines):
+        ctx.info(f"wrote {short_path(p_path)}", lineno=OMIT, column=OMIT)
+    else:
+        ctx.info(f"no change: {short_path(p_path)}", lineno=OMIT, column=OMIT)
     # generate system header
     h_lines = []
-    design_as_h_system(h_lines, design)
+    design_as_h_system(h_lines, design, schedule, meta)
     h_path = build_dir / f"{stem}.h"
     if write_file_if_changed(h_path, h_lines):
         ctx.info(f"wrote {short_path(h_path)}", lineno=OMIT, column=OMIT)
@@ -149,7 +562,8 @@ def generate_system_files(design: Design, build_dir: Path) -> None:
 
     # generate system C file
     c_lines = []
-    design_as_c_system(c_lines, design)
+    design_as_c_system(c_lines, design, schedule, routing, changes, direct_pins, amalgamated,
+                       folding, flash_pins, loops, meta)
     c_path = build_dir / f"{stem}.c"
     if write_file_if_changed(c_path, c_lines):
         ctx.info(f"wrote {short_path(c_path)}", lineno=OMIT, column=OMIT)
@@ -158,19 +572,76 @@ def generate_system_files(design: Design, build_dir: Path) -> None:
 
     # generate system.cmake
     cmake_lines = []
-    design_as_cmake(cmake_lines, design)
+    design_as_cmake(cmake_lines, design, direct_pins, amalgamated)
     cmake_path = build_dir / f"{stem}.cmake"
+    existed = cmake_path.exists()
     if write_file_if_changed(cmake_path, cmake_lines):
         ctx.info(f"wrote {short_path(cmake_path)}", lineno=OMIT, column=OMIT)
+        if depfile and existed:
+            # the build that runs us can't pick up new sources
+            ctx.error(f"the generated sources changed; build again so that CMake"
+                      f" reads the new {cmake_path.name}", lineno=OMIT, column=OMIT)
     else:
         ctx.info(f"no change: {short_path(cmake_path)}", lineno=OMIT, column=OMIT)
 
+    # where the RAM and flash go
+    if footprint:
+        generate_footprint_files(design, build_dir)
+
+    # what the build rule depends on, and the stamp it makes
+    if depfile and ctx.no_errors():
+        stamp_path = build_dir / f"{stem}.stamp"
+        d_lines = []
+        # the --costs file decides whether the build passes; --sizes
+        # isn't listed, since the link writes it
+        design_as_depfile(d_lines, design, stamp_path, [costs_path] if costs_path else [])
+        d_path = build_dir / f"{stem}.d"
+        if write_file_if_changed(d_path, d_lines):
+            ctx.info(f"wrote {short_path(d_path)}", lineno=OMIT, column=OMIT)
+        stamp_path.touch()
+
 def main(args=None):
     ctx.push(source="blocs_compiler.py")
     # parse arguments
     parser = argparse.ArgumentParser(description="EMBLOCS system compiler")
     parser.add_argument('blocs_file', type=Path, help=".blocs system definition file")
     parser.add_argument('build_dir', type=Path, help="build output directory")
+    mode = parser.add_mutually_exclusive_group()
+    mode.add_argument('--direct', action='store_true',
+                      help="specialise thread functions for each block instance")
+    mode.add_argument('--amalgamate', nargs='?', const='', metavar='THREADS',
+                      help="inline block functions into one file per thread;"
+                           " THREADS is a comma separated list, default all")
+    mode.add_argument('--meta', action='store_true',
+                      help="generate the metadata as const data, for EBL_STATIC_META")
+    parser.add_argument('--fold', action='store_true',
+                        help="emit signals that nothing drives as constants")
+    parser.add_argument('--drop-dead', action='store_true',
+                        help="leave out functions whose outputs nothing reads")
+    parser.add_argument('--reorder', action='store_true',
+                        help="sort the functions in each thread by dataflow")
+    parser.add_argument('--flash-pins', action='store_true',
+                        help="put block pin pointers in const tables in flash")
+    parser.add_argument('--loops', action='store_true',
+                        help="call repeated block functions in one loop per run")
+    parser.add_argument('--depfile', action='store_true',
+                        help="write <system>.d and touch <system>.stamp, for a build rule")
+    parser.add_argument('--no-cache', action='store_true',
+                        help=f"don't use or update build_dir/{CACHE_DIR_NAME}")
+    parser.add_argument('-j', '--jobs', type=int, metavar='N',
+                        help="resolve uncached variants in N processes, default one per CPU")
+    parser.add_argument('--target', default="", metavar='NAME',
+                        help="use the function costs given for target NAME")
+    parser.add_argument('--clock-hz', type=int, default=0, metavar='HZ',
+                        help="core clock, to report the load of each thread and core")
+    parser.add_argument('--max-load', type=float, default=100.0, metavar='PERCENT',
+                        help="fail if a core is loaded more than this, default 100")
+    parser.add_argument('--costs', type=Path, metavar='FILE',
+                        help="measured cycles per function, in place of the costs")
+    parser.add_argument('--footprint', action='store_true',
+                        help="write <system>_footprint.txt and .json, RAM and flash per block")
+    parser.add_argument('--sizes', type=Path, metavar='FILE',
+                        help="linker map or 'nm -S' output to take the footprint sizes from")
     parsed_args = parser.parse_args(args)
     blocs_path = parsed_args.blocs_file.resolve()
     build_dir = parsed_args.build_dir.resolve()
@@ -181,14 +652,48 @@ def main(args=None):
     elif not build_dir.is_dir():
         ctx.error(f"build directory not found: {build_dir.as_posix()!r}",
                   lineno=OMIT, column=OMIT)
+    elif parsed_args.meta and (parsed_args.fold or parsed_args.flash_pins):
+        ctx.error(f"--meta can't be combined with --fold or --flash-pins",
+                  lineno=OMIT, column=OMIT)
     else:
-        global blocs_dir
+        global blocs_dir, direct_pins, amalgamate, fold_constants, drop_dead, reorder
+        global flash_pins, loops, meta, depfile, variant_cache
+        global target, clock_hz, max_load, measured, costs_path, footprint, sizes
         blocs_dir = blocs_path.parent
+        direct_pins = parsed_args.direct
+        fold_constants = parsed_args.fold
+        drop_dead = parsed_args.drop_dead
+        reorder = parsed_args.reorder
+        flash_pins = parsed_args.flash_pins
+        loops = parsed_args.loops
+        meta = parsed_args.meta
+        depfile = parsed_args.depfile
+        target = parsed_args.target
+        clock_hz = parsed_args.clock_hz
+        max_load = parsed_args.max_load
+        measured = None
+        costs_path = None
+        if parsed_args.costs is not None:
+            costs_path = parsed_args.costs.resolve()
+            measured = read_measured(costs_path.as_posix())
+        footprint = parsed_args.footprint or parsed_args.sizes is not None
+        sizes = None
+        if parsed_args.sizes is not None:
+            sizes = read_sizes(parsed_args.sizes.resolve().as_posix())
+        amalgamate = None
+        if parsed_args.amalgamate is not None:
+            amalgamate = [name for name in parsed_args.amalgamate.split(",") if name]
         # create an empty design
         design = Design(abs_path=blocs_path.as_posix())
         # register callbacks
         set_get_block_spec(get_blockspec)
         set_expand_path(expand_path)
+        set_resolve_block_def(resolve_blockdef)
+        # resolve what the cache doesn't have, in parallel
+        variant_cache = None
+        if not parsed_args.no_cache:
+            variant_cache = VariantCache(build_dir / CACHE_DIR_NAME)
+            prefetch(variant_cache, blocs_path.as_posix(), expand_path, parsed_args.jobs)
         # parse the .blocs file
         result = parse_blocs_file(blocs_path.as_posix(), design)
         if result is False:
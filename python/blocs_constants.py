@@ -0,0 +1,87 @@
+# blocs_constants.py
+# Finds the signals that never change and the functions whose work is
+# never used.
+#
+# A signal that no output pin drives keeps the value the .blocs file
+# gave it, unless the application writes it.  With --fold the system
+# compiler trusts that it doesn't: such signals are emitted as 'const',
+# so they cost flash instead of RAM, and in direct mode input pins that
+# read them become literals that the C compiler can fold into the block
+# code.  An application that writes one of them has to be built without
+# --fold.
+#
+# A function is dead when nothing that runs reads anything it writes.
+# Only functions that can have no other effect are candidates: they are
+# declared 'on_change', so their outputs depend only on their inputs,
+# they are the only function of their block, so all of the block's
+# pins are theirs, and they have at least one output pin, so they
+# aren't there to drive hardware.  Dropping a function can leave the
+# functions that feed it dead too, so the search repeats until nothing
+# more is found.  Signals that nothing in the design reads may still be
+# read by the application or the monitor, so dead functions are only
+# dropped with --drop-dead.
+
+from __future__ import annotations
+from dataclasses import dataclass, field
+
+from emblocs import Design, Signal, FunctInstance, PinDir
+
+
+@dataclass
+class ConstantPlan:
+    """
+    The constant signals and dead functions of a Design.
+
+    Fields:
+        signals -- signals that nothing drives, keyed by id() of the Signal
+        dead    -- thread functions whose outputs nothing that runs reads,
+                   in thread order
+    """
+    signals: dict[int, Signal] = field(default_factory=dict)
+    dead:    list[FunctInstance] = field(default_factory=list)
+
+
+def _droppable(func: FunctInstance) -> bool:
+    block = func.block
+    return (func.funct_def.on_change and len(block.functions) == 1
+            and any(pin.direction == PinDir.OUTPUT for pin in block.pins.values()))
+
+
+def _dead_functions(design: Design) -> list[FunctInstance]:
+    running = [func for thread in design.threads.values() for func in thread.functions]
+    dead: set[int] = set()
+    found = True
+    while found:
+        found = False
+        live_blocks = {id(func.block) for func in running if id(func) not in dead}
+        for func in running:
+            if id(func) in dead or not _droppable(func):
+                continue
+            read = any(id(reader.block) in live_blocks
+                       for pin in func.block.pins.values()
+                       if pin.direction == PinDir.OUTPUT and not pin.signal.is_dummy
+                       for reader in pin.signal.readers)
+            if not read:
+                dead.add(id(func))
+                found = True
+    return [func for func in running if id(func) in dead]
+
+
+def plan_constants(design: Design) -> ConstantPlan:
+    """
+    Find the signals of 'design' that nothing drives, and the thread
+    functions whose outputs no running function reads.
+    """
+    plan = ConstantPlan()
+    for signal in design.signals.values():
+        if signal.driver is None and not signal.is_dummy:
+            plan.signals[id(signal)] = signal
+    plan.dead = _dead_functions(design)
+    return plan
+
+
+def drop_functions(funcs: list[FunctInstance]) -> None:
+    """ Take each of 'funcs' out of the thread it is in. """
+    for func in funcs:
+        func.thread.functions.remove(func)
+        func.thread = None
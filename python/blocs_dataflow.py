@@ -0,0 +1,198 @@
+# blocs_dataflow.py
+# Orders the functions in each thread by the flow of data between them.
+#
+# When a function reads a signal that another function in the same
+# thread writes, running the writer first lets the value pass through
+# on the same run; running it after the reader delays the value by one
+# run of the thread.  The functions and the signals that link them form
+# a graph, built from the pins each function uses (see 'Pin-to-Function
+# Association' in bloc_language.md): an edge from writer to reader for
+# every signal one drives and the other reads.
+#
+# Sorting the graph topologically gives an order with no such delays.
+# The sort is stable: among the functions that are ready to run, the
+# one the .blocs file lists first goes first, so an order that already
+# agrees with the graph is left alone.  A cycle in the graph is an
+# algebraic loop: whatever the order, one link in it is a run late.
+# The functions of a loop keep their order from the .blocs file and
+# are placed as a group.
+#
+# Signals that cross from one thread to another are not ordered; the
+# reader sees whatever the writer's last run produced.
+
+from __future__ import annotations
+from dataclasses import dataclass, field
+import heapq
+
+from emblocs import Design, Signal, Thread, FunctInstance, PinDir
+
+
+@dataclass
+class Link:
+    """
+    A signal written by one function and read by another.
+
+    Fields:
+        signal -- the Signal
+        writer -- the FunctInstance that drives it
+        reader -- a FunctInstance that reads it
+    """
+    signal: Signal
+    writer: FunctInstance
+    reader: FunctInstance
+
+
+@dataclass
+class DataflowPlan:
+    """
+    The dataflow graph of a Design, and the order it gives each thread.
+
+    Fields:
+        order    -- the sorted functions of each thread, keyed by thread name
+        links    -- links between functions in the same thread
+        loops    -- the functions of each algebraic loop, in thread order
+        crossing -- links between functions in different threads
+    """
+    order:    dict[str, list[FunctInstance]] = field(default_factory=dict)
+    links:    list[Link] = field(default_factory=list)
+    loops:    list[list[FunctInstance]] = field(default_factory=list)
+    crossing: list[Link] = field(default_factory=list)
+
+
+def _links(design: Design) -> list[Link]:
+    # every signal a thread function writes, paired with every thread
+    # function that reads it
+    writers: dict[int, list[FunctInstance]] = {}
+    readers: dict[int, list[FunctInstance]] = {}
+    signals: dict[int, Signal] = {}
+    for thread in design.threads.values():
+        for func in thread.functions:
+            for pin in func.pins:
+                if pin.signal.is_dummy:
+                    continue
+                signals[id(pin.signal)] = pin.signal
+                if pin.direction == PinDir.OUTPUT:
+                    writers.setdefault(id(pin.signal), []).append(func)
+                else:
+                    readers.setdefault(id(pin.signal), []).append(func)
+    return [Link(signals[key], writer, reader)
+            for key, funcs in writers.items()
+            for writer in funcs
+            for reader in readers.get(key, [])]
+
+
+def _loops(funcs: list[FunctInstance], succ: dict[int, list[int]]) -> list[list[int]]:
+    # Tarjan's strongly connected components, over indices into funcs;
+    # returns the components with a cycle in them
+    index: dict[int, int] = {}
+    low: dict[int, int] = {}
+    stack: list[int] = []
+    on_stack: set[int] = set()
+    loops = []
+
+    def visit(v: int) -> None:
+        index[v] = low[v] = len(index)
+        stack.append(v)
+        on_stack.add(v)
+        for w in succ[v]:
+            if w not in index:
+                visit(w)
+                low[v] = min(low[v], low[w])
+            elif w in on_stack:
+                low[v] = min(low[v], index[w])
+        if low[v] == index[v]:
+            component = []
+            while True:
+                w = stack.pop()
+                on_stack.discard(w)
+                component.append(w)
+                if w == v:
+                    break
+            if len(component) > 1 or v in succ[v]:
+                loops.append(sorted(component))
+
+    for v in range(len(funcs)):
+        if v not in index:
+            visit(v)
+    return loops
+
+
+def _sort_thread(thread: Thread, links: list[Link], plan: DataflowPlan) -> None:
+    funcs = thread.functions
+    position = {id(func): n for n, func in enumerate(funcs)}
+    succ: dict[int, list[int]] = {n: [] for n in range(len(funcs))}
+    for link in links:
+        w, r = position[id(link.writer)], position[id(link.reader)]
+        if r not in succ[w]:
+            succ[w].append(r)
+    # each loop becomes one node, named by its first member
+    group = {n: n for n in range(len(funcs))}
+    members = {n: [n] for n in range(len(funcs))}
+    for loop in _loops(funcs, succ):
+        plan.loops.append([funcs[n] for n in loop])
+        for n in loop:
+            group[n] = loop[0]
+            members.pop(n, None)
+        members[loop[0]] = loop
+    # stable topological sort of the groups
+    preds = {g: set() for g in members}
+    for w, rs in succ.items():
+        for r in rs:
+            if group[w] != group[r]:
+                preds[group[r]].add(group[w])
+    ready = [g for g in members if not preds[g]]
+    heapq.heapify(ready)
+    order = []
+    while ready:
+        g = heapq.heappop(ready)
+        order.extend(funcs[n] for n in members[g])
+        for h in members:
+            if g in preds[h]:
+                preds[h].discard(g)
+                if not preds[h]:
+                    heapq.heappush(ready, h)
+    plan.order[thread.name] = order
+
+
+def plan_dataflow(design: Design) -> DataflowPlan:
+    """
+    Build the dataflow graph of the threads of 'design', find its
+    algebraic loops, and sort each thread.  The threads themselves are
+    not changed; see apply_order().
+    """
+    plan = DataflowPlan()
+    for link in _links(design):
+        if link.writer.thread is link.reader.thread:
+            plan.links.append(link)
+        else:
+            plan.crossing.append(link)
+    for thread in design.threads.values():
+        links = [link for link in plan.links if link.writer.thread is thread]
+        _sort_thread(thread, links, plan)
+    return plan
+
+
+def late_links(plan: DataflowPlan, design: Design) -> list[Link]:
+    """
+    Returns the links whose reader runs before their writer in the
+    current order of the threads of 'design'; each one delays its
+    signal by one run of the thread.
+    """
+    position = {id(func): n for thread in design.threads.values()
+                for n, func in enumerate(thread.functions)}
+    return [link for link in plan.links
+            if position[id(link.reader)] <= position[id(link.writer)]]
+
+
+def apply_order(plan: DataflowPlan, design: Design) -> list[Thread]:
+    """
+    Put the functions of each thread of 'design' in the sorted order.
+    Returns the threads whose order changed.
+    """
+    changed = []
+    for thread in design.threads.values():
+        order = plan.order[thread.name]
+        if [id(func) for func in order] != [id(func) for func in thread.functions]:
+            thread.functions[:] = order
+            changed.append(thread)
+    return changed
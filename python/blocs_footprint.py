@@ -0,0 +1,279 @@
+# blocs_footprint.py
+# Reports where the RAM and flash of a statically generated system go.
+#
+# For each variant and each block it gives the size of the instance
+# struct, the RAM of the dummy signals of the unconnected pins, and the
+# code size of each function, and it totals them for each thread.  The
+# sizes come from one of two places:
+#
+#   estimated  the instance struct is laid out as blocs_pools.py does,
+#              for the base configuration of a 32-bit target, and each
+#              dummy signal is one word; code sizes are unknown
+#   measured   read_sizes() reads the symbol sizes of the linked image,
+#              from the linker map of a build with -ffunction-sections
+#              and -fdata-sections, so that every object has a section
+#              of its own, or from the output of 'nm --print-size'
+#
+# Measured sizes are looked up by the names the generated code gives
+# the objects: blk_<block>, and pins_<block> with --flash-pins, for the
+# instance struct, dsig_<block>_<pin> for dummies, <variant>_<function>
+# for block functions, and <system>_<thread> for threads.  Each blk_
+# object is a <variant>_t, so its size is the sizeof() of the generated
+# struct; the instances are the sizeof probes.  Anything not found in
+# the image (a function the C compiler inlined, say) keeps its estimate.
+#
+# A block counts toward the first thread that calls one of its
+# functions, so that the thread totals add up to the system's; the code
+# of a function counts once toward every thread that calls it.
+
+from __future__ import annotations
+from dataclasses import dataclass, field
+from pathlib import Path
+import re
+
+from emblocs import Design, BlockInstance
+from blocs_pools import block_data_size, pin_table_size, SIG_DATA_SIZE
+from parse_common import ctx, read_source_file
+
+
+@dataclass
+class VariantFootprint:
+    """
+    The footprint of one variant.
+
+    Fields:
+        name      -- variant name
+        struct    -- bytes of RAM in each instance struct
+        pin_table -- bytes of flash in each pin table, with --flash-pins
+        code      -- bytes of code of each function, None if unknown
+        instances -- number of blocks of the variant
+        measured  -- True if the sizes came from the image
+    """
+    name:      str
+    struct:    int
+    pin_table: int = 0
+    code:      dict[str, int | None] = field(default_factory=dict)
+    instances: int = 0
+    measured:  bool = False
+
+
+@dataclass
+class BlockFootprint:
+    """
+    The footprint of one block instance.
+
+    Fields:
+        name      -- block name
+        variant   -- variant name
+        struct    -- bytes of RAM in its instance struct
+        pin_table -- bytes of flash in its pin table
+        dummies   -- number of dummy signals, one per unconnected pin
+        dummy_ram -- bytes of RAM in its dummy signals
+        thread    -- the thread it counts toward, or None
+        measured  -- True if the sizes came from the image
+    """
+    name:      str
+    variant:   str
+    struct:    int
+    pin_table: int = 0
+    dummies:   int = 0
+    dummy_ram: int = 0
+    thread:    str | None = None
+    measured:  bool = False
+
+    @property
+    def ram(self) -> int:
+        return self.struct + self.dummy_ram
+
+
+@dataclass
+class ThreadFootprint:
+    """
+    The totals of one thread.
+
+    Fields:
+        name      -- thread name
+        ram       -- bytes of RAM in the blocks that count toward it
+        flash     -- bytes of flash in their pin tables
+        code      -- bytes of code of the functions it calls, and of the
+                     thread function itself, as far as they are known
+        unknown   -- functions it calls whose code size is unknown
+    """
+    name:    str
+    ram:     int = 0
+    flash:   int = 0
+    code:    int = 0
+    unknown: list[str] = field(default_factory=list)
+
+
+@dataclass
+class Footprint:
+    """
+    The footprint of a Design.
+
+    Fields:
+        variants -- a VariantFootprint for every variant with blocks
+        blocks   -- a BlockFootprint for every block, in Design order
+        threads  -- a ThreadFootprint for every thread, in Design order
+        measured -- True if sizes were read from the image
+    """
+    variants: dict[str, VariantFootprint] = field(default_factory=dict)
+    blocks:   list[BlockFootprint] = field(default_factory=list)
+    threads:  list[ThreadFootprint] = field(default_factory=list)
+    measured: bool = False
+
+    @property
+    def ram(self) -> int:
+        return sum(block.ram for block in self.blocks)
+
+    @property
+    def flash(self) -> int:
+        return sum(block.pin_table for block in self.blocks)
+
+    @property
+    def code(self) -> int:
+        return sum(size for v in self.variants.values() for size in v.code.values() if size)
+
+    def as_dict(self) -> dict:
+        """ the footprint as plain data, for JSON """
+        return {
+            "measured": self.measured,
+            "totals": {"ram": self.ram, "flash": self.flash, "code": self.code},
+            "variants": [
+                {"name": v.name, "struct": v.struct, "pin_table": v.pin_table,
+                 "code": v.code, "instances": v.instances, "measured": v.measured}
+                for v in self.variants.values()],
+            "blocks": [
+                {"name": b.name, "variant": b.variant, "struct": b.struct,
+                 "pin_table": b.pin_table, "dummies": b.dummies, "dummy_ram": b.dummy_ram,
+                 "thread": b.thread, "measured": b.measured}
+                for b in self.blocks],
+            "threads": [
+                {"name": t.name, "ram": t.ram, "flash": t.flash, "code": t.code,
+                 "unknown": t.unknown}
+                for t in self.threads],
+        }
+
+
+# a section of its own in a GNU ld map, ' .bss.blk_a1  0x20000010  0x8  file.o',
+# with the address and size on the next line if the name is long
+_MAP_SECTION_RE = re.compile(
+    r"^ \.(?:text|rodata|data|bss|sdata|sbss)\.(?P<name>[\w$]+)"
+    r"(?:\s+0x[0-9a-fA-F]+\s+0x(?P<size>[0-9a-fA-F]+)\s+\S.*)?$")
+_MAP_CONTINUED_RE = re.compile(r"^\s+0x[0-9a-fA-F]+\s+0x(?P<size>[0-9a-fA-F]+)\s+\S")
+_MAP_START = "Linker script and memory map"
+# 'nm --print-size': address, size, type, name
+_NM_RE = re.compile(r"^[0-9a-fA-F]+\s+(?P<size>[0-9a-fA-F]+)\s+[A-Za-z]\s+(?P<name>[\w$.]+)\s*$")
+
+
+def read_sizes(path: str) -> dict[str, int] | None:
+    """
+    Read symbol sizes from the file at 'path', a GNU ld map or the
+    output of 'nm --print-size'.  Returns the size of each symbol, or
+    None if the file couldn't be read.  The sections a map lists as
+    discarded are skipped.
+    """
+    lines = read_source_file(path)
+    try:
+        if lines is None:
+            return None
+        start = next((i for i, line in enumerate(lines) if line.startswith(_MAP_START)), 0)
+        sizes = {}
+        pending = None
+        for line in lines[start:]:
+            line = line.rstrip("\n")
+            if pending is not None and (m := _MAP_CONTINUED_RE.match(line)):
+                sizes[pending] = int(m.group('size'), 16)
+                pending = None
+            elif m := _MAP_SECTION_RE.match(line):
+                pending = None
+                if m.group('size') is None:
+                    pending = m.group('name')
+                else:
+                    sizes[m.group('name')] = int(m.group('size'), 16)
+            elif m := _NM_RE.match(line):
+                pending = None
+                sizes[m.group('name')] = int(m.group('size'), 16)
+            else:
+                pending = None
+        return sizes
+    finally:
+        ctx.pop()
+
+
+def _first_threads(design: Design) -> dict[int, str]:
+    # the first thread that calls a function of each block
+    first: dict[int, str] = {}
+    for thread in design.threads.values():
+        for func in thread.functions:
+            first.setdefault(id(func.block), thread.name)
+    return first
+
+
+def _block_footprint(block: BlockInstance, variant: VariantFootprint,
+                     sizes: dict[str, int], flash_pins: bool) -> BlockFootprint:
+    dummies = [pin for pin in block.pins.values() if pin.signal.is_dummy]
+    fp = BlockFootprint(name=block.name, variant=variant.name, struct=variant.struct,
+                        pin_table=variant.pin_table, dummies=len(dummies),
+                        dummy_ram=len(dummies) * SIG_DATA_SIZE)
+    if f"blk_{block.name}" in sizes:
+        fp.measured = True
+        fp.struct = sizes[f"blk_{block.name}"]
+        if flash_pins:
+            fp.pin_table = sizes.get(f"pins_{block.name}", fp.pin_table)
+        fp.dummy_ram = sum(sizes.get(pin.dummy_name, SIG_DATA_SIZE) for pin in dummies)
+    return fp
+
+
+def plan_footprint(design: Design, sizes: dict[str, int] | None = None,
+                   flash_pins: bool = False) -> Footprint:
+    """
+    Work out the footprint of 'design', using the symbol sizes in
+    'sizes' where there are any, and estimates elsewhere.
+    """
+    sizes = sizes or {}
+    stem = Path(design.abs_path).stem
+    footprint = Footprint(measured=bool(sizes))
+    for block in design.blocks.values():
+        block_def = block.block_def
+        if block_def.name not in footprint.variants:
+            variant = VariantFootprint(
+                name=block_def.name,
+                struct=block_data_size(block_def, [], flash_pins),
+                pin_table=pin_table_size(block_def) if flash_pins else 0)
+            for funct_name in block_def.functions:
+                variant.code[funct_name] = sizes.get(f"{block_def.name}_{funct_name}")
+            footprint.variants[block_def.name] = variant
+        variant = footprint.variants[block_def.name]
+        variant.instances += 1
+        footprint.blocks.append(_block_footprint(block, variant, sizes, flash_pins))
+    # an instance measured is a measure of the variant's struct
+    for fp in footprint.blocks:
+        variant = footprint.variants[fp.variant]
+        if fp.measured and not variant.measured:
+            variant.measured = True
+            variant.struct = fp.struct
+            variant.pin_table = fp.pin_table
+    for fp in footprint.blocks:
+        variant = footprint.variants[fp.variant]
+        if variant.measured and not fp.measured:
+            fp.struct = variant.struct
+            fp.pin_table = variant.pin_table
+    first = _first_threads(design)
+    for thread in design.threads.values():
+        tf = ThreadFootprint(name=thread.name, code=sizes.get(f"{stem}_{thread.name}", 0))
+        for fp, block in zip(footprint.blocks, design.blocks.values()):
+            if first.get(id(block)) == thread.name:
+                fp.thread = thread.name
+                tf.ram += fp.ram
+                tf.flash += fp.pin_table
+        called = dict.fromkeys(f"{func.block.block_def.name}_{func.funct_def.name}"
+                               for func in thread.functions)
+        for name in called:
+            size = sizes.get(name)
+            if size is None:
+                tf.unknown.append(name)
+            else:
+                tf.code += size
+        footprint.threads.append(tf)
+    return footprint
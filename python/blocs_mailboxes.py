@@ -0,0 +1,128 @@
+# blocs_mailboxes.py
+# Routes signals that cross cores through mailboxes.
+#
+# Threads can be assigned to cores with the '@' subcommand.  A signal
+# written by a block that runs on one core and read by a block that
+# runs on another can't simply be shared: the reader could see it
+# change half way through a thread, or see the writes of one tick out
+# of order.  Instead, each such signal gets a copy on the reading
+# core.  The thread that runs the writing block puts the new values
+# into a lock-free single-producer, single-consumer mailbox (see
+# src/misc/mailbox.h) after its last function, and the fastest thread
+# on the reading core that uses the signal takes the newest values
+# into the copies before its first function.  Every signal carried by
+# one mailbox is taken from the same run of the producing thread, and
+# the mailbox is a triple buffer, so that run is always the newest one
+# however much faster the producer runs than the consumer.
+
+from __future__ import annotations
+from dataclasses import dataclass, field
+from operator import attrgetter
+
+from emblocs import Design, Thread, Signal, BlockInstance, PinInstance
+from parse_common import ctx, OMIT
+
+@dataclass
+class Mailbox:
+    """
+    Cross-core signals sent from one thread to another.
+
+    Fields:
+        producer -- thread that puts the signals after it runs
+        consumer -- thread, on another core, that takes them before it runs
+        signals  -- signals carried, in Design order
+    """
+    producer: Thread
+    consumer: Thread
+    signals:  list[Signal] = field(default_factory=list)
+
+    @property
+    def name(self) -> str:
+        return f"mbox_{self.producer.name}_{self.consumer.name}"
+
+
+@dataclass
+class Routing:
+    """
+    The cross-core routing for a Design.
+
+    Fields:
+        mailboxes -- one per producer/consumer pair, in Design order
+        targets   -- C name of the local copy that each rerouted pin
+                     points to, keyed by id() of the PinInstance
+    """
+    mailboxes: list[Mailbox] = field(default_factory=list)
+    targets:   dict[int, str] = field(default_factory=dict)
+
+
+def local_copy_name(signal: Signal, core: int) -> str:
+    return f"sig_{signal.name}_core{core}"
+
+
+def _block_threads(design: Design) -> dict[int, list[Thread]]:
+    """ threads that run each block, keyed by id() of the block """
+    threads: dict[int, list[Thread]] = {}
+    for thread in design.threads.values():
+        for func in thread.functions:
+            block_threads = threads.setdefault(id(func.block), [])
+            if not any(t is thread for t in block_threads):
+                block_threads.append(thread)
+    return threads
+
+
+def _block_core(block: BlockInstance, block_threads: dict[int, list[Thread]],
+                warned: set[int]) -> int | None:
+    """
+    Returns the core that runs 'block', or None if no thread runs it
+    or it runs on more than one core (which is warned about once).
+    """
+    cores = {thread.core for thread in block_threads.get(id(block), [])}
+    if len(cores) == 1:
+        return cores.pop()
+    if cores and id(block) not in warned:
+        warned.add(id(block))
+        ctx.warning(f"block {block.name!r} has functions on more than one core;"
+                    f" its signals are not routed between cores",
+                    lineno=OMIT, column=OMIT)
+    return None
+
+
+def plan_mailboxes(design: Design) -> Routing:
+    """
+    Find the signals that cross cores in 'design' and plan the
+    mailboxes that carry them.  Single core designs get an empty
+    Routing.
+    """
+    routing = Routing()
+    if len({thread.core for thread in design.threads.values()}) < 2:
+        return routing
+    block_threads = _block_threads(design)
+    warned: set[int] = set()
+    mailboxes: dict[tuple[int, int], Mailbox] = {}
+    for signal in design.signals.values():
+        if signal.driver is None:
+            continue
+        writer = signal.driver.block
+        writer_core = _block_core(writer, block_threads, warned)
+        if writer_core is None:
+            continue
+        producer = block_threads[id(writer)][0]
+        # readers on other cores, grouped by core
+        remote: dict[int, list[PinInstance]] = {}
+        for pin in signal.readers:
+            core = _block_core(pin.block, block_threads, warned)
+            if core is not None and core != writer_core:
+                remote.setdefault(core, []).append(pin)
+        for core, pins in sorted(remote.items()):
+            # the fastest thread on the core that reads the signal
+            # updates the copy; slower ones just use it
+            readers = [thread for pin in pins for thread in block_threads[id(pin.block)]]
+            consumer = min(readers, key=attrgetter("period_ns"))
+            key = (id(producer), id(consumer))
+            if key not in mailboxes:
+                mailboxes[key] = Mailbox(producer, consumer)
+                routing.mailboxes.append(mailboxes[key])
+            mailboxes[key].signals.append(signal)
+            for pin in pins:
+                routing.targets[id(pin)] = local_copy_name(signal, core)
+    return routing
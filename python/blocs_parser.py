@@ -21,7 +21,8 @@ from bloc_resolver import resolve
 from parse_common import (
     ctx, OMIT,
     Token, tokenize_line,
-    read_source_file, read_source_string
+    read_source_file, read_source_string,
+    collector_paused,
 )
 
 
@@ -40,6 +41,18 @@ SIGNAL_TYPES = {
 # helper for parsing values and expressions
 # ---------------------------------------------------------------------------
 
+def _evaluate(text: str, mode: str) -> int | float:
+    # most values are plain numbers, which Python's own conversions
+    # handle much faster than the expression evaluator, and the same way
+    try:
+        if mode == 'int':
+            return int(text, 0)
+        if text.lstrip("+-")[:1] in "0123456789.":  # not inf or nan
+            return float(text)
+    except ValueError:
+        pass
+    return evaluate(text, {}, mode)
+
 def get_value(text: str, value_type: PinType) -> int | float | None:
     """
     Parse and validate a value/expression string against the given EMBLOCS type.
@@ -60,14 +73,14 @@ def get_value(text: str, value_type: PinType) -> int | float | None:
         if text == "false":
             return 0
         try:
-            result = evaluate(text, {}, 'int')
+            result = _evaluate(text, 'int')
         except ExpressionError as e:
             ctx.error(f"invalid bool value {text!r}: {e}")
             return None
         return int(result)
     elif value_type == PinType.U32:
         try:
-            result = evaluate(text, {}, 'int')
+            result = _evaluate(text, 'int')
         except ExpressionError as e:
             ctx.error(f"invalid u32 value {text!r}: {e}")
             return None
@@ -77,7 +90,7 @@ def get_value(text: str, value_type: PinType) -> int | float | None:
         return int(result)
     elif value_type == PinType.S32:
         try:
-            result = evaluate(text, {}, 'int')
+            result = _evaluate(text, 'int')
         except ExpressionError as e:
             ctx.error(f"invalid s32 value {text!r}: {e}")
             return None
@@ -87,7 +100,7 @@ def get_value(text: str, value_type: PinType) -> int | float | None:
         return int(result)
     elif value_type == PinType.FLOAT:
         try:
-            result = evaluate(text, {}, 'float')
+            result = _evaluate(text, 'float')
         except ExpressionError as e:
             ctx.error(f"invalid float value {text!r}: {e}")
             return None
@@ -118,6 +131,15 @@ def set_expand_path(handler: Callable[[str], Path | None]) -> None:
     global _expand_path
     _expand_path = handler
 
+# the BlockSpec of a blockdef command is resolved with a callback,
+# so that the compiler can supply cached results; None resolves it
+_resolve_block_def: Callable[[BlockSpec, str, str, dict[str, int]], BlockDef | None] | None = None
+
+def set_resolve_block_def(handler: Callable[[BlockSpec, str, str, dict[str, int]],
+                                            BlockDef | None] | None) -> None:
+    global _resolve_block_def
+    _resolve_block_def = handler
+
 # ---------------------------------------------------------------------------
 # Command handlers
 # ---------------------------------------------------------------------------
@@ -199,7 +221,8 @@ def cmd_blockdef(tokens: list[Token], design: Design) -> tuple[BlockDef | None,
                      f"using default value {param.default}", column=OMIT)
     # resolve BlockSpec to BlockDef - set context for resolve() errors
     ctx.set(token=defname_tok)
-    block_def = resolve(spec, defname_tok.text, specname_tok.text, supplied_params)
+    resolver = _resolve_block_def or resolve
+    block_def = resolver(spec, defname_tok.text, specname_tok.text, supplied_params)
     if block_def is None:
         ctx.error(f"failed to resolve {specname_tok.text!r} as {defname_tok.text!r}",
                   column=OMIT)
@@ -373,6 +396,22 @@ def set_handler(arg: str, target: DesignObject, design: Design) -> bool:
     return True
 
 
+def core_handler(arg: str, target: DesignObject, design: Design) -> bool:
+    """'@' subcommand on thread: run the thread on the given core."""
+    if not arg:
+        ctx.error("'@' requires a core number")
+        return False
+    core = get_value(arg, PinType.U32)
+    if core is None:
+        return False
+    try:
+        design.set_thread_core(target, core)
+    except EmblocsError as e:
+        ctx.error(str(e))
+        return False
+    return True
+
+
 # ---------------------------------------------------------------------------
 # dispatcher
 # ---------------------------------------------------------------------------
@@ -396,7 +435,8 @@ SUBCMD_DISPATCH = {
                     ("=",  set_handler)),
     Thread:        (("-+", relink_handler),
                     ("+",  link_handler),
-                    ("-",  unlink_with_arg_handler)),
+                    ("-",  unlink_with_arg_handler),
+                    ("@",  core_handler)),
     FunctInstance: (("-+", relink_handler),
                     ("+",  link_handler),
                     ("-",  unlink_no_arg_handler)),
@@ -474,34 +514,29 @@ def lex_lines(lines: list[str]) -> list[list[Token]]:
     Returns a list of logical lines, each a non-empty list of Token objects.
     Reports errors into the current context.
     """
-    logical_lines:   list[list[Token]] = []
-    logical_tokens:  list[Token]       = []
-    in_continuation: bool              = False
+    logical_lines: list[list[Token]] = []
+    continued:     list[Token]       = []   # tokens of lines ending in '\\'
 
     for lineno, raw_line in enumerate(lines, start=1):
-        # strip comment: everything from # onward
-        content, _sep, _comment = raw_line.partition("#")
-
-        # strip trailing whitespace including newline
-        content = content.rstrip()
+        # strip comment (everything from # onward) and trailing whitespace
+        content = raw_line.partition("#")[0].rstrip()
 
         # check for line continuation
         if content.endswith("\\"):
-            new_tokens = tokenize_line(content[:-1], lineno)
-            logical_tokens.extend(new_tokens)
-            if new_tokens:
-                in_continuation = True
-        else:
-            logical_tokens.extend(tokenize_line(content, lineno))
-            if logical_tokens:
-                logical_lines.append(logical_tokens)
-            logical_tokens  = []
-            in_continuation = False
+            continued.extend(tokenize_line(content[:-1], lineno))
+            continue
+        tokens = tokenize_line(content, lineno)
+        if continued:
+            continued.extend(tokens)
+            tokens = continued
+            continued = []
+        if tokens:
+            logical_lines.append(tokens)
 
     # end of input
-    if in_continuation:
+    if continued:
         ctx.error("unexpected end of file after line continuation",
-                  lineno=lineno, column=OMIT)
+                  lineno=len(lines), column=OMIT)
     return logical_lines
 
 
@@ -515,8 +550,9 @@ def parse_blocs(lines: list[str], design: Design) -> bool:
     Expects an active ErrorContext (pushed by read_source_xxx()).
     Returns None if any errors were reported.
     """
-    for tokens in lex_lines(lines):
-        parse_command(tokens, design)
+    with collector_paused():
+        for tokens in lex_lines(lines):
+            parse_command(tokens, design)
     return True  if ctx.no_errors() else False
 
 
@@ -0,0 +1,232 @@
+# blocs_pools.py
+# Counts what building a Design at run time takes from the memory pools.
+#
+# The core library allocates everything it builds from two pools, the
+# RT pool and the meta pool (see emblocs_priv.h), and never frees any
+# of it.  So the space a system needs is fixed by what it contains:
+#
+#   RT pool    block data, a dummy signal for every pin, every signal,
+#              realtime data for every function and thread, a dispatch
+#              table for every thread, and the signals that
+#              bl_thread_layout() moves
+#   meta pool  metadata for every block, pin, function, signal and
+#              thread, and with EBL_NAME_INDEX the hash index slots
+#
+# The sizes of most of those objects depend on the configuration in
+# emblocs_config.h, so they are left to the C compiler: the system
+# compiler writes the counts into <system>_pools.h, and emblocs_priv.h
+# multiplies them by sizeof() of the structs.  The index widths in the
+# metadata bitfields follow from the sizes, as they always have.  The
+# byte counts here are for the base configuration, with none of the
+# optional features; they are for the report only.
+#
+# Block data is the instance struct of each block's variant, which the
+# system compiler only knows as C declarations.  Pins are pointers, and
+# vars of the usual scalar types are sized here; anything else is
+# assumed to be one word, and reported.
+
+from __future__ import annotations
+from dataclasses import dataclass, field
+import math
+import re
+
+from emblocs import Design, BlockDef, FieldDef
+
+
+# sizes in the base configuration of a 32-bit target
+SIG_DATA_SIZE = 4
+FUNCTION_RTDATA_SIZE = 12
+THREAD_DATA_SIZE = 24
+DISPATCH_ENTRY_SIZE = 8
+BLOCK_META_SIZE = 24
+PIN_META_SIZE = 12
+FUNCTION_META_SIZE = 12
+SIGNAL_META_SIZE = 12
+THREAD_META_SIZE = 12
+INDEX_SLOT_SIZE = 4
+
+# the hash index starts this big, and doubles when 3/4 full
+NAME_INDEX_MIN_SLOTS = 16
+
+# (size, alignment) of var types
+VAR_TYPES: dict[str, tuple[int, int]] = {
+    "char": (1, 1), "bool": (1, 1), "_Bool": (1, 1),
+    "int8_t": (1, 1), "uint8_t": (1, 1),
+    "short": (2, 2), "int16_t": (2, 2), "uint16_t": (2, 2),
+    "int": (4, 4), "unsigned": (4, 4), "long": (4, 4), "float": (4, 4),
+    "int32_t": (4, 4), "uint32_t": (4, 4), "size_t": (4, 4),
+    "bl_float_t": (4, 4), "bl_bit_t": (4, 4), "bl_s32_t": (4, 4), "bl_u32_t": (4, 4),
+    "double": (8, 8), "int64_t": (8, 8), "uint64_t": (8, 8),
+}
+
+_DECL = re.compile(r"^(?P<type>[\w\s]+?)\s*(?P<ptr>\*+)?\s*(?P<name>\w+)\s*(?P<dims>(\[\s*\d+\s*\])*)\s*;")
+
+
+@dataclass
+class PoolCounts:
+    """
+    The objects that building a Design takes from the pools.
+
+    Fields:
+        blocks         -- blocks
+        pins           -- pins, each of which also has a dummy signal
+        functions      -- functions, whether in a thread or not
+        signals        -- signals
+        threads        -- threads
+        table_entries  -- dispatch table entries, one per function in a
+                          thread and one per thread for the terminator
+        layout_signals -- signals moved by bl_thread_layout(), called for
+                          each thread, fastest first
+        index_slots    -- hash index slots, with EBL_NAME_INDEX
+        block_data     -- bytes of block data, each block rounded up to
+                          a whole word
+        guessed        -- vars whose size is a guess, as 'variant.var'
+    """
+    blocks:         int = 0
+    pins:           int = 0
+    functions:      int = 0
+    signals:        int = 0
+    threads:        int = 0
+    table_entries:  int = 0
+    layout_signals: int = 0
+    index_slots:    int = 0
+    block_data:     int = 0
+    guessed:        list[str] = field(default_factory=list)
+
+    @property
+    def rt_bytes(self) -> int:
+        return (self.block_data
+                + (self.pins + self.signals + self.layout_signals) * SIG_DATA_SIZE
+                + self.functions * FUNCTION_RTDATA_SIZE
+                + self.threads * THREAD_DATA_SIZE
+                + self.table_entries * DISPATCH_ENTRY_SIZE)
+
+    @property
+    def meta_bytes(self) -> int:
+        return (self.blocks * BLOCK_META_SIZE
+                + self.pins * PIN_META_SIZE
+                + self.functions * FUNCTION_META_SIZE
+                + self.signals * SIGNAL_META_SIZE
+                + self.threads * THREAD_META_SIZE)
+
+
+def var_size(c_decl: str) -> tuple[int, int] | None:
+    """
+    Returns the size and alignment of the var declared by 'c_decl', or
+    None if its type isn't known.
+    """
+    m = _DECL.match(c_decl.strip())
+    if m is None:
+        return None
+    count = math.prod(int(d) for d in re.findall(r"\d+", m.group("dims")))
+    if m.group("ptr"):
+        return 4 * count, 4
+    words = m.group("type").split()
+    words = [w for w in words if w not in ("const", "volatile", "signed")]
+    c_type = " ".join(words)
+    if c_type in ("unsigned int", "unsigned long", "long int"):
+        c_type = "int"
+    elif c_type in ("unsigned char",):
+        c_type = "char"
+    elif c_type in ("unsigned short",):
+        c_type = "short"
+    if c_type not in VAR_TYPES:
+        return None
+    size, align = VAR_TYPES[c_type]
+    return size * count, align
+
+
+def _field_size(field: FieldDef, guessed: list[str], variant: str) -> tuple[int, int]:
+    if field.pin_type is not None:
+        return 4 * math.prod(field.dims), 4
+    size = var_size(field.c_decl)
+    if size is None:
+        guessed.append(f"{variant}.{field.name}")
+        return 4, 4
+    return size
+
+
+def struct_size(members: list[tuple[int, int]]) -> int:
+    """ sizeof() of a struct of members of these (size, alignment), as the C compiler lays it out """
+    offset = 0
+    struct_align = 4 if members else 1
+    for size, align in members:
+        offset = (offset + align - 1) // align * align + size
+        struct_align = max(struct_align, align)
+    return (offset + struct_align - 1) // struct_align * struct_align
+
+
+def block_data_size(block_def: BlockDef, guessed: list[str], flash_pins: bool = False) -> int:
+    """
+    sizeof() of the instance struct of 'block_def', as the C compiler lays
+    it out.  With 'flash_pins', the pins are replaced by one pointer to
+    their table, as blockdef_as_h_variant() declares it.
+    """
+    fields = block_def.ordered_fields
+    members = []
+    if flash_pins and any(field.pin_type is not None for field in fields):
+        members.append((4, 4))
+        fields = [field for field in fields if field.pin_type is None]
+    for field in fields:
+        members.append(_field_size(field, guessed, block_def.name))
+    return struct_size(members)
+
+
+def pin_table_size(block_def: BlockDef) -> int:
+    """ sizeof() of the <variant>_pins_t that --flash-pins puts in flash """
+    return struct_size([_field_size(field, [], block_def.name)
+                        for field in block_def.ordered_fields if field.pin_type is not None])
+
+
+def _index_slots(count: int) -> int:
+    # every table the index has outgrown stays allocated
+    size = used = total = 0
+    for _ in range(count):
+        if (used + 1) * 4 > size * 3:
+            size = size * 2 if size else NAME_INDEX_MIN_SLOTS
+            total += size
+        used += 1
+    return total
+
+
+def _layout_signals(design: Design) -> int:
+    # each call moves every signal and dummy connected to a block in its
+    # thread to the end of the pool, unless an earlier call for a faster
+    # thread moved it already
+    moved = 0
+    done: set[int] = set()
+    for thread in sorted(design.threads.values(), key=lambda t: t.period_ns):
+        for func in thread.functions:
+            for pin in func.block.pins.values():
+                key = id(pin) if pin.signal.is_dummy else id(pin.signal)
+                if key not in done:
+                    done.add(key)
+                    moved += 1
+    return moved
+
+
+def count_pools(design: Design) -> PoolCounts:
+    """ Count what building 'design' at run time takes from the pools. """
+    counts = PoolCounts()
+    counts.blocks = len(design.blocks)
+    counts.signals = len(design.signals)
+    counts.threads = len(design.threads)
+    sizes: dict[str, int] = {}
+    for block in design.blocks.values():
+        counts.pins += len(block.pins)
+        counts.functions += len(block.functions)
+        name = block.block_def.name
+        if name not in sizes:
+            sizes[name] = block_data_size(block.block_def, counts.guessed)
+        counts.block_data += (sizes[name] + 3) // 4 * 4
+    for thread in design.threads.values():
+        counts.table_entries += len(thread.functions) + 1
+    counts.layout_signals = _layout_signals(design)
+    counts.index_slots = (_index_slots(counts.blocks) + _index_slots(counts.signals)
+                          + _index_slots(counts.threads))
+    return counts
+
+
+def index_bits(pool_bytes: int) -> int:
+    """ The width of an index into a pool of 'pool_bytes', as BITS2STORE() computes it """
+    return max((pool_bytes // 4) - 1, 1).bit_length()
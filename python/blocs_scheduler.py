@@ -0,0 +1,139 @@
+# blocs_scheduler.py
+# Plans the multi-rate scheduler for a Design.
+#
+# The generated <system>_tick() function is called from one timer
+# interrupt at the base rate, which is the period of the fastest
+# thread.  Every thread whose period is an integer multiple of the
+# base runs once every 'divisor' ticks, starting at tick 'phase'.
+# Phases are chosen so the slow threads are spread across the ticks
+# instead of all landing on tick zero; the goal is to minimize the
+# load of the busiest tick, since that sets the worst-case latency.
+# Threads on different cores run from separate tick functions and
+# don't compete, so each core is balanced on its own.
+#
+# Balancing looks at every tick of the hyperperiod, the least common
+# multiple of the divisors, which grows quickly when they share no
+# factors (7, 11, 13 and 17 make 17017).  Above MAX_HYPERPERIOD ticks
+# the phases are all left at zero, with a warning.
+
+from __future__ import annotations
+from dataclasses import dataclass, field
+from math import lcm
+
+from emblocs import Design, Thread, FunctInstance
+from parse_common import ctx, OMIT
+
+# the longest hyperperiod, in ticks, that is balanced
+MAX_HYPERPERIOD = 10000
+
+
+@dataclass
+class ScheduleEntry:
+    """
+    One thread in a Schedule.
+
+    Fields:
+        thread  -- the Thread
+        divisor -- thread period in base ticks
+        phase   -- first tick on which the thread runs, 0 <= phase < divisor
+        cost    -- estimated cost of one run of the thread
+    """
+    thread:  Thread
+    divisor: int
+    phase:   int = 0
+    cost:    int = 0
+
+
+@dataclass
+class Schedule:
+    """
+    The scheduler plan for a Design.
+
+    Fields:
+        base_ns  -- base tick period in nanoseconds
+        entries  -- scheduled threads, in Design order
+        loads    -- estimated load of each tick over one hyperperiod,
+                    or its first MAX_HYPERPERIOD ticks if it is longer,
+                    on the busiest core for that tick
+    """
+    base_ns: int
+    entries: list[ScheduleEntry] = field(default_factory=list)
+    loads:   list[int] = field(default_factory=list)
+
+    @property
+    def peak(self) -> int:
+        return max(self.loads, default=0)
+
+
+def funct_cost(func: FunctInstance) -> int:
+    """
+    Estimated cost of one call to 'func', in cycles, as plan_budget()
+    found it.  A function with no cost counts as one cycle; when none
+    have one, that still balances threads by the number of functions.
+    """
+    return func.cycles if func.cycles is not None else 1
+
+
+def thread_cost(thread: Thread) -> int:
+    return sum(funct_cost(func) for func in thread.functions)
+
+
+def _place(loads: list[int], divisor: int, phase: int, cost: int) -> None:
+    for tick in range(phase, len(loads), divisor):
+        loads[tick] += cost
+
+
+def _best_phase(loads: list[int], divisor: int, cost: int) -> int:
+    """
+    Returns the phase that minimizes the resulting peak load.  Ties go
+    to the phase with the least total load on the ticks it uses, then
+    to the lowest phase, so the result is deterministic.
+    """
+    best_key = None
+    best_phase = 0
+    for phase in range(divisor):
+        ticks = loads[phase::divisor]
+        key = (max(ticks) + cost, sum(ticks))
+        if best_key is None or key < best_key:
+            best_key = key
+            best_phase = phase
+    return best_phase
+
+
+def plan_schedule(design: Design) -> Schedule | None:
+    """
+    Plan the scheduler for 'design'.  Returns None if the design has
+    no threads.  Threads whose period is not a multiple of the base
+    period are left out of the schedule, with a warning; they can
+    still be called from their own timer.
+    """
+    if not design.threads:
+        return None
+    threads = list(design.threads.values())
+    base_ns = min(thread.period_ns for thread in threads)
+    schedule = Schedule(base_ns)
+    for thread in threads:
+        if thread.period_ns % base_ns:
+            ctx.warning(f"thread {thread.name!r} period {thread.period_ns} ns"
+                        f" is not a multiple of base period {base_ns} ns;"
+                        f" not scheduled", lineno=OMIT, column=OMIT)
+            continue
+        schedule.entries.append(ScheduleEntry(thread, thread.period_ns // base_ns,
+                                              cost=thread_cost(thread)))
+    hyperperiod = lcm(*(entry.divisor for entry in schedule.entries))
+    balance = hyperperiod <= MAX_HYPERPERIOD
+    if not balance:
+        ctx.warning(f"scheduler: hyperperiod of {hyperperiod} ticks is over {MAX_HYPERPERIOD};"
+                    f" every thread starts on tick 0", lineno=OMIT, column=OMIT)
+    ticks = min(hyperperiod, MAX_HYPERPERIOD)
+    core_loads = {entry.thread.core: [0] * ticks for entry in schedule.entries}
+    # place the most expensive threads first, like packing the big
+    # items first; faster threads first among equals, since they
+    # have fewer phases to choose from
+    for entry in sorted(schedule.entries, key=lambda e: (-e.cost, e.divisor)):
+        loads = core_loads[entry.thread.core]
+        if balance:
+            entry.phase = _best_phase(loads, entry.divisor, entry.cost)
+        _place(loads, entry.divisor, entry.phase, entry.cost)
+    schedule.loads = [max(tick) for tick in zip(*core_loads.values())]
+    return schedule
@@ -37,6 +37,9 @@ U32_MAX =  0xFFFFFFFF
 S32_MAX =  0x7FFFFFFF
 S32_MIN = -0x80000000
 
+# number of cores that threads can be assigned to (RP2040 has two)
+CORE_COUNT = 2
+
 # ---------------------------------------------------------------------------
 # Output formatting for __str__() methods
 # ---------------------------------------------------------------------------
@@ -54,6 +57,9 @@ def _format_descr(descr: str) -> str:
         return ""
     return descr_prefix + textwrap.indent(descr, "  # ")
 
+def _format_costs(costs: tuple[tuple[str, str | int], ...]) -> str:
+    return "".join(f"  cost{'.' + target if target else ''}={cost}" for target, cost in costs)
+
 def _indent_child(child_str: str) -> str:
     return textwrap.indent(child_str, "  ")
 
@@ -238,14 +244,22 @@ class FunctSpec:
         name        -- EMBLOCS-visible function name (e.g. "update", "read")
         dedup_name  -- name + '_', used for namespace collision detection
         description -- /// annotation text, or empty string if none
+        on_change   -- True if the function may be skipped when its inputs
+                       have not changed
+        costs       -- (target, expression) pairs giving the cycles one call
+                       takes; target is "" for the cost of any other target
     """
     name:        str
     dedup_name:  str
     description: str = ""
+    on_change:   bool = False
+    costs:       tuple[tuple[str, str], ...] = ()
 
     def __str__(self) -> str:
         desc = _format_descr(self.description)
-        return f"function  {self.name}{desc}"
+        attr = "  on_change" if self.on_change else ""
+        attr += _format_costs(self.costs)
+        return f"function  {self.name}{attr}{desc}"
 
 
 @dataclass(frozen=True)
@@ -406,13 +420,25 @@ class FunctDef:
     Fields:
         name        -- EMBLOCS-visible function name (e.g. "update")
         description -- /// annotation text, or empty string if none
+        on_change   -- True if the function may be skipped when its inputs
+                       have not changed
+        costs       -- (target, cycles) pairs, as in FunctSpec, evaluated
     """
     name:        str
     description: str = ""
+    on_change:   bool = False
+    costs:       tuple[tuple[str, int], ...] = ()
 
     def __str__(self) -> str:
         desc = _format_descr(self.description)
-        return f"function  {self.name}{desc}"
+        attr = "  on_change" if self.on_change else ""
+        attr += _format_costs(self.costs)
+        return f"function  {self.name}{attr}{desc}"
+
+    def cost(self, target: str = "") -> int | None:
+        """ cycles per call on 'target', or None if the .bloc doesn't say """
+        costs = dict(self.costs)
+        return costs.get(target, costs.get(""))
 
 BlockDefChild = PinDef | FunctDef
 
@@ -470,6 +496,22 @@ class BlockDef:
             lines.append(_indent_child(str(f)))
         return "\n".join(lines)
 
+    def function_pins(self, funct_name: str) -> list[PinDef]:
+        """
+        Returns the pins associated with a function, in declaration
+        order: pins declared before the first function are shared by
+        all functions, and the rest belong to the function declared
+        before them.
+        """
+        pins = []
+        current = None
+        for obj in self.namespace.values():
+            if isinstance(obj, FunctDef):
+                current = obj.name
+            elif current is None or current == funct_name:
+                pins.append(obj)
+        return pins
+
 # ---------------------------------------------------------------------------
 # Design-level classes
 # These are produced by parsing a .blocs file.  A Design is a complete,
@@ -514,13 +556,16 @@ class Thread:
         name      -- thread name, unique within the Design namespace
         period_ns -- execution period in nanoseconds
         functions -- ordered list of FunctInstance objects
+        core      -- core that runs the thread
     """
     name:      str
     period_ns: int
     functions: list[FunctInstance] = field(default_factory=list)
+    core:      int = 0
 
     def __str__(self) -> str:
-        lines = [f"thread  {self.name}  ({self.period_ns} ns)"]
+        core = f", core {self.core}" if self.core else ""
+        lines = [f"thread  {self.name}  ({self.period_ns} ns{core})"]
         for func in self.functions:
             lines.append(f"  {func.full_name}")
         return "\n".join(lines)
@@ -571,10 +616,13 @@ class FunctInstance:
         funct_def -- FunctDef metadata (name, description)
         thread    -- Thread this function is assigned to, or None
         block     -- back-reference to parent block
+        cycles    -- cycles per call, annotated or measured, as set by
+                     plan_budget(); None if unknown
     """
     funct_def: FunctDef
     thread:    Thread | None = None
     block:     BlockInstance | None = None
+    cycles:    int | None = None
 
     def __str__(self) -> str:
         thr = self.thread.name if self.thread else "unassigned"
@@ -584,6 +632,12 @@ class FunctInstance:
     def full_name(self) -> str:
         return f"{self.block.name}.{self.funct_def.name}"
 
+    @property
+    def pins(self) -> list[PinInstance]:
+        """ the pins of the block that this function uses """
+        return [self.block.pins[pin_def.name]
+                for pin_def in self.block.block_def.function_pins(self.funct_def.name)]
+
 BlockInstChild = PinInstance | FunctInstance
 
 @dataclass
@@ -734,42 +788,29 @@ class Design:
             raise EmblocsError(f"name {instance_name!r} is already in use")
         if block_def_name not in self.block_defs:
             raise EmblocsError(f"unknown block definition {block_def_name!r}")
-        # generate component parts
+        # generate instance; this runs for every block of the design, so
+        # each pin gets its back-reference and dummy signal as it is made
         block_def = self.block_defs[block_def_name]
-        pins = {}
-        functions = {}
-        namespace = {}
+        instance = BlockInstance(name=instance_name, block_def=block_def)
+        pins = instance.pins
+        namespace = instance.namespace
+        dummy_signals = self.dummy_signals
         for name, pd in block_def.pins.items():
-            pin = PinInstance(pin_def=pd)
-            pins[name] = pin
-            namespace[name] = pin
-        for name, fd in block_def.functions.items():
-            funct = FunctInstance(funct_def=fd)
-            functions[name] = funct
-            namespace[name] = funct
-        # generate instance
-        instance = BlockInstance(
-            name      = instance_name,
-            block_def = block_def,
-            pins      = pins,
-            functions = functions,
-            namespace  = namespace,
-        )
-        # set back-reference and dummy signal for each pin
-        for pin_name, pin in instance.pins.items():
-            pin.block = instance
-            dummy_name = pin.dummy_name
+            pin_type = pd.pin_type
+            dummy_name = f"dsig_{instance_name}_{pd.name}"
             dummy = Signal(
                 name     = dummy_name,
-                sig_type = pin.pin_type if pin.pin_type != PinType.RAW
-                        else PinType.U32,
+                sig_type = pin_type if pin_type != PinType.RAW else PinType.U32,
                 is_dummy = True,
             )
-            self.dummy_signals[dummy_name] = dummy
-            pin.signal = dummy
-        # set back reference for each function
-        for func_name, func in instance.functions.items():
-            func.block = instance
+            dummy_signals[dummy_name] = dummy
+            pin = PinInstance(pin_def=pd, signal=dummy, block=instance)
+            pins[name] = pin
+            namespace[name] = pin
+        for name, fd in block_def.functions.items():
+            funct = FunctInstance(funct_def=fd, block=instance)
+            instance.functions[name] = funct
+            namespace[name] = funct
         # add to design
         self.blocks[instance_name] = instance
         self.namespace[instance_name] = instance
@@ -807,6 +848,15 @@ class Design:
         self.namespace[name] = thread
         return thread
 
+    def set_thread_core(self, thread: Thread, core: int) -> None:
+        """
+        Assign a thread to a core.
+        Raises EmblocsError if the core number is invalid.
+        """
+        if not 0 <= core < CORE_COUNT:
+            raise EmblocsError(f"core must be 0 to {CORE_COUNT - 1}, got {core}")
+        thread.core = core
+
     def _validate_and_set_value(self, signal: Signal, value: int | float) -> None:
         """
         Validate value against signal type and set it.
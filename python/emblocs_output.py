@@ -12,7 +12,7 @@ from emblocs import (
     EmblocsError,
     Design, DesignObject,
     BlockDef, FieldDef, FunctDef, Signal, Thread,
-    PinType,
+    PinType, PinDir,
     BlockInstance, PinInstance, FunctInstance,
     BlockSpec, ParamSpec, PinSpec, VarDef, FunctSpec,
 )
@@ -22,8 +22,17 @@ from blocs_parser import parse_blocs_file
 from parse_common import ctx
 
 import sys
+import json
 from pathlib import Path
 from operator import attrgetter
+from collections.abc import Collection
+
+from blocs_scheduler import Schedule, ScheduleEntry
+from blocs_mailboxes import Routing, Mailbox, local_copy_name
+from blocs_changes import ChangePlan, ChangeCheck
+from blocs_constants import ConstantPlan
+from blocs_pools import PoolCounts, index_bits
+from blocs_footprint import Footprint
 
 
 TYPE_LABELS = {
@@ -71,6 +80,8 @@ def thread_as_blocs(lines: list[str], thread: Thread ) -> None:
     fields.append(f"thread")
     fields.append(f"{thread.name}")
     fields.append(f"{str(thread.period_ns)}")
+    if thread.core:
+        fields.append(f"@{thread.core}")
     for funct in thread.functions:
         fields.append(f"+{funct.full_name}")
     lines.append(" ".join(fields))
@@ -102,6 +113,14 @@ SIG_C_TYPES = {
     PinType.FLOAT: "bl_float_t",
 }
 
+# member of bl_sig_data_t for each signal type
+SIG_DATA_MEMBERS = {
+    PinType.BOOL:  "b",
+    PinType.U32:   "u",
+    PinType.S32:   "s",
+    PinType.FLOAT: "f",
+}
+
 def _make_index_vars(n: int) -> tuple[str, ...]:
     """Generate index variable names i, j, k, ... for n dimensions."""
     return tuple(chr(ord('i') + k) for k in range(n))
@@ -218,6 +237,9 @@ def functspec_as_stub(lines: list[str], functspec: FunctSpec, blockspec: BlockSp
     lines.append(f"    (void)periodns;  // delete this line if periodns is used")
     lines.append(f"")
     lines.append(f"    // TODO: implement {functspec.name}")
+    if functspec.on_change:
+        lines.append(f"    // on_change: may be skipped while no input pin has changed, so the")
+        lines.append(f"    // outputs must depend only on the inputs, not on time or state")
     lines.append(f"    // Pin macros available:")
     active_conditions = []
     for stmt in blockspec.statements:
@@ -273,21 +295,26 @@ def fielddef_as_instance_member(lines: list[str], field: FieldDef) -> None:
         dim_str = "".join(f"[{d}]" for d in field.dims)
         lines.append(f"    {c_type} {field.name}{dim_str};")
 
-def fielddef_as_macro(lines: list[str], field: FieldDef) -> None:
+def fielddef_as_macro(lines: list[str], field: FieldDef, base: str = "self->") -> None:
     macro_name = field.name.upper()
-    lines.append(f"#define p{macro_name}  (self->{field.name})")
+    lines.append(f"#define p{macro_name}  ({base}{field.name})")
     if not field.dims:
-        lines.append(f"#define {macro_name}  (*self->{field.name})")
+        lines.append(f"#define {macro_name}  (*{base}{field.name})")
     else:
         vars = _make_index_vars(len(field.dims))
         args = ", ".join(vars)
         indices = "".join(f"[{v}]" for v in vars)
-        lines.append(f"#define {macro_name}({args})  (*(self->{field.name}{indices}))")
+        lines.append(f"#define {macro_name}({args})  (*({base}{field.name}{indices}))")
 
 def functdef_as_prototype(lines: list[str], funct: FunctDef, prefix: str) -> None:
     lines.append(f"void {prefix}_{funct.name}(void *instance_data, uint32_t periodns);")
 
-def blockdef_as_h_variant(lines: list[str], blockdef: BlockDef) -> None:
+def blockdef_as_h_variant(lines: list[str], blockdef: BlockDef, flash_pins: bool = False) -> None:
+    '''
+    With 'flash_pins', the pin pointers go in a separate <variant>_pins_t,
+    which the system file places in flash, and the instance struct holds
+    a pointer to it ahead of the vars; the pin macros follow the pointer.
+    '''
     block_name = blockdef.name
     guard = block_name.upper() + "_H"
     # header comment
@@ -308,15 +335,25 @@ def blockdef_as_h_variant(lines: list[str], blockdef: BlockDef) -> None:
         lines.append(f'#include {include}')
     lines.append(f"")
     # instance struct — no #if blocks, no BL_ symbols, all concrete
+    pin_fields = [field for field in blockdef.ordered_fields if field.pin_type is not None]
+    flash_pins = flash_pins and bool(pin_fields)
+    if flash_pins:
+        lines.append(f"typedef struct {{")
+        for field in pin_fields:
+            fielddef_as_instance_member(lines, field)
+        lines.append(f"}} {block_name}_pins_t;")
+        lines.append(f"")
     lines.append(f"typedef struct {{")
+    if flash_pins:
+        lines.append(f"    {block_name}_pins_t const *pins;")
     for field in blockdef.ordered_fields:
-        fielddef_as_instance_member(lines, field)
+        if not flash_pins or field.pin_type is None:
+            fielddef_as_instance_member(lines, field)
     lines.append(f"}} {block_name}_t;")
     lines.append(f"")
     # convenience macros
-    for field in blockdef.ordered_fields:
-        if field.pin_type is not None:
-            fielddef_as_macro(lines, field)
+    for field in pin_fields:
+        fielddef_as_macro(lines, field, "self->pins->" if flash_pins else "self->")
     lines.append(f"")
     # function prototypes
     if blockdef.functions:
@@ -349,48 +386,231 @@ def blockdef_as_c_variant_preamble(lines: list[str], blockdef: BlockDef) -> None
     # variant header include
     lines.append(f'#include "{blockdef_name}.h"')
 
-def blockdef_as_c_variant(lines: list[str], blockdef: BlockDef) -> None:
-    ''' lines should be the lines of the <block>.c file '''
+def _strip_c_template(lines: list[str], blockdef: BlockDef) -> str:
+    '''
+    Deletes everything up to and including the sentinel line from the
+    lines of the <block>.c file, and returns a #line directive that
+    points at the first line left.
+    '''
     for i, line in enumerate(lines):
         if line.rstrip() == C_SENTINEL:
             del lines[0:i+1]
-            preamble = []
-            blockdef_as_c_variant_preamble(preamble, blockdef)
-            preamble.append(f'#line {i+2} "{Path(blockdef.abs_path).with_suffix(".c").as_posix()}"')
-            lines[0:0] = preamble
-            return
+            return f'#line {i+2} "{Path(blockdef.abs_path).with_suffix(".c").as_posix()}"'
     raise EmblocsError(f"sentinel line not found in {Path(blockdef.abs_path).with_suffix(".c")}")
 
-def design_as_cmake(lines: list[str], design: Design) -> None:
+def blockdef_as_c_variant(lines: list[str], blockdef: BlockDef) -> None:
+    ''' lines should be the lines of the <block>.c file '''
+    line_directive = _strip_c_template(lines, blockdef)
+    preamble = []
+    blockdef_as_c_variant_preamble(preamble, blockdef)
+    preamble.append(line_directive)
+    lines[0:0] = preamble
+
+def direct_blocks(design: Design) -> list[BlockInstance]:
+    """ Returns the blocks that get a direct_<block>.c, in design order. """
+    threaded = {id(func.block) for thread in design.threads.values()
+                for func in thread.functions}
+    return [block for block in design.blocks.values() if id(block) in threaded]
+
+
+def direct_function_name(func: FunctInstance) -> str:
+    return f"{func.block.block_def.name}_{func.funct_def.name}_{func.block.name}"
+
+
+def _direct_pin(pin: PinInstance | None, targets: dict[int, str] | None = None,
+                folded: Collection[int] = ()) -> str:
+    # address of the variable, as a pin of the right type
+    if pin is None:
+        return "NULL"
+    if pin.pin_type != pin.signal.sig_type or id(pin.signal) in folded:
+        return f"({PIN_C_TYPES[pin.pin_type]})&{_pin_variable(pin, targets)}"
+    return f"&{_pin_variable(pin, targets)}"
+
+
+def _literal(signal: Signal) -> str:
+    return f"(({SIG_C_TYPES[signal.sig_type]}){signal.value})"
+
+
+def block_as_c_direct(lines: list[str], block: BlockInstance,
+                      targets: dict[int, str] | None = None,
+                      folded: Collection[int] = ()) -> None:
+    '''
+    lines should be the lines of the <block>.c file.  Turns them into
+    direct_<block>.c, a copy of the block's functions for this instance
+    only: 'self' is the instance struct itself and every pin macro names
+    the signal it is connected to, so the compiler can address them
+    directly instead of loading pin pointers from the struct.  Scalar
+    input pins that read one of the 'folded' constant signals (keyed by
+    id() of the Signal) become literals.
+    '''
+    blockdef = block.block_def
+    variant = blockdef.name
+    line_directive = _strip_c_template(lines, blockdef)
+    mangled = f"direct_{block.name}"
+    preamble = []
+    # header comment
+    preamble.append(f"// Auto-generated by the EMBLOCS block compiler. Do not edit.")
+    preamble.append(f"// Source: {blockdef.orig_path}")
+    preamble.append(f"// Variant: {variant}")
+    preamble.append(f"// Instance: {block.name}")
+    preamble.append(f"")
+    preamble.append(f'#include <emblocs_comp.h>')
+    preamble.append(f"")
+    preamble.append(f"#define BL_BLOCK_NAME {mangled}")
+    preamble.append(f"")
+    if blockdef.params:
+        for name, value in blockdef.params.items():
+            preamble.append(f"#define {name} ({value})")
+        preamble.append(f"")
+    preamble.append(f'#include "{variant}.h"')
+    preamble.append(f"")
+    preamble.append(f"typedef {variant}_t {mangled}_t;")
+    preamble.append(f"")
+    # the instance and the variables its pins are connected to
+    preamble.append(f"extern {variant}_t blk_{block.name};")
+    declared = set()
+    for pin in block.pins.values():
+        target = _pin_variable(pin, targets)
+        if target not in declared:
+            declared.add(target)
+            const = " const" if id(pin.signal) in folded else ""
+            preamble.append(f"extern {SIG_C_TYPES[pin.signal.sig_type]}{const} {target};")
+    preamble.append(f"")
+    # pin macros that name those variables; array pins index a
+    # constant table instead of the struct
+    fields: dict[str, list[PinInstance]] = {}
+    for pin in block.pins.values():
+        fields.setdefault(pin.pin_def.field.name, []).append(pin)
+    for field in blockdef.ordered_fields:
+        if field.pin_type is None:
+            continue
+        macro_name = field.name.upper()
+        pins = fields.get(field.name, [])
+        preamble.append(f"#undef p{macro_name}")
+        preamble.append(f"#undef {macro_name}")
+        if not field.dims:
+            pin = pins[0] if pins else None
+            preamble.append(f"#define p{macro_name}  ({_direct_pin(pin, targets, folded)})")
+            if pin and id(pin.signal) in folded and pin.pin_type == pin.signal.sig_type:
+                preamble.append(f"#define {macro_name}  {_literal(pin.signal)}")
+            else:
+                preamble.append(f"#define {macro_name}  (*p{macro_name})")
+        else:
+            table = f"{mangled}_{field.name}"
+            pin_map = {pin.pin_def.field_indices: pin for pin in pins}
+            dim_str = "".join(f"[{d}]" for d in field.dims)
+            preamble.append(f"static {PIN_C_TYPES[field.pin_type]} const {table}{dim_str} = {{")
+            if len(field.dims) == 1:
+                for i in range(field.dims[0]):
+                    preamble.append(f"    {_direct_pin(pin_map.get((i,)), targets, folded)},")
+            else:
+                for i in range(field.dims[0]):
+                    preamble.append(f"    {{")
+                    for j in range(field.dims[1]):
+                        preamble.append(f"        {_direct_pin(pin_map.get((i, j)), targets, folded)},")
+                    preamble.append(f"    }},")
+            preamble.append(f"}};")
+            vars = _make_index_vars(len(field.dims))
+            args = ", ".join(vars)
+            indices = "".join(f"[{v}]" for v in vars)
+            preamble.append(f"#define p{macro_name}  ({table})")
+            preamble.append(f"#define {macro_name}({args})  (*({table}{indices}))")
+    preamble.append(f"")
+    # raw pins read and write signals of other types, like they do
+    # through pointers in the variant; and the functions still set
+    # 'self' even when only pins use it
+    if any(pin.pin_type != pin.signal.sig_type for pin in block.pins.values()):
+        preamble.append(f'#pragma GCC optimize ("no-strict-aliasing")')
+    preamble.append(f'#pragma GCC diagnostic ignored "-Wunused-variable"')
+    preamble.append(f"")
+    # the block's functions become inline, so each one folds into
+    # the wrapper that calls it for this instance
+    for funct in blockdef.functions.values():
+        preamble.append(f"static inline __attribute__((always_inline))")
+        preamble.append(f"void {mangled}_{funct.name}(void *instance_data, uint32_t periodns);")
+    preamble.append(line_directive)
+    lines[0:0] = preamble
+    # the functions that threads call
+    for func in block.functions.values():
+        if func.thread is None:
+            continue
+        lines.append(f"")
+        lines.append(f"void {direct_function_name(func)}(uint32_t periodns) {{")
+        lines.append(f"    {mangled}_{func.funct_def.name}(&blk_{block.name}, periodns);")
+        lines.append(f"}}")
+
+
+def design_as_cmake(lines: list[str], design: Design, direct: bool = False,
+                    amalgamated: Collection[str] = ()) -> None:
     stem = Path(design.abs_path).stem
     lines.append(f"# Auto-generated from {stem}.blocs - Do not edit.")
     lines.append(f"")
     lines.append(f"target_sources(${{TARGET}} PRIVATE")
-    bloc_paths = set()
-    for name, block_def in design.block_defs.items():
+    for name in design.block_defs:
         lines.append(f"    ${{CMAKE_BINARY_DIR}}/{name}.c")
-        bloc_paths.add(block_def.abs_path)
+    if direct:
+        for block in direct_blocks(design):
+            lines.append(f"    ${{CMAKE_BINARY_DIR}}/direct_{block.name}.c")
+    for name in amalgamated:
+        lines.append(f"    ${{CMAKE_BINARY_DIR}}/{stem}_{name}.c")
     lines.append(f"    ${{CMAKE_BINARY_DIR}}/{stem}.c")
     lines.append(f")")
     lines.append(f"")
-    lines.append(f"set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS")
-    for bloc_path in sorted(bloc_paths):
-        p = Path(bloc_path)
-        lines.append(f"    {bloc_path}")
-        lines.append(f"    {p.with_suffix('.c').as_posix()}")
-        lines.append(f"    {p.with_suffix('.h').as_posix()}")
+    # everything the system compiler writes, for the build rule in
+    # emblocs.cmake; CMake reconfigures only when this file changes
+    lines.append(f"set(BLOCS_OUTPUTS")
+    for name in design.block_defs:
+        lines.append(f"    {name}.h")
+        lines.append(f"    {name}.c")
+    if direct:
+        for block in direct_blocks(design):
+            lines.append(f"    direct_{block.name}.c")
+    for name in amalgamated:
+        lines.append(f"    {stem}_{name}.c")
+    lines.append(f"    {stem}.h")
+    lines.append(f"    {stem}.c")
+    lines.append(f"    {stem}_pools.h")
     lines.append(f")")
     lines.append(f"")
 
 
-def signal_as_c_system(lines: list[str], signal: Signal) -> None:
+def design_sources(design: Design) -> list[Path]:
+    """
+    Returns every file the system compiler reads for 'design': the
+    .blocs file, and the .bloc, .c and .h of each blockdef.
+    """
+    paths = [Path(design.abs_path)]
+    for bloc_path in sorted({block_def.abs_path for block_def in design.block_defs.values()}):
+        p = Path(bloc_path)
+        paths += [p, p.with_suffix(".c"), p.with_suffix(".h")]
+    return paths
+
+
+def design_as_depfile(lines: list[str], design: Design, target: Path,
+                      extra: list[Path] | None = None) -> None:
+    # make syntax, which both Ninja and the Makefile generators read;
+    # 'extra' lists other files the compiler read, such as --costs
+    escape = lambda p: p.as_posix().replace(" ", "\\ ")
+    lines.append(f"{escape(target)}: \\")
+    sources = design_sources(design) + (extra or [])
+    for n, path in enumerate(sources):
+        tail = " \\" if n + 1 < len(sources) else ""
+        lines.append(f"  {escape(path)}{tail}")
+
+
+def signal_as_c_system(lines: list[str], signal: Signal, tag: str = "",
+                       const: bool = False) -> None:
     c_type = SIG_C_TYPES[signal.sig_type]
-    lines.append(f"{c_type} sig_{signal.name} = {signal.value};")
+    if const:
+        lines.append(f"{c_type} const sig_{signal.name} = {signal.value};")
+    else:
+        lines.append(f"{tag}{c_type} sig_{signal.name} = {signal.value};")
 
 
-def pin_as_c_system_dummy(lines: list[str], pin: PinInstance) -> None:
+def pin_as_c_system_dummy(lines: list[str], pin: PinInstance, tag: str = "",
+                          storage: str = "static ") -> None:
     c_type = SIG_C_TYPES[pin.signal.sig_type]
-    lines.append(f"static {c_type} {pin.dummy_name} = {pin.signal.value};")
+    lines.append(f"{tag}{storage}{c_type} {pin.dummy_name} = {pin.signal.value};")
 
 
 def pin_as_c_system_initializer(lines: list[str], pin: PinInstance) -> None:
@@ -406,14 +626,42 @@ def pin_as_c_system_initializer(lines: list[str], pin: PinInstance) -> None:
         pass
 
 
-def block_as_c_system(lines: list[str], block: BlockInstance) -> None:
+def block_as_c_system(lines: list[str], block: BlockInstance, tag: str = "",
+                      targets: dict[int, str] | None = None,
+                      direct: bool = False, folded: Collection[int] = (),
+                      flash_pins: bool = False) -> None:
+    '''
+    With 'flash_pins', the pin pointers are a const pins_<block> table,
+    see blockdef_as_h_variant(), and only the rest of the instance gets
+    'tag'.
+    '''
     lines.append(f"")
-    # dummy signals for unconnected pins
+    # dummy signals for unconnected pins; direct_<block>.c uses them
+    # by name, so they can't be static there
+    storage = "" if direct else "static "
     for pin in block.pins.values():
         if pin.signal.is_dummy:
-            pin_as_c_system_dummy(lines, pin)
-    # instance struct initializer
-    lines.append(f"{block.block_def.name}_t blk_{block.name} = {{")
+            pin_as_c_system_dummy(lines, pin, tag, storage)
+    variant = block.block_def.name
+    flash_pins = flash_pins and any(field.pin_type is not None
+                                    for field in block.block_def.ordered_fields)
+    # instance struct initializer, or the pin table's
+    if flash_pins:
+        lines.append(f"static {variant}_pins_t const pins_{block.name} = {{")
+    else:
+        lines.append(f"{tag}{variant}_t blk_{block.name} = {{")
+    _block_pin_initializers(lines, block, targets, folded)
+    lines.append(f"}};")
+    if flash_pins:
+        lines.append(f"{tag}{variant}_t blk_{block.name} = {{")
+        lines.append(f"    .pins = &pins_{block.name},")
+        lines.append(f"}};")
+
+
+def _block_pin_initializers(lines: list[str], block: BlockInstance,
+                            targets: dict[int, str] | None = None,
+                            folded: Collection[int] = (),
+                            base: str = "", indent: str = "    ") -> None:
     # group pins by field for array handling
     fields: dict[str, list[PinInstance]] = {}
     for pin in block.pins.values():
@@ -429,82 +677,881 @@ def block_as_c_system(lines: list[str], block: BlockInstance) -> None:
         if not field.dims:
             # scalar pin
             if pins:
-                pin = pins[0]
-                target = f"&{pin.dummy_name}" if pin.signal.is_dummy else f"&sig_{pin.signal.name}"
-                lines.append(f"    .{field.name} = {target},")
+                target = _pin_target(pins[0], targets, folded, base)
+                lines.append(f"{indent}.{field.name} = {target},")
         else:
             # array pin — emit nested initializer
-            lines.append(f"    .{field.name} = {{")
-            _emit_array_initializer(lines, field, pins)
-            lines.append(f"    }},")
-    lines.append(f"}};")
+            lines.append(f"{indent}.{field.name} = {{")
+            _emit_array_initializer(lines, field, pins, targets, folded, base, indent)
+            lines.append(f"{indent}}},")
 
 
 def _emit_array_initializer(lines: list[str], field: FieldDef,
-                             pins: list[PinInstance]) -> None:
+                             pins: list[PinInstance],
+                             targets: dict[int, str] | None = None,
+                             folded: Collection[int] = (),
+                             base: str = "", indent: str = "    ") -> None:
     # build lookup from field_indices tuple to pin
     pin_map = {pin.pin_def.field_indices: pin for pin in pins}
     if len(field.dims) == 1:
         for i in range(field.dims[0]):
             pin = pin_map.get((i,))
-            target = _pin_target(pin)
-            lines.append(f"        {target},")
+            target = _pin_target(pin, targets, folded, base)
+            lines.append(f"{indent}    {target},")
     elif len(field.dims) == 2:
         for i in range(field.dims[0]):
-            lines.append(f"        {{")
+            lines.append(f"{indent}    {{")
             for j in range(field.dims[1]):
                 pin = pin_map.get((i, j))
-                target = _pin_target(pin)
-                lines.append(f"            {target},")
-            lines.append(f"        }},")
+                target = _pin_target(pin, targets, folded, base)
+                lines.append(f"{indent}        {target},")
+            lines.append(f"{indent}    }},")
+
+
+def _pin_variable(pin: PinInstance, targets: dict[int, str] | None = None) -> str:
+    if targets and id(pin) in targets:
+        # reads a cross-core signal through its local copy
+        return targets[id(pin)]
+    if pin.signal.is_dummy:
+        return pin.dummy_name
+    return f"sig_{pin.signal.name}"
 
 
-def _pin_target(pin: PinInstance | None) -> str:
+def _pin_target(pin: PinInstance | None, targets: dict[int, str] | None = None,
+                folded: Collection[int] = (), base: str = "") -> str:
+    # 'base' is prefixed to signal and dummy names, see static_rt_as_c_system()
     if pin is None:
         return "NULL"
-    if pin.signal.is_dummy:
-        return f"&{pin.dummy_name}"
-    return f"&sig_{pin.signal.name}"
+    if targets and id(pin) in targets:
+        base = ""
+    target = f"&{base}{_pin_variable(pin, targets)}"
+    if id(pin.signal) in folded:
+        # pins aren't const, but only inputs read constant signals
+        return f"({PIN_C_TYPES[pin.pin_type]}){target}"
+    return target
 
 
-def thread_as_c_system(lines: list[str], thread: Thread, prefix: str) -> None:
+def thread_as_c_profile_data(lines: list[str], thread: Thread, storage: str) -> None:
+    # profile records are only emitted for threads with functions
+    if not thread.functions:
+        return
+    lines.append(f"#ifdef EBL_PROFILE")
+    lines.append(f"{storage}volatile uint32_t prof_{thread.name}_reset;")
+    lines.append(f"{storage}bl_profile_t prof_{thread.name}[{len(thread.functions)}];")
+    lines.append(f"#endif")
     lines.append(f"")
-    lines.append(f"void {prefix}_{thread.name}(uint32_t periodns) {{")
+
+
+def thread_as_c_stats_data(lines: list[str], thread: Thread, storage: str) -> None:
+    # every thread has stats; only the definition gets an initializer,
+    # the thread fills in the rest on its first run
+    init = "" if storage else f" = {{ .reset = 1, .period_ns = {thread.period_ns} }}"
+    lines.append(f"#ifdef EBL_THREAD_STATS")
+    lines.append(f"{storage}bl_thread_stats_t stats_{thread.name}{init};")
+    lines.append(f"#endif")
+    lines.append(f"")
+
+
+def enable_flag_name(func: FunctInstance) -> str:
+    return f"en_{func.block.name}_{func.funct_def.name}"
+
+
+def thread_as_c_enable_data(lines: list[str], thread: Thread, storage: str) -> None:
+    # one flag per function, so the application or the monitor can
+    # switch it off and on by name; they are words so the monitor's
+    # single word write can set them; only the definition gets an
+    # initializer
+    if not thread.functions:
+        return
+    init = "" if storage else " = 1"
+    lines.append(f"#ifdef EBL_FUNCTION_ENABLE")
+    for func in thread.functions:
+        lines.append(f"{storage}volatile uint32_t {enable_flag_name(func)}{init};")
+    lines.append(f"#endif")
+    lines.append(f"")
+
+
+def mailbox_as_c_data(lines: list[str], mbox: Mailbox) -> None:
+    width = len(mbox.signals)
+    core = mbox.consumer.core
+    lines.append(f"")
+    lines.append(f"// thread {mbox.producer.name} (core {mbox.producer.core})"
+                 f" to thread {mbox.consumer.name} (core {core})")
+    lines.append(f"static uint32_t {mbox.name}_frames[MB_SLOTS*{width}];")
+    lines.append(f"mb_mailbox_t {mbox.name} = MB_MAILBOX_INIT({mbox.name}_frames, {width});")
+    for signal in mbox.signals:
+        c_type = SIG_C_TYPES[signal.sig_type]
+        lines.append(f"EBL_FAST_DATA {c_type} {local_copy_name(signal, core)} = {signal.value};")
+
+
+def mailbox_as_c_functions(lines: list[str], mbox: Mailbox, storage: str = "static ") -> None:
+    core = mbox.consumer.core
+    lines.append(f"")
+    lines.append(f"{storage}void {mbox.name}_put(void) {{")
+    lines.append(f"    bl_sig_data_t *frame = (bl_sig_data_t *)mb_put_begin(&{mbox.name});")
+    for n, signal in enumerate(mbox.signals):
+        lines.append(f"    frame[{n}].{SIG_DATA_MEMBERS[signal.sig_type]} = sig_{signal.name};")
+    lines.append(f"    mb_put_end(&{mbox.name});")
+    lines.append(f"}}")
+    lines.append(f"")
+    lines.append(f"{storage}void {mbox.name}_get(void) {{")
+    lines.append(f"    bl_sig_data_t const *frame = (bl_sig_data_t const *)mb_get_begin(&{mbox.name});")
+    lines.append(f"    if ( frame == NULL ) {{")
+    lines.append(f"        return;")
+    lines.append(f"    }}")
+    for n, signal in enumerate(mbox.signals):
+        lines.append(f"    {local_copy_name(signal, core)} = frame[{n}].{SIG_DATA_MEMBERS[signal.sig_type]};")
+    lines.append(f"    mb_get_end(&{mbox.name});")
+    lines.append(f"}}")
+
+
+def changes_as_c_data(lines: list[str], changes: ChangePlan) -> None:
+    # run flags start set, so every function runs at least once
+    for flag in changes.flags.values():
+        lines.append(f"EBL_FAST_DATA volatile uint8_t {flag} = 1;")
+    for check in changes.checks:
+        c_type = SIG_C_TYPES[check.signal.sig_type]
+        lines.append(f"EBL_FAST_DATA {c_type} {check.shadow} = {check.signal.value};")
+
+
+def change_check_as_c(lines: list[str], check: ChangeCheck, indent: str) -> None:
+    lines.append(f"{indent}if ( {check.value} != {check.shadow} ) {{")
+    lines.append(f"{indent}    {check.shadow} = {check.value};")
+    for flag in check.flags:
+        lines.append(f"{indent}    {flag} = 1;")
+    lines.append(f"{indent}}}")
+
+
+def _joins_loop(run: list[FunctInstance], func: FunctInstance, changes: ChangePlan) -> bool:
+    last = run[-1]
+    if (last.block.block_def is not func.block.block_def
+            or last.funct_def.name != func.funct_def.name
+            or (id(last) in changes.flags) != (id(func) in changes.flags)):
+        return False
+    # the checks after a call are made after the whole loop, so no
+    # call in it may feed another; checks through pin pointers are
+    # made before it, and a pin may be linked to any output
+    members = run + [func]
+    if any(check.pin for f in members for check in changes.before.get(id(f), [])):
+        return False
+    flags = {changes.flags[id(f)] for f in members if id(f) in changes.flags}
+    return not any(flags.intersection(check.flags)
+                   for f in members for check in changes.after.get(id(f), []))
+
+
+def thread_loops(thread: Thread, changes: ChangePlan | None = None) -> list[list[FunctInstance]]:
+    """
+    Splits the functions of 'thread' into runs of consecutive calls to
+    the same function of the same variant, which thread_as_c_system()
+    can make in one loop.  A run is either all on_change functions or
+    none, and no function in it changes an input of another.
+    """
+    changes = changes or ChangePlan()
+    runs: list[list[FunctInstance]] = []
     for func in thread.functions:
-        lines.append(f"    {func.block.block_def.name}_{func.funct_def.name}(&blk_{func.block.name}, periodns);")
+        if runs and _joins_loop(runs[-1], func, changes):
+            runs[-1].append(func)
+        else:
+            runs.append([func])
+    return runs
+
+
+def loop_as_c_data(lines: list[str], thread: Thread, start: int,
+                   run: list[FunctInstance], changes: ChangePlan) -> None:
+    # the instances of a loop, their enable flags, and their run flags
+    name = f"loop_{thread.name}_{start}"
+    variant = run[0].block.block_def.name
+    lines.append(f"static {variant}_t * const {name}[{len(run)}] = {{")
+    for func in run:
+        lines.append(f"    &blk_{func.block.name},")
+    lines.append(f"}};")
+    lines.append(f"#ifdef EBL_FUNCTION_ENABLE")
+    lines.append(f"static uint32_t const volatile * const {name}_en[{len(run)}] = {{")
+    for func in run:
+        lines.append(f"    &{enable_flag_name(func)},")
+    lines.append(f"}};")
+    lines.append(f"#endif")
+    if id(run[0]) in changes.flags:
+        lines.append(f"static volatile uint8_t * const {name}_chg[{len(run)}] = {{")
+        for func in run:
+            lines.append(f"    &{changes.flags[id(func)]},")
+        lines.append(f"}};")
+    lines.append(f"")
+
+
+def loop_as_c_system(lines: list[str], thread: Thread, start: int,
+                     run: list[FunctInstance], changes: ChangePlan) -> None:
+    name = f"loop_{thread.name}_{start}"
+    funct = f"{run[0].block.block_def.name}_{run[0].funct_def.name}"
+    for func in run:
+        for check in changes.before.get(id(func), []):
+            change_check_as_c(lines, check, "    ")
+    lines.append(f"    for ( uint32_t i = 0 ; i < {len(run)} ; i++ ) {{")
+    if id(run[0]) in changes.flags:
+        lines.append(f"        if ( BL_FUNCTION_ENABLED(*{name}_en[i]) && *{name}_chg[i] ) {{")
+        lines.append(f"            *{name}_chg[i] = 0;")
+    else:
+        lines.append(f"        if ( BL_FUNCTION_ENABLED(*{name}_en[i]) ) {{")
+    lines.append(f"            {funct}({name}[i], periodns);")
+    lines.append(f"        }}")
+    lines.append(f"        BL_PROFILE_MARK(prof_{thread.name}[{start} + i]);")
+    lines.append(f"    }}")
+    # a check that would follow a call that was skipped finds no change
+    checked = set()
+    for func in run:
+        for check in changes.after.get(id(func), []):
+            if id(check) not in checked:
+                checked.add(id(check))
+                change_check_as_c(lines, check, "    ")
+
+
+def thread_as_c_system(lines: list[str], thread: Thread, prefix: str,
+                       routing: Routing | None = None,
+                       changes: ChangePlan | None = None,
+                       direct: bool = False, loops: bool = False,
+                       meta: bool = False) -> None:
+    '''
+    With 'loops', each run of calls from thread_loops() longer than one
+    is made by a single loop over a table of its instances.  Direct
+    calls are never looped, since each instance has its own function.
+    With 'meta', the stats and enable flags are in the thread's and
+    functions' realtime data; see static_names_as_c_system().
+    '''
+    mailboxes = routing.mailboxes if routing else []
+    changes = changes or ChangePlan()
+    if loops and not direct:
+        runs = thread_loops(thread, changes)
+    else:
+        runs = [[func] for func in thread.functions]
+    lines.append(f"")
+    if not meta:
+        thread_as_c_stats_data(lines, thread, "")
+    thread_as_c_profile_data(lines, thread, "")
+    if not meta:
+        thread_as_c_enable_data(lines, thread, "")
+    n = 0
+    for run in runs:
+        if len(run) > 1:
+            loop_as_c_data(lines, thread, n, run, changes)
+        n += len(run)
+    lines.append(f"void {prefix}_{thread.name}(uint32_t periodns) {{")
+    lines.append(f"    BL_THREAD_STATS_BEGIN(stats_{thread.name});")
+    # take cross-core signals before any function reads them
+    for mbox in mailboxes:
+        if mbox.consumer is thread:
+            lines.append(f"    {mbox.name}_get();")
+            for check in changes.taken.get(mbox.name, []):
+                change_check_as_c(lines, check, "    ")
+    if thread.functions:
+        lines.append(f"    BL_PROFILE_BEGIN(prof_{thread.name}, {len(thread.functions)}, prof_{thread.name}_reset);")
+    n = 0
+    for run in runs:
+        if len(run) > 1:
+            loop_as_c_system(lines, thread, n, run, changes)
+            n += len(run)
+            continue
+        func = run[0]
+        if direct:
+            call = f"{direct_function_name(func)}(periodns);"
+        else:
+            call = f"{func.block.block_def.name}_{func.funct_def.name}(&blk_{func.block.name}, periodns);"
+        enabled = f"BL_FUNCTION_ENABLED({enable_flag_name(func)})"
+        flag = changes.flags.get(id(func))
+        if flag is None:
+            lines.append(f"    if ( {enabled} ) {{")
+        else:
+            # skip the call unless an input has changed since the last
+            # one; a function that is off keeps its flag for later
+            for check in changes.before.get(id(func), []):
+                change_check_as_c(lines, check, "    ")
+            lines.append(f"    if ( {enabled} && {flag} ) {{")
+            lines.append(f"        {flag} = 0;")
+        lines.append(f"        {call}")
+        # find out which signals the function changed
+        for check in changes.after.get(id(func), []):
+            change_check_as_c(lines, check, "        ")
+        lines.append(f"    }}")
+        lines.append(f"    BL_PROFILE_MARK(prof_{thread.name}[{n}]);")
+        n += 1
+    # put cross-core signals after every function has written them
+    for mbox in mailboxes:
+        if mbox.producer is thread:
+            lines.append(f"    {mbox.name}_put();")
+    lines.append(f"    BL_THREAD_STATS_END(stats_{thread.name});")
     lines.append(f"}}")
 
 
-def design_as_c_system(lines: list[str], design: Design) -> None:
+def thread_file_name(thread: Thread, prefix: str) -> str:
+    return f"{prefix}_{thread.name}.c"
+
+
+def thread_variants(thread: Thread) -> list[BlockDef]:
+    """ Returns the variants whose functions 'thread' calls, in call order. """
+    variants = {}
+    for func in thread.functions:
+        variants.setdefault(func.block.block_def.name, func.block.block_def)
+    return list(variants.values())
+
+
+def blockdef_as_c_inline(lines: list[str], blockdef: BlockDef,
+                         body: list[str], file_name: str) -> None:
+    '''
+    body should be the lines of the <block>.c file.  Appends them to
+    lines, set up as they are in <variant>.c, but with the functions
+    'static inline', then takes back every macro they defined so the
+    next variant starts clean.  'file_name' is the name of the file
+    that lines are for, so errors after the body point back into it.
+    '''
+    body = list(body)
+    line_directive = _strip_c_template(body, blockdef)
+    variant = blockdef.name
+    lines.append(f"")
+    lines.append(f"// ---- {variant} ----")
+    lines.append(f"#define BL_BLOCK_NAME {variant}")
+    for name, value in blockdef.params.items():
+        lines.append(f"#define {name} ({value})")
+    # declared before the variant header, so its prototypes don't
+    # make the functions external
+    for funct in blockdef.functions.values():
+        lines.append(f"static inline __attribute__((always_inline))")
+        lines.append(f"void {variant}_{funct.name}(void *instance_data, uint32_t periodns);")
+    lines.append(f'#include "{variant}.h"')
+    lines.append(line_directive)
+    lines.extend(body)
+    lines.append(f'#line {len(lines) + 2} "{file_name}"')
+    lines.append(f"#undef BL_BLOCK_NAME")
+    for name in blockdef.params:
+        lines.append(f"#undef {name}")
+    for field in blockdef.ordered_fields:
+        if field.pin_type is not None:
+            lines.append(f"#undef p{field.name.upper()}")
+            lines.append(f"#undef {field.name.upper()}")
+
+
+def thread_as_c_amalgamated(lines: list[str], thread: Thread, prefix: str,
+                            bodies: dict[str, list[str]],
+                            routing: Routing | None = None,
+                            changes: ChangePlan | None = None,
+                            loops: bool = False) -> None:
+    '''
+    Writes <prefix>_<thread>.c, one translation unit holding the thread
+    function and, as 'static inline', every block function it calls, so
+    the compiler can fold the whole thread into one function.  'bodies'
+    holds the lines of the <block>.c file of each variant, keyed by
+    variant name.
+    '''
+    mailboxes = routing.mailboxes if routing else []
+    changes = changes or ChangePlan()
+    file_name = thread_file_name(thread, prefix)
+    lines.append(f"// Auto-generated from {prefix}.blocs - Do not edit.")
+    lines.append(f"// Thread {thread.name}, with the block functions it calls inlined")
+    lines.append(f"")
+    lines.append(f'#include <emblocs_comp.h>')
+    lines.append(f'#include <target_hooks.h>')
+    lines.append(f'#include <{prefix}.h>')
+    for blockdef in thread_variants(thread):
+        blockdef_as_c_inline(lines, blockdef, bodies[blockdef.name], file_name)
+    # everything else the thread touches stays in <prefix>.c
+    lines.append(f"")
+    lines.append(f"// defined in {prefix}.c")
+    blocks = {}
+    for func in thread.functions:
+        blocks.setdefault(func.block.name, func.block)
+    for block in blocks.values():
+        lines.append(f"extern {block.block_def.name}_t blk_{block.name};")
+    checks: list[ChangeCheck] = []
+    flags: list[str] = []
+    for mbox in mailboxes:
+        if mbox.consumer is thread:
+            lines.append(f"void {mbox.name}_get(void);")
+            checks.extend(changes.taken.get(mbox.name, []))
+        if mbox.producer is thread:
+            lines.append(f"void {mbox.name}_put(void);")
+    for func in thread.functions:
+        if id(func) in changes.flags:
+            flags.append(changes.flags[id(func)])
+        checks.extend(changes.before.get(id(func), []))
+        checks.extend(changes.after.get(id(func), []))
+    declared = set()
+    for check in checks:
+        c_type = SIG_C_TYPES[check.signal.sig_type]
+        for name in (check.value, check.shadow):
+            if name not in declared:
+                declared.add(name)
+                lines.append(f"extern {c_type} {name};")
+        flags.extend(check.flags)
+    for flag in flags:
+        if flag not in declared:
+            declared.add(flag)
+            lines.append(f"extern volatile uint8_t {flag};")
+    thread_as_c_system(lines, thread, prefix, routing, changes, loops=loops)
+
+
+def execution_order(design: Design) -> list[Signal | BlockInstance]:
+    """
+    Returns the signals and blocks used by threads, in the order the
+    threads touch them: fastest thread first, and for each function,
+    the signals connected to its block followed by the block itself.
+    Emitting the data in this order keeps each thread's working set
+    together in memory.
+    """
+    order = []
+    seen = set()
+    threads = sorted(design.threads.values(), key=attrgetter("period_ns"))
+    for thread in threads:
+        for func in thread.functions:
+            block = func.block
+            if id(block) in seen:
+                continue
+            for pin in block.pins.values():
+                if not pin.signal.is_dummy and id(pin.signal) not in seen:
+                    seen.add(id(pin.signal))
+                    order.append(pin.signal)
+            seen.add(id(block))
+            order.append(block)
+    return order
+
+
+def tick_function_names(schedule: Schedule, prefix: str) -> dict[int, str]:
+    """
+    Returns the name of the tick function for each core, in core
+    order.  A single core design has just <prefix>_tick(); with more
+    than one core, each core has its own <prefix>_tick_core<n>().
+    """
+    cores = sorted({entry.thread.core for entry in schedule.entries})
+    if cores in ([], [0]):
+        return {0: f"{prefix}_tick"}
+    return {core: f"{prefix}_tick_core{core}" for core in cores}
+
+
+def schedule_as_c_system(lines: list[str], schedule: Schedule, prefix: str) -> None:
+    names = tick_function_names(schedule, prefix)
+    for core, name in names.items():
+        entries = [entry for entry in schedule.entries if entry.thread.core == core]
+        where = f" on core {core}" if len(names) > 1 else ""
+        lines.append(f"")
+        lines.append(f"// call from a timer interrupt{where} every {schedule.base_ns} ns")
+        lines.append(f"void {name}(void) {{")
+        _tick_function_body(lines, entries, prefix)
+        lines.append(f"}}")
+
+
+def _tick_function_body(lines: list[str], entries: list[ScheduleEntry], prefix: str) -> None:
+    # each slow thread counts down to its next run; counters start
+    # at phase+1 so the first run is on tick 'phase'
+    entries = sorted(entries, key=attrgetter("divisor"))
+    for entry in entries:
+        if entry.divisor > 1:
+            lines.append(f"    static uint32_t count_{entry.thread.name} = {entry.phase + 1};")
+    # fastest threads first, so they see the least latency
+    for entry in entries:
+        call = f"{prefix}_{entry.thread.name}({entry.thread.period_ns});"
+        if entry.divisor == 1:
+            lines.append(f"    {call}")
+        else:
+            lines.append(f"    if ( --count_{entry.thread.name} == 0 ) {{")
+            lines.append(f"        count_{entry.thread.name} = {entry.divisor};")
+            lines.append(f"        {call}")
+            lines.append(f"    }}")
+
+
+# the enums emblocs_common.h uses for pin and signal types, and directions
+BL_TYPES = {
+    PinType.BOOL:  "BL_TYPE_BIT",
+    PinType.U32:   "BL_TYPE_U32",
+    PinType.S32:   "BL_TYPE_S32",
+    PinType.FLOAT: "BL_TYPE_FLOAT",
+    PinType.RAW:   "BL_TYPE_RAW",
+}
+
+BL_DIRS = {
+    PinDir.INPUT:  "BL_DIR_IN",
+    PinDir.OUTPUT: "BL_DIR_OUT",
+}
+
+
+def rtdata_name(func: FunctInstance) -> str:
+    return f"fn_{func.block.name}_{func.funct_def.name}"
+
+
+def _rt_index(member: str) -> str:
+    return f"offsetof(struct bl_static_rt_s, {member}) / 4"
+
+
+def _meta_link(kind: str, member: str | None) -> str:
+    # the core's lists aren't const, but nothing writes these
+    if member is None:
+        return "NULL"
+    return f"(bl_{kind}_meta_t *)&bl_static_meta.{member}"
+
+
+def _by_name(objects: Collection, key=attrgetter("name")) -> list:
+    # the core keeps its lists in strcmp() order
+    return sorted(objects, key=lambda obj: key(obj).encode())
+
+
+def static_rt_order(design: Design) -> list[Signal | BlockInstance]:
+    """
+    Returns every signal and block of 'design': the ones threads use
+    in execution order, then the rest.
+    """
+    order = execution_order(design)
+    seen = {id(obj) for obj in order}
+    order += [sig for sig in design.signals.values() if id(sig) not in seen]
+    order += [blk for blk in design.blocks.values() if id(blk) not in seen]
+    return order
+
+
+def static_rt_as_c_system(lines: list[str], design: Design) -> None:
+    '''
+    Writes all of the realtime data of 'design' as the members of one
+    struct, bl_static_rt, which stands in for the RT pool when
+    EBL_STATIC_META is defined, so that the metadata can give each
+    member's offset as its pool index.  As in a system built at run
+    time, every pin has a dummy signal, and every function and thread
+    its realtime data.
+    '''
+    order = static_rt_order(design)
+    lines.append(f"// realtime data, in thread execution order; the RT pool")
+    lines.append(f"struct bl_static_rt_s {{")
+    for obj in order:
+        if isinstance(obj, Signal):
+            lines.append(f"    {SIG_C_TYPES[obj.sig_type]} sig_{obj.name};")
+            continue
+        for pin in obj.pins.values():
+            c_type = SIG_C_TYPES[_dummy_type(pin)]
+            lines.append(f"    {c_type} {pin.dummy_name};")
+        # pool indexes count words; pin pointers align the rest
+        align = "" if obj.pins else " __attribute__((aligned(4)))"
+        lines.append(f"    {obj.block_def.name}_t blk_{obj.name}{align};")
+    for block in design.blocks.values():
+        for func in block.functions.values():
+            lines.append(f"    bl_function_rtdata_t {rtdata_name(func)};")
+    for thread in design.threads.values():
+        lines.append(f"    bl_thread_data_t thd_{thread.name};")
+    lines.append(f"}};")
+    lines.append(f"_Static_assert(sizeof(struct bl_static_rt_s) <= BL_RT_POOL_SIZE,"
+                 f" \"realtime data is too big for BL_RT_INDEX_BITS\");")
+    lines.append(f"")
+    base = "bl_static_rt."
+    lines.append(f"EBL_FAST_DATA struct bl_static_rt_s bl_static_rt = {{")
+    for obj in order:
+        if isinstance(obj, Signal):
+            lines.append(f"    .sig_{obj.name} = {obj.value},")
+            continue
+        for pin in obj.pins.values():
+            value = pin.signal.value if pin.signal.is_dummy else 0
+            lines.append(f"    .{pin.dummy_name} = {value},")
+        lines.append(f"    .blk_{obj.name} = {{")
+        _block_pin_initializers(lines, obj, base=base, indent="        ")
+        lines.append(f"    }},")
+    for block in design.blocks.values():
+        for func in block.functions.values():
+            lines.append(f"    .{rtdata_name(func)} = {{")
+            lines.append(f"        .funct = {block.block_def.name}_{func.funct_def.name},")
+            lines.append(f"        .block_data = &{base}blk_{block.name},")
+            # linked in the order the thread calls them
+            if func.thread is not None:
+                funcs = func.thread.functions
+                n = funcs.index(func)
+                if n + 1 < len(funcs):
+                    lines.append(f"        .next = &{base}{rtdata_name(funcs[n + 1])},")
+            lines.append(f"#ifdef EBL_FUNCTION_ENABLE")
+            lines.append(f"        .enabled = 1,")
+            lines.append(f"#endif")
+            lines.append(f"    }},")
+    for thread in design.threads.values():
+        lines.append(f"    .thd_{thread.name} = {{")
+        lines.append(f"        .period_ns = {thread.period_ns},")
+        if thread.functions:
+            lines.append(f"        .start = &{base}{rtdata_name(thread.functions[0])},")
+        lines.append(f"#ifdef EBL_THREAD_STATS")
+        lines.append(f"        .stats = {{ .reset = 1, .period_ns = {thread.period_ns} }},")
+        lines.append(f"#endif")
+        lines.append(f"    }},")
+    lines.append(f"}};")
+
+
+def _dummy_type(pin: PinInstance) -> PinType:
+    # as Design makes them; raw pins get a word
+    return pin.pin_type if pin.pin_type != PinType.RAW else PinType.U32
+
+
+def blockdef_as_c_comp_def(lines: list[str], blockdef: BlockDef) -> None:
+    # the component definition that bl_show_block() and friends expect
+    variant = blockdef.name
+    lines.append(f"static bl_pin_def_t const pin_defs_{variant}[] = {{")
+    for pin in blockdef.pins.values():
+        indices = "".join(f"[{i}]" for i in pin.field_indices)
+        lines.append(f"    {{ \"{pin.name}\", {BL_TYPES[pin.pin_type]}, {BL_DIRS[pin.direction]},"
+                     f" offsetof({variant}_t, {pin.field.name}{indices}) }},")
+    lines.append(f"}};")
+    lines.append(f"static bl_function_def_t const function_defs_{variant}[] = {{")
+    for funct in blockdef.functions.values():
+        lines.append(f"    {{ \"{funct.name}\", BL_HAS_FP, {variant}_{funct.name} }},")
+    lines.append(f"}};")
+    lines.append(f"static bl_comp_def_t const comp_def_{variant} = {{")
+    lines.append(f"    .name = \"{variant}\",")
+    lines.append(f"    .data_size = sizeof({variant}_t),")
+    lines.append(f"    .num_pin_defs = {len(blockdef.pins)},")
+    lines.append(f"    .num_function_defs = {len(blockdef.functions)},")
+    lines.append(f"    .pin_defs = pin_defs_{variant},")
+    lines.append(f"    .function_defs = function_defs_{variant},")
+    lines.append(f"}};")
+    lines.append(f"")
+
+
+def _pin_meta_name(pin: PinInstance) -> str:
+    return f"pin_{pin.block.name}_{pin.pin_def.name}"
+
+
+def static_meta_as_c_system(lines: list[str], design: Design) -> None:
+    '''
+    Writes the metadata of 'design' as the members of one const struct,
+    bl_static_meta, which stands in for the meta pool when
+    EBL_STATIC_META is defined.  The lists are linked in name order,
+    as the core would have built them, and pool indexes are offsets
+    into bl_static_rt and bl_static_meta.
+    '''
+    blocks = _by_name(design.blocks.values())
+    signals = _by_name(design.signals.values())
+    threads = _by_name(design.threads.values())
+    lines.append(f"// component definitions")
+    for blockdef in design.block_defs.values():
+        blockdef_as_c_comp_def(lines, blockdef)
+    lines.append(f"// metadata, in flash; the meta pool")
+    lines.append(f"struct bl_static_meta_s {{")
+    for block in blocks:
+        lines.append(f"    bl_block_meta_t blk_{block.name};")
+        for pin in _by_name(block.pins.values(), attrgetter("pin_def.name")):
+            lines.append(f"    bl_pin_meta_t {_pin_meta_name(pin)};")
+        for func in _by_name(block.functions.values(), attrgetter("funct_def.name")):
+            lines.append(f"    bl_function_meta_t {rtdata_name(func)};")
+    for signal in signals:
+        lines.append(f"    bl_signal_meta_t sig_{signal.name};")
+    for thread in threads:
+        lines.append(f"    bl_thread_meta_t thd_{thread.name};")
+    lines.append(f"}};")
+    lines.append(f"_Static_assert(sizeof(struct bl_static_meta_s) <= BL_META_POOL_SIZE,"
+                 f" \"metadata is too big for BL_META_INDEX_BITS\");")
+    lines.append(f"")
+    lines.append(f"struct bl_static_meta_s const bl_static_meta = {{")
+    for n, block in enumerate(blocks):
+        variant = block.block_def.name
+        pins = _by_name(block.pins.values(), attrgetter("pin_def.name"))
+        funcs = _by_name(block.functions.values(), attrgetter("funct_def.name"))
+        following = f"blk_{blocks[n + 1].name}" if n + 1 < len(blocks) else None
+        lines.append(f"    .blk_{block.name} = {{")
+        lines.append(f"        .next = {_meta_link('block', following)},")
+        lines.append(f"        .comp_def = &comp_def_{variant},")
+        lines.append(f"        .data_index = {_rt_index(f'blk_{block.name}')},")
+        lines.append(f"        .data_size = sizeof({variant}_t),")
+        lines.append(f"        .name = \"{block.name}\",")
+        first = _pin_meta_name(pins[0]) if pins else None
+        lines.append(f"        .pin_list = {_meta_link('pin', first)},")
+        first = rtdata_name(funcs[0]) if funcs else None
+        lines.append(f"        .function_list = {_meta_link('function', first)},")
+        lines.append(f"    }},")
+        for m, pin in enumerate(pins):
+            field = pin.pin_def.field.name + "".join(f"[{i}]" for i in pin.pin_def.field_indices)
+            following = _pin_meta_name(pins[m + 1]) if m + 1 < len(pins) else None
+            lines.append(f"    .{_pin_meta_name(pin)} = {{")
+            lines.append(f"        .next = {_meta_link('pin', following)},")
+            lines.append(f"        .ptr_index = (offsetof(struct bl_static_rt_s, blk_{block.name})"
+                         f" + offsetof({variant}_t, {field})) / 4,")
+            lines.append(f"        .data_type = {BL_TYPES[pin.pin_type]},")
+            lines.append(f"        .dummy_index = {_rt_index(pin.dummy_name)},")
+            lines.append(f"        .pin_dir = {BL_DIRS[pin.direction]},")
+            lines.append(f"        .name = \"{pin.pin_def.name}\",")
+            lines.append(f"    }},")
+        for m, func in enumerate(funcs):
+            following = rtdata_name(funcs[m + 1]) if m + 1 < len(funcs) else None
+            if func.thread is None:
+                thread_index = "BL_META_MAX_INDEX"
+            else:
+                thread_index = f"offsetof(struct bl_static_meta_s, thd_{func.thread.name}) / 4"
+            lines.append(f"    .{rtdata_name(func)} = {{")
+            lines.append(f"        .next = {_meta_link('function', following)},")
+            lines.append(f"        .rtdata_index = {_rt_index(rtdata_name(func))},")
+            lines.append(f"        .nofp = BL_HAS_FP,")
+            lines.append(f"        .thread_index = {thread_index},")
+            lines.append(f"        .name = \"{func.funct_def.name}\",")
+            lines.append(f"    }},")
+    for n, signal in enumerate(signals):
+        following = f"sig_{signals[n + 1].name}" if n + 1 < len(signals) else None
+        lines.append(f"    .sig_{signal.name} = {{")
+        lines.append(f"        .next = {_meta_link('signal', following)},")
+        lines.append(f"        .data_index = {_rt_index(f'sig_{signal.name}')},")
+        lines.append(f"        .data_type = {BL_TYPES[signal.sig_type]},")
+        lines.append(f"        .name = \"{signal.name}\",")
+        lines.append(f"    }},")
+    for n, thread in enumerate(threads):
+        following = f"thd_{threads[n + 1].name}" if n + 1 < len(threads) else None
+        lines.append(f"    .thd_{thread.name} = {{")
+        lines.append(f"        .next = {_meta_link('thread', following)},")
+        lines.append(f"        .data_index = {_rt_index(f'thd_{thread.name}')},")
+        lines.append(f"        .nofp = BL_HAS_FP,")
+        lines.append(f"        .name = \"{thread.name}\",")
+        lines.append(f"    }},")
+    lines.append(f"}};")
+    lines.append(f"")
+    for kind, prefix, objs in (("block", "blk_", blocks), ("signal", "sig_", signals),
+                               ("thread", "thd_", threads)):
+        first = f"{prefix}{objs[0].name}" if objs else None
+        lines.append(f"bl_{kind}_meta_t *{kind}_root = {_meta_link(kind, first)};")
+    lines.append(f"const uint32_t bl_rt_pool_size = sizeof(bl_static_rt);")
+    lines.append(f"const uint32_t bl_meta_pool_size = sizeof(bl_static_meta);")
+
+
+def static_names_as_c_system(lines: list[str], design: Design) -> None:
+    # the threads use the usual names for the members of bl_static_rt;
+    # enable flags and stats are the ones the core shows and changes
+    lines.append(f"// realtime data by name")
+    for obj in static_rt_order(design):
+        if isinstance(obj, Signal):
+            lines.append(f"#define sig_{obj.name} (bl_static_rt.sig_{obj.name})")
+        else:
+            lines.append(f"#define blk_{obj.name} (bl_static_rt.blk_{obj.name})")
+    lines.append(f"#ifdef EBL_FUNCTION_ENABLE")
+    for thread in design.threads.values():
+        for func in thread.functions:
+            lines.append(f"#define {enable_flag_name(func)} (bl_static_rt.{rtdata_name(func)}.enabled)")
+    lines.append(f"#endif")
+    lines.append(f"#ifdef EBL_THREAD_STATS")
+    for thread in design.threads.values():
+        lines.append(f"#define stats_{thread.name} (bl_static_rt.thd_{thread.name}.stats)")
+    lines.append(f"#endif")
+    lines.append(f"")
+
+
+def design_as_c_system(lines: list[str], design: Design, schedule: Schedule | None = None,
+                       routing: Routing | None = None, changes: ChangePlan | None = None,
+                       direct: bool = False, amalgamated: Collection[str] = (),
+                       constants: ConstantPlan | None = None,
+                       flash_pins: bool = False, loops: bool = False,
+                       meta: bool = False) -> None:
+    """
+    'amalgamated' names the threads that are written to their own
+    files by thread_as_c_amalgamated() instead of here.  The signals
+    in 'constants' are emitted as const.  With 'flash_pins', each
+    block's pin pointers are a const table; see block_as_c_system().
+    With 'loops', repeated calls are looped; see thread_as_c_system().
+    With 'meta', the realtime data and the metadata the core would
+    build at startup are generated instead, for EBL_STATIC_META; see
+    static_rt_as_c_system() and static_meta_as_c_system().
+    """
+    targets = routing.targets if routing else None
+    folded = constants.signals if constants else {}
     # header comment
     lines.append(f"// Auto-generated from {Path(design.abs_path).name} - Do not edit.")
     lines.append(f"")
-    lines.append(f'#include <emblocs_common.h>')
+    if meta:
+        lines.append(f'#include <stddef.h>')
+        lines.append(f'#include <emblocs_priv.h>')
+    else:
+        lines.append(f'#include <emblocs_common.h>')
+    lines.append(f'#include <target_hooks.h>')
+    if routing and routing.mailboxes:
+        lines.append(f'#include <mailbox.h>')
     lines.append(f'#include <{Path(design.abs_path).stem}.h>')
     lines.append(f"")
     # includes — one per blockdef
     for name in design.block_defs:
         lines.append(f'#include "{name}.h"')
     lines.append(f"")
-    # real signals
-    if design.signals:
+    if meta:
+        lines.append(f"#ifndef EBL_STATIC_META")
+        lines.append(f'#error "{Path(design.abs_path).stem}.c was generated with --meta, and needs EBL_STATIC_META"')
+        lines.append(f"#endif")
+        lines.append(f"")
+    # instance specialised functions, one direct_<block>.c per block
+    if direct and design.threads:
+        lines.append(f"// direct-addressed block functions")
+        for thread in design.threads.values():
+            for func in thread.functions:
+                lines.append(f"void {direct_function_name(func)}(uint32_t periodns);")
+        lines.append(f"")
+    # cross-core mailboxes, and the copies of the signals they carry
+    if routing and routing.mailboxes:
+        lines.append(f"// cross-core mailboxes")
+        for mbox in routing.mailboxes:
+            mailbox_as_c_data(lines, mbox)
+        lines.append(f"")
+    # run flags and shadow copies for on_change functions
+    if changes and changes.flags:
+        lines.append(f"// change tracking for on_change functions")
+        changes_as_c_data(lines, changes)
+        lines.append(f"")
+    # signals that never change live in flash
+    if folded:
+        lines.append(f"// constant signals")
+        for signal in folded.values():
+            signal_as_c_system(lines, signal, const=True)
+        lines.append(f"")
+    # realtime data and metadata as the pools
+    if meta:
+        static_rt_as_c_system(lines, design)
+        lines.append(f"")
+        static_meta_as_c_system(lines, design)
+        lines.append(f"")
+        static_names_as_c_system(lines, design)
+    # realtime data used by threads, in execution order
+    hot = [obj for obj in execution_order(design)
+           if id(obj) not in folded and not meta]
+    hot_ids = {id(obj) for obj in hot}
+    if hot:
+        lines.append(f"// realtime data, in thread execution order")
+        for obj in hot:
+            if isinstance(obj, Signal):
+                lines.append(f"")
+                signal_as_c_system(lines, obj, "EBL_FAST_DATA ")
+            else:
+                block_as_c_system(lines, obj, "EBL_FAST_DATA ", targets, direct, folded,
+                                  flash_pins)
+        lines.append(f"")
+    # real signals not used by any thread
+    cold_signals = [sig for sig in design.signals.values()
+                    if id(sig) not in hot_ids and id(sig) not in folded and not meta]
+    if cold_signals:
         lines.append(f"// signals")
-        for signal in design.signals.values():
+        for signal in cold_signals:
             signal_as_c_system(lines, signal)
         lines.append(f"")
-    # block instances with their dummy signals
-    lines.append(f"// block instances")
-    for block in design.blocks.values():
-        block_as_c_system(lines, block)
-    lines.append(f"")
+    # block instances not used by any thread, with their dummy signals
+    cold_blocks = [blk for blk in design.blocks.values()
+                   if id(blk) not in hot_ids and not meta]
+    if cold_blocks:
+        lines.append(f"// block instances")
+        for block in cold_blocks:
+            block_as_c_system(lines, block, "", targets, direct, folded, flash_pins)
+        lines.append(f"")
+    # mailbox access functions; amalgamated threads call them from
+    # their own files
+    if routing and routing.mailboxes:
+        storage = "" if amalgamated else "static "
+        lines.append(f"// cross-core mailbox access")
+        for mbox in routing.mailboxes:
+            mailbox_as_c_functions(lines, mbox, storage)
+        lines.append(f"")
     # thread functions
     if design.threads:
         lines.append(f"// threads")
         prefix = Path(design.abs_path).stem
         for thread in design.threads.values():
-            thread_as_c_system(lines, thread, prefix)
+            if thread.name in amalgamated:
+                lines.append(f"")
+                lines.append(f"// {prefix}_{thread.name}() is in {thread_file_name(thread, prefix)}")
+            else:
+                thread_as_c_system(lines, thread, prefix, routing, changes, direct, loops, meta)
+    # multi-rate scheduler
+    if schedule is not None:
+        schedule_as_c_system(lines, schedule, Path(design.abs_path).stem)
 
-def design_as_h_system(lines: list[str], design: Design) -> None:
+def design_as_h_system(lines: list[str], design: Design, schedule: Schedule | None = None,
+                       meta: bool = False) -> None:
+    # with 'meta', stats and enable flags are in bl_static_rt, which
+    # only <stem>.c knows; bl_show_thread() and bl_function_enable()
+    # reach them by name
     guard = Path(design.abs_path).stem.upper() + "_H"
     # header comment
     lines.append(f"// Auto-generated from {Path(design.abs_path).name} - Do not edit.")
@@ -514,17 +1561,99 @@ def design_as_h_system(lines: list[str], design: Design) -> None:
     lines.append(f"#define {guard}")
     lines.append(f"")
     lines.append(f"#include <stdint.h>")
+    lines.append(f"#include <emblocs_profile.h>")
     lines.append(f"")
-    # thread function prototypes
+    # thread function prototypes, stats, and profile data
     if design.threads:
         prefix = Path(design.abs_path).stem
         for thread in design.threads.values():
             lines.append(f"void {prefix}_{thread.name}(uint32_t periodns);")
         lines.append(f"")
+        for thread in design.threads.values():
+            if not meta:
+                thread_as_c_stats_data(lines, thread, "extern ")
+            thread_as_c_profile_data(lines, thread, "extern ")
+            if not meta:
+                thread_as_c_enable_data(lines, thread, "extern ")
+    # multi-rate scheduler
+    if schedule is not None:
+        prefix = Path(design.abs_path).stem
+        lines.append(f"#define {prefix.upper()}_TICK_NS ({schedule.base_ns}u)")
+        for name in tick_function_names(schedule, prefix).values():
+            lines.append(f"void {name}(void);")
+        lines.append(f"")
     # close include guard
     lines.append(f"#endif // {guard}")
 
 
+def pools_as_h_system(lines: list[str], design: Design, counts: PoolCounts) -> None:
+    stem = Path(design.abs_path).stem
+    guard = stem.upper() + "_POOLS_H"
+    lines.append(f"// Auto-generated from {Path(design.abs_path).name} - Do not edit.")
+    lines.append(f"// What building this system at run time takes from the memory pools;")
+    lines.append(f'// see EBL_POOL_HEADER in emblocs_config.h.  emblocs_priv.h computes')
+    lines.append(f"// the pool sizes from these counts.")
+    lines.append(f"")
+    lines.append(f"#ifndef {guard}")
+    lines.append(f"#define {guard}")
+    lines.append(f"")
+    lines.append(f"#define BL_POOL_BLOCKS          ({counts.blocks})")
+    lines.append(f"#define BL_POOL_BLOCK_DATA      ({counts.block_data})  // bytes")
+    lines.append(f"#define BL_POOL_PINS            ({counts.pins})")
+    lines.append(f"#define BL_POOL_FUNCTIONS       ({counts.functions})")
+    lines.append(f"#define BL_POOL_SIGNALS         ({counts.signals})")
+    lines.append(f"#define BL_POOL_THREADS         ({counts.threads})")
+    lines.append(f"#define BL_POOL_TABLE_ENTRIES   ({counts.table_entries})")
+    lines.append(f"#define BL_POOL_LAYOUT_SIGNALS  ({counts.layout_signals})")
+    lines.append(f"#define BL_POOL_INDEX_SLOTS     ({counts.index_slots})")
+    lines.append(f"")
+    lines.append(f"// in the base configuration: RT pool {counts.rt_bytes} bytes, "
+                 f"{index_bits(counts.rt_bytes)} index bits;")
+    lines.append(f"// meta pool {counts.meta_bytes} bytes, {index_bits(counts.meta_bytes)} index bits")
+    if counts.guessed:
+        lines.append(f"")
+        lines.append(f"// block data assumes one word for: {', '.join(counts.guessed)}")
+    lines.append(f"")
+    lines.append(f"#endif // {guard}")
+
+
+def _size(size: int | None, measured: bool) -> str:
+    # estimates are marked with ~, unknowns with ?
+    if size is None:
+        return "?"
+    return f"{size}" if measured else f"~{size}"
+
+
+def footprint_as_text(lines: list[str], design: Design, footprint: Footprint) -> None:
+    where = "measured in the image" if footprint.measured else "estimated, ~"
+    lines.append(f"Footprint of {Path(design.abs_path).name}, in bytes ({where}; ? unknown)")
+    lines.append(f"")
+    lines.append(f"{'variant':20} {'blocks':>6} {'struct':>7} {'pins':>6}  code")
+    for v in footprint.variants.values():
+        code = ", ".join(f"{name} {_size(size, True)}" for name, size in v.code.items())
+        lines.append(f"{v.name:20} {v.instances:6} {_size(v.struct, v.measured):>7}"
+                     f" {_size(v.pin_table, v.measured):>6}  {code}")
+    lines.append(f"")
+    lines.append(f"{'block':20} {'variant':20} {'struct':>7} {'pins':>6} {'dummies':>8}  thread")
+    for b in footprint.blocks:
+        dummies = f"{b.dummies}/{_size(b.dummy_ram, b.measured)}"
+        lines.append(f"{b.name:20} {b.variant:20} {_size(b.struct, b.measured):>7}"
+                     f" {_size(b.pin_table, b.measured):>6} {dummies:>8}  {b.thread or '-'}")
+    lines.append(f"")
+    lines.append(f"{'thread':20} {'RAM':>7} {'flash':>6} {'code':>7}  unknown code")
+    for t in footprint.threads:
+        lines.append(f"{t.name:20} {t.ram:7} {t.flash:6} {t.code:7}  {', '.join(t.unknown) or '-'}")
+    idle = [b for b in footprint.blocks if b.thread is None]
+    if idle:
+        lines.append(f"{'(no thread)':20} {sum(b.ram for b in idle):7}"
+                     f" {sum(b.pin_table for b in idle):6} {0:7}  -")
+    lines.append(f"{'total':20} {footprint.ram:7} {footprint.flash:6} {footprint.code:7}")
+
+
+def footprint_as_json(lines: list[str], footprint: Footprint) -> None:
+    lines.extend(json.dumps(footprint.as_dict(), indent=2).splitlines())
+
+
 def write_file_if_changed(path: Path, lines: list[str]) -> bool:
     """Write lines to path only if content has changed.
     Returns True if the file was written, False if unchanged."""
@@ -5,15 +5,24 @@
 # with a restricted set of operations to prevent side effects and
 # arbitrary code execution.
 #
+# Each expression is parsed once and compiled into a tree of closures,
+# which is cached by expression text and mode.  The resolver evaluates
+# the same few expressions (pin conditions, array sizes, name templates)
+# for every array element of every variant, with different variables;
+# the cache lets it do that without parsing or walking the AST again.
+#
 # Public API:
 #   evaluate(expr, variables=None, mode="int"|"float" ) -> int | float
+#   compile_expression(expr, mode="int"|"float") -> function of variables
 #
 # Raises ExpressionError on any syntax or semantic error.
 
 from __future__ import annotations
 import ast
+import functools
 import operator
 import re
+from collections.abc import Callable
 
 # ---------------------------------------------------------------------------
 # Public exception
@@ -114,18 +123,23 @@ def _translate(expr: str) -> str:
 
 
 # ---------------------------------------------------------------------------
-# Evaluator (private)
+# Compiler (private)
 # ---------------------------------------------------------------------------
 
-class _Evaluator:
+class _Compiler:
     """
-    AST-walking expression evaluator.  Do not instantiate directly;
-    use the module-level evaluate() function.
+    Turns the AST of an expression into a tree of closures, each of
+    which evaluates one node given the variables.  Do not instantiate
+    directly; use the module-level compile_expression() function.
+
+    Problems with a node are not raised here; the node compiles to a
+    closure that raises them, so that they are only reported if the
+    node is evaluated, just as when the AST was walked on every call
+    ('0&&(1/0)' is 0, not an error).
     """
-    def __init__(self, expr: str, variables: dict, mode: str):
+    def __init__(self, expr: str, mode: str):
         self.expr_str = expr
-        self.variables = variables
-        self.mode      = mode
+        self.mode     = mode
         if mode == 'int' :
             self.bin_ops   = INT_BIN_OPS
             self.unary_ops = INT_UNARY_OPS
@@ -135,24 +149,26 @@ class _Evaluator:
         else :
             assert False, f"unexpected mode: {mode!r}"
 
-    def error(self, message=None, *, cause=None):
-        if cause is not None:
-            raise ExpressionError(message, self.expr_str) from cause
-        else:
-            raise ExpressionError(message, self.expr_str)
+    def fail(self, message=None, *, cause=None):
+        expr_str = self.expr_str
+        def raiser(variables):
+            if cause is not None:
+                raise ExpressionError(message, expr_str) from cause
+            raise ExpressionError(message, expr_str)
+        return raiser
 
-    def evaluate(self):
+    def compile(self):
         translated = _translate(self.expr_str)
         try:
             tree = ast.parse(translated.strip(), mode='eval')
         except (SyntaxError, ValueError, TypeError) as e:
-            self.error(cause=e)
+            return self.fail(cause=e)
         return self.visit(tree)
 
     def visit(self, node):
         method = getattr(self, f"_visit_{type(node).__name__}", None)
         if method is None:
-            self.error(f"unsupported construct: {type(node).__name__}")
+            return self.fail(f"unsupported construct: {type(node).__name__}")
         return method(node)
 
     def _visit_Expression(self, node):
@@ -160,74 +176,124 @@ class _Evaluator:
 
     def _visit_Constant(self, node):
         if self.mode == 'int' and isinstance(node.value, int):
-            return node.value
-        if self.mode == 'float' and isinstance(node.value, (int, float)):
-            return float(node.value)
-        self.error(f"constant {node.value!r} not valid for {self.mode}")
+            value = node.value
+        elif self.mode == 'float' and isinstance(node.value, (int, float)):
+            value = float(node.value)
+        else:
+            return self.fail(f"constant {node.value!r} not valid for {self.mode}")
+        return lambda variables: value
 
     def _visit_Name(self, node):
-        if node.id not in self.variables:
-            self.error(f"unknown variable: {node.id!r}")
-        val = self.variables[node.id]
-        if self.mode == 'int' and not isinstance(val, int):
-            self.error(f"variable {node.id!r} must be integer")
-        elif self.mode == 'float' and not isinstance(val, (int, float)):
-            self.error(f"variable {node.id!r} must be number")
-        return val
+        name, expr_str = node.id, self.expr_str
+        if self.mode == 'int':
+            types, wrong = int, f"variable {name!r} must be integer"
+        else:
+            types, wrong = (int, float), f"variable {name!r} must be number"
+        def name_value(variables):
+            if name not in variables:
+                raise ExpressionError(f"unknown variable: {name!r}", expr_str)
+            val = variables[name]
+            if not isinstance(val, types):
+                raise ExpressionError(wrong, expr_str)
+            return val
+        return name_value
 
     def _visit_BinOp(self, node):
         op_type = type(node.op)
         if op_type not in self.bin_ops:
-            self.error(f"operator {op_type.__name__!r} not supported for {self.mode}")
+            return self.fail(f"operator {op_type.__name__!r} not supported for {self.mode}")
+        op, op_name, expr_str = self.bin_ops[op_type], op_type.__name__, self.expr_str
         left  = self.visit(node.left)
         right = self.visit(node.right)
-        try:
-            return self.bin_ops[op_type](left, right)
-        except (ArithmeticError, ValueError, TypeError) as e:
-            self.error(f"operator {op_type.__name__!r}", cause=e)
+        def bin_op(variables):
+            a = left(variables)
+            b = right(variables)
+            try:
+                return op(a, b)
+            except (ArithmeticError, ValueError, TypeError) as e:
+                raise ExpressionError(f"operator {op_name!r}", expr_str) from e
+        return bin_op
 
     def _visit_UnaryOp(self, node):
         op_type = type(node.op)
         if op_type not in self.unary_ops:
-            self.error(f"unary {op_type.__name__!r} not supported for {self.mode}")
-        try:
-            return self.unary_ops[op_type](self.visit(node.operand))
-        except (ArithmeticError, ValueError, TypeError) as e:
-            self.error(f"operator {op_type.__name__!r}", cause=e)
+            return self.fail(f"unary {op_type.__name__!r} not supported for {self.mode}")
+        op, op_name, expr_str = self.unary_ops[op_type], op_type.__name__, self.expr_str
+        operand = self.visit(node.operand)
+        def unary_op(variables):
+            try:
+                return op(operand(variables))
+            except (ArithmeticError, ValueError, TypeError) as e:
+                raise ExpressionError(f"operator {op_name!r}", expr_str) from e
+        return unary_op
 
     def _visit_BoolOp(self, node):
+        values = tuple(self.visit(v) for v in node.values)
         if isinstance(node.op, ast.And):
-            for v in node.values:
-                if not self.visit(v):
-                    return 0
-            return 1
+            def and_op(variables):
+                for v in values:
+                    if not v(variables):
+                        return 0
+                return 1
+            return and_op
         elif isinstance(node.op, ast.Or):
-            for v in node.values:
-                if self.visit(v):
-                    return 1
-            return 0
+            def or_op(variables):
+                for v in values:
+                    if v(variables):
+                        return 1
+                return 0
+            return or_op
         else:
             assert False, f"unexpected BoolOp: {type(node.op).__name__}"
 
     def _visit_Compare(self, node):
         if len(node.ops) > 1:
-            self.error("chained compare not supported; "
+            return self.fail("chained compare not supported; "
                 "use '&&' to combine multiple comparisons")
         op_type = type(node.ops[0])
         if op_type not in CMP_OPS:
-            self.error(f"unsupported comparison operator: {op_type.__name__!r}")
+            return self.fail(f"unsupported comparison operator: {op_type.__name__!r}")
+        op, op_name, expr_str = CMP_OPS[op_type], op_type.__name__, self.expr_str
         left  = self.visit(node.left)
         right = self.visit(node.comparators[0])
-        try:
-            return int(CMP_OPS[op_type](left, right))
-        except (ArithmeticError, ValueError, TypeError) as e:
-            self.error(f"operator {op_type.__name__!r}", cause=e)
+        def compare(variables):
+            a = left(variables)
+            b = right(variables)
+            try:
+                return int(op(a, b))
+            except (ArithmeticError, ValueError, TypeError) as e:
+                raise ExpressionError(f"operator {op_name!r}", expr_str) from e
+        return compare
 
 
 # ---------------------------------------------------------------------------
 # Public API
 # ---------------------------------------------------------------------------
 
+# enough for every distinct expression of a large component library
+COMPILE_CACHE_SIZE = 4096
+
+@functools.lru_cache(maxsize=COMPILE_CACHE_SIZE)
+def compile_expression(expr: str, mode: str = 'int') -> Callable[[dict], int | float]:
+    """
+    Compile a C-like expression into a function of the variables.
+
+    Parameters:
+        expr      -- expression string, as for evaluate()
+        mode      -- 'int' (default) or 'float'
+
+    Returns a function that takes a dict of variables, as for evaluate(),
+    and returns the value of the expression.  Every problem with the
+    expression, syntax included, raises ExpressionError from that
+    function, exactly as evaluate() would, so compiling never fails.
+    Results are cached by expression and mode, so each distinct
+    expression is parsed once, however many times it is evaluated.
+    """
+    if mode not in ('int', 'float'):
+        raise ValueError(f"invalid mode {mode!r}; expected 'int' or 'float'")
+    return _Compiler(expr, mode).compile()
+
+
 def evaluate(expr: str, variables: dict = None, mode: str = 'int') -> int | float:
     """
     Evaluate a C-like expression and return the result.
@@ -242,12 +308,9 @@ def evaluate(expr: str, variables: dict = None, mode: str = 'int') -> int | floa
     Returns an int in INT mode, a float in FLOAT mode.
     Raises ExpressionError on any syntax or semantic problem.
     """
-    if mode not in ('int', 'float'):
-        raise ValueError(f"invalid mode {mode!r}; expected 'int' or 'float'")
     if variables is None:
         variables = {}
-    evaluator = _Evaluator(expr, variables, mode)
-    return evaluator.evaluate()
+    return compile_expression(expr, mode)(variables)
 
 
 # ---------------------------------------------------------------------------
@@ -6,10 +6,11 @@
 
 from __future__ import annotations
 import sys
+import gc
 from collections import namedtuple
+from contextlib import contextmanager
 from dataclasses import dataclass, field
 from enum import Enum, auto
-import re
 from pathlib import Path
 
 # ---------------------------------------------------------------------------
@@ -375,11 +376,30 @@ def read_source_string(text: str,
     lines = text.splitlines(keepends=True)
     return lines if _check_ascii(lines) else None
 
+@contextmanager
+def collector_paused():
+    """
+    Pause the cyclic garbage collector while parsing.
+
+    A parser allocates a great many objects and keeps nearly all of
+    them, so the collector's passes over the young generations find
+    nothing to free, and on large designs they take a third of the
+    time.  Reference counting still frees everything else.
+    """
+    was_enabled = gc.isenabled()
+    gc.disable()
+    try:
+        yield
+    finally:
+        if was_enabled:
+            gc.enable()
+
 # ---------------------------------------------------------------------------
 # Tokenizer
 # ---------------------------------------------------------------------------
 
-_TOKEN_RE = re.compile(r"\S+")
+# builds a Token from a tuple without the namedtuple's argument handling
+_new_token = tuple.__new__
 
 def tokenize_line(line: str, line_num: int) -> list[Token]:
     """
@@ -391,11 +411,14 @@ def tokenize_line(line: str, line_num: int) -> list[Token]:
 
     Returns a list of Token objects with 1-based column numbers.
     """
-    return [
-        Token(
-            text   = m.group(),
-            line   = line_num,
-            column = m.start() + 1,
-        )
-        for m in _TOKEN_RE.finditer(line)
-    ]
+    # each token split() finds is the next non-blank text after the
+    # previous one, so find() gives its column
+    tokens = []
+    column = 0
+    find = line.find
+    for text in line.split():
+        column = find(text, column)
+        tokens.append(_new_token(Token, (text, line_num, column + 1)))
+        column += len(text)
+    return tokens
+
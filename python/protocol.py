@@ -2,6 +2,7 @@
 # EMBLOCS Runtime Monitor - protocol constants and wire format definitions
 
 from enum import Enum, auto
+from typing import NamedTuple
 
 # All multi-byte values on the wire are little-endian
 
@@ -41,6 +42,73 @@ class ReplyPacketType(Enum):
 # RP_BS_META_MORE contains 251 bytes of metadata, and says that there is more
 
 
+# Profile records (EBL_PROFILE builds only, see monitor.md 5.6)
+# A bl_profile_t is read as six 32-bit words: last, min, max, calls,
+# then the 64-bit total, low word first.  Nothing reads them yet; the
+# monitor has no read command (monitor.md 6.4).
+PROFILE_RECORD_WORDS = 6
+
+class ProfileRecord(NamedTuple):
+    last: int
+    min: int
+    max: int
+    calls: int
+    total: int
+
+    @property
+    def mean(self) -> float:
+        return self.total / self.calls if self.calls else 0.0
+
+def decode_profile_records(words: list[int]) -> list[ProfileRecord]:
+    """Split words read from a prof_<thread> array into records."""
+    if len(words) % PROFILE_RECORD_WORDS:
+        raise ValueError(f"expected a multiple of {PROFILE_RECORD_WORDS} words, got {len(words)}")
+    records = []
+    for i in range(0, len(words), PROFILE_RECORD_WORDS):
+        last, min_, max_, calls, total_lo, total_hi = words[i:i+PROFILE_RECORD_WORDS]
+        records.append(ProfileRecord(last, min_, max_, calls, (total_hi << 32) | total_lo))
+    return records
+
+
+# Thread statistics (EBL_THREAD_STATS builds only, see monitor.md 5.7)
+# A bl_thread_stats_t is read as 13 32-bit words of counters, then
+# 'edge_count' histogram edges and 'edge_count'+1 histogram buckets.
+# Like the profile records, nothing reads them yet.
+THREAD_STATS_FIXED_WORDS = 13
+THREAD_STATS_DEFAULT_EDGES = 5
+
+class ThreadStats(NamedTuple):
+    reset: int
+    period_ns: int
+    budget: int
+    running: int
+    reentries: int
+    overruns: int
+    runs: int
+    start: int
+    period: int
+    period_min: int
+    period_max: int
+    exec_time: int
+    exec_max: int
+    edges: list[int]
+    hist: list[int]
+
+def thread_stats_words(edge_count: int = THREAD_STATS_DEFAULT_EDGES) -> int:
+    """Number of words to read for one stats_<thread> structure."""
+    return THREAD_STATS_FIXED_WORDS + 2 * edge_count + 1
+
+def decode_thread_stats(words: list[int], edge_count: int = THREAD_STATS_DEFAULT_EDGES) -> ThreadStats:
+    """Decode words read from a stats_<thread> structure."""
+    expected = thread_stats_words(edge_count)
+    if len(words) != expected:
+        raise ValueError(f"expected {expected} words, got {len(words)}")
+    fixed = words[:THREAD_STATS_FIXED_WORDS]
+    edges = words[THREAD_STATS_FIXED_WORDS:THREAD_STATS_FIXED_WORDS+edge_count]
+    hist = words[THREAD_STATS_FIXED_WORDS+edge_count:]
+    return ThreadStats(*fixed, edges=list(edges), hist=list(hist))
+
+
 # -------------------------------------
 # this section is a sample of what the generated metadata might look like
 #
@@ -49,6 +49,50 @@ def tmp_dir():
     return TMP_DIR
 
 
+
+# ---------------------------------------------------------------------------
+# Designs built from .blocs text
+# ---------------------------------------------------------------------------
+
+@pytest.fixture
+def blocs_callbacks(request):
+    """
+    Sets the blocs_parser callbacks for tests that build a Design from
+    .blocs text.  Block specs come from the test module's BLOCS, a dict
+    of .bloc text by spec name, if it has one, otherwise from the .bloc
+    files in GOOD_DIR; paths are relative to PYTHON_DIR.  Use it with
+    pytestmark = pytest.mark.usefixtures("blocs_callbacks").
+    """
+    from parse_common import ctx
+    from blocs_parser import set_get_block_spec, set_expand_path
+    from bloc_parser import parse_bloc_file, parse_bloc_string
+    blocs = getattr(request.module, "BLOCS", None)
+
+    def block_spec_getter(name, design):
+        if blocs is not None:
+            return parse_bloc_string(blocs[name], source=f"{name}.bloc")
+        bloc_path = GOOD_DIR / f"{name}.bloc"
+        if not bloc_path.is_file():
+            ctx.error(f"'{name}.bloc' not found on block search path")
+            return None
+        return parse_bloc_file(bloc_path.as_posix())
+
+    set_get_block_spec(block_spec_getter)
+    set_expand_path(lambda raw: (PYTHON_DIR / raw).resolve())
+    yield
+    set_get_block_spec(None)
+    set_expand_path(None)
+
+
+def parse_design(blocs_str: str):
+    """ Parses 'blocs_str' into a new Design of /work/sys.blocs; it must parse. """
+    from emblocs import Design
+    from blocs_parser import parse_blocs_string
+    design = Design(abs_path="/work/sys.blocs")
+    assert parse_blocs_string(blocs_str, design) is True
+    return design
+
+
 # ---------------------------------------------------------------------------
 # General C library infrastructure
 # ---------------------------------------------------------------------------
@@ -185,7 +229,7 @@ def assert_process_aborts(prefix: str, setup: str, should_assert: str,
     return result
 
 # ---------------------------------------------------------------------------
-# Bundle C library infrastructure
+# Bundle and mailbox C infrastructure
 # ---------------------------------------------------------------------------
 
 BUNDLE_BUILD_DIR = TMP_DIR / "bundle"
@@ -200,9 +244,8 @@ def _bundle_dll_path() -> Path:
         name = "bundle.so"
     return TMP_DIR / name
 
-@pytest.fixture(scope="session")
-def bundle_dll():
-    """Configures, builds, and loads the Bundle C shared library."""
+def _build_c_targets() -> None:
+    """Configures and builds every target in tests/CMakeLists.txt."""
     subprocess.run(
         ["cmake", "-S", str(TESTS_DIR), "-B", str(BUNDLE_BUILD_DIR), "-G", "Ninja"],
         check=True, capture_output=True, text=True, stdin=subprocess.DEVNULL,
@@ -211,8 +254,21 @@ def bundle_dll():
         ["cmake", "--build", str(BUNDLE_BUILD_DIR)],
         check=True, capture_output=True, text=True, stdin=subprocess.DEVNULL,
     )
+
+@pytest.fixture(scope="session")
+def bundle_dll():
+    """Configures, builds, and loads the Bundle C shared library."""
+    _build_c_targets()
     return ctypes.CDLL(str(_bundle_dll_path()))
 
+@pytest.fixture(scope="session")
+def mailbox_host():
+    """Builds the pthreads mailbox test program; returns its path."""
+    if platform.system() != "Linux":
+        pytest.skip("mailbox_host needs Linux")
+    _build_c_targets()
+    return TMP_DIR / "mailbox_host"
+
 @pytest.fixture(scope="session")
 def bundle_api(bundle_dll):
     from bundle_capi import BundleCAPI
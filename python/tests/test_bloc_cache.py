@@ -0,0 +1,167 @@
+# tests/test_bloc_cache.py
+from __future__ import annotations
+import shutil
+import pytest
+from pathlib import Path
+
+import blocs_compiler
+from blocs_compiler import main
+from bloc_cache import VariantCache, CACHE_DIR_NAME, scan_blocs, prefetch
+from bloc_parser import parse_bloc_file
+from bloc_resolver import resolve
+from parse_common import ctx
+from emblocs_output import C_SENTINEL
+from conftest import TMP_DIR, GOOD_DIR
+
+CACHE_TMP_DIR = TMP_DIR / "cache_tests"
+
+
+# ---------------------------------------------------------------------------
+# Fixtures
+# ---------------------------------------------------------------------------
+
+@pytest.fixture(autouse=True)
+def clean_context():
+    ctx.clear()
+    ctx.push(source="<test>")
+    yield
+    ctx.clear()
+
+@pytest.fixture
+def work_dir() -> Path:
+    """
+    A fresh directory holding parameterized.bloc and simple.bloc, with
+    .h and .c files newer than them, and an empty build directory.
+    """
+    shutil.rmtree(CACHE_TMP_DIR, ignore_errors=True)
+    (CACHE_TMP_DIR / "build").mkdir(parents=True)
+    for name in ("parameterized", "simple"):
+        shutil.copy(GOOD_DIR / f"{name}.bloc", CACHE_TMP_DIR)
+        (CACHE_TMP_DIR / f"{name}.h").write_text("// header\n")
+        (CACHE_TMP_DIR / f"{name}.c").write_text(f"{C_SENTINEL}\n// source\n")
+    return CACHE_TMP_DIR
+
+def write_blocs(work_dir: Path, text: str) -> Path:
+    path = work_dir / "sys.blocs"
+    path.write_text("search .\n" + text)
+    return path
+
+def expander(work_dir: Path):
+    return lambda raw: (work_dir / raw).resolve()
+
+
+# ---------------------------------------------------------------------------
+# Tests
+# ---------------------------------------------------------------------------
+
+class TestKeys:
+    """Tests for VariantCache.spec_key() and def_key()"""
+
+    def test_spec_key_follows_content(self, work_dir):
+        bloc = work_dir / "simple.bloc"
+        key1 = VariantCache(work_dir / "c1").spec_key(bloc)
+        bloc.write_text(bloc.read_text() + "\n")
+        key2 = VariantCache(work_dir / "c2").spec_key(bloc)
+        actual = (key1 is not None, key1 == key2)
+        expected = (True, False)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_def_key_follows_arguments(self, work_dir):
+        cache = VariantCache(work_dir / "cache")
+        spec = parse_bloc_file((work_dir / "parameterized.bloc").as_posix())
+        base = cache.def_key(spec, "p", "parameterized", {"NCHAN": 3, "MASK": 5})
+        actual = [
+            cache.def_key(spec, "p", "parameterized", {"MASK": 5, "NCHAN": 3}) == base,
+            cache.def_key(spec, "p", "parameterized", {"NCHAN": 3, "MASK": 6}) == base,
+            cache.def_key(spec, "q", "parameterized", {"NCHAN": 3, "MASK": 5}) == base,
+        ]
+        expected = [True, False, False]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestStore:
+    """Tests for VariantCache.store() and load()"""
+
+    def test_round_trip(self, work_dir):
+        cache = VariantCache(work_dir / "cache")
+        spec = parse_bloc_file((work_dir / "simple.bloc").as_posix())
+        block_def = resolve(spec, "s", "simple", {})
+        key = cache.def_key(spec, "s", "simple", {})
+        cache.store(key, block_def)
+        actual = cache.load(key)
+        assert actual == block_def, f"\nEXPECT: {block_def!r}\nACTUAL: {actual!r}\n"
+
+    def test_missing_and_damaged(self, work_dir):
+        cache = VariantCache(work_dir / "cache")
+        cache.directory.mkdir()
+        (cache.directory / "bad.pickle").write_bytes(b"not a pickle")
+        actual = (cache.load("missing"), cache.load("bad"), cache.load(None))
+        expected = (None, None, None)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestPrefetch:
+    """Tests for scan_blocs() and prefetch()"""
+
+    BLOCS = ("blockdef p1 parameterized NCHAN=1\n"
+             "blockdef p2 parameterized NCHAN=2 MASK=3\n"
+             "blockdef p3 parameterized NCHAN=9\n"
+             "blockdef s1 simple\n"
+             "blockdef x1 missing\n")
+
+    def test_scan(self, work_dir):
+        blocs = write_blocs(work_dir, self.BLOCS)
+        jobs = scan_blocs(blocs.as_posix(), expander(work_dir))
+        actual = [(job.bloc_path.name, job.variant, job.params) for job in jobs]
+        expected = [
+            ("parameterized.bloc", "p1", {"NCHAN": 1}),
+            ("parameterized.bloc", "p2", {"NCHAN": 2, "MASK": 3}),
+            ("parameterized.bloc", "p3", {"NCHAN": 9}),
+            ("simple.bloc", "s1", {}),
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    @pytest.mark.parametrize("workers", [1, 2])
+    def test_prefetch(self, work_dir, workers, capsys):
+        # p3 is out of range, so it isn't cached, and nothing is reported
+        blocs = write_blocs(work_dir, self.BLOCS)
+        cache = VariantCache(work_dir / "cache")
+        prefetch(cache, blocs.as_posix(), expander(work_dir), workers)
+        spec = cache.load(cache.spec_key(work_dir / "parameterized.bloc"))
+        actual = (capsys.readouterr().err, cache.resolved, cache.workers,
+                  [cache.contains(cache.def_key(spec, name, "parameterized", params))
+                   for name, params in (("p1", {"NCHAN": 1}), ("p3", {"NCHAN": 9}))])
+        expected = ("", 3, 0 if workers == 1 else 2, [True, False])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestCompiler:
+    """Tests for the cache in blocs_compiler.main()"""
+
+    BLOCS = ("blockdef p1 parameterized NCHAN=1 MASK=1 HAS_ENABLE=1\n"
+             "blockdef p2 parameterized\n"
+             "blockdef s1 simple\n")
+
+    def run(self, blocs: Path, build: Path, capsys, *options: str) -> list[str]:
+        assert main([str(blocs), str(build), *options]) == 0
+        return [line for line in capsys.readouterr().err.splitlines() if "variants:" in line]
+
+    def test_second_run_hits(self, work_dir, monkeypatch, capsys):
+        monkeypatch.setattr(blocs_compiler, 'generate_system_files', lambda d, b: None)
+        blocs = write_blocs(work_dir, self.BLOCS)
+        build = work_dir / "build"
+        actual = [self.run(blocs, build, capsys, "-j", "1") for _ in range(2)]
+        expected = [
+            ["blocs_compiler.py: info: variants: 0 from cache, 3 resolved"],
+            ["blocs_compiler.py: info: variants: 3 from cache, 0 resolved"],
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_no_cache(self, work_dir, monkeypatch, capsys):
+        monkeypatch.setattr(blocs_compiler, 'generate_system_files', lambda d, b: None)
+        blocs = write_blocs(work_dir, self.BLOCS)
+        build = work_dir / "build"
+        actual = (self.run(blocs, build, capsys, "--no-cache"),
+                  (build / CACHE_DIR_NAME).exists())
+        expected = ([], False)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
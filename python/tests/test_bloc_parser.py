@@ -891,24 +891,67 @@ class TestParseFunction:
         assert func.name == "update"
         assert func.dedup_name == "update_"
         assert func.description == " the update function"
+        assert func.on_change is False
 
-    def test_too_many_tokens(self, capsys):
+    def test_on_change(self):
+        spec = parse_bloc_string(
+            "/// a block\n"
+            "function update on_change /// the update function\n"
+        )
+        assert spec is not None
+        func = spec.statements[0].statement
+        actual = (func.name, func.on_change, func.description)
+        expected = ("update", True, " the update function")
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_unknown_attribute(self, capsys):
         spec = parse_bloc_string(
             "/// a block\n"
             "function update extra\n"
         )
         actual = capsys.readouterr().err.strip()
-        expected = "<string>:2:1: error: 'function' declaration should be 'function <name>'"
+        expected = "<string>:2:17: error: unknown function attribute: 'extra'"
         assert actual == expected
         assert spec is None
 
+    def test_costs(self):
+        spec = parse_bloc_string(
+            "/// a block\n"
+            "param u32 N default=4 min=1 max=8 /// channels\n"
+            "function update cost=40+12*N on_change cost.rp2040=30+9*N\n"
+        )
+        assert spec is not None
+        func = spec.statements[0].statement
+        actual = (func.on_change, func.costs, str(func))
+        expected = (True, (("", "40+12*N"), ("rp2040", "30+9*N")),
+                    "function  update  on_change  cost=40+12*N  cost.rp2040=30+9*N")
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    @pytest.mark.parametrize("attrs, message", [
+        ("on_change on_change", "2:27: error: duplicate function attribute: 'on_change'"),
+        ("cost=1 cost=2", "2:24: error: duplicate function attribute: 'cost'"),
+        ("cost.=1", "2:17: error: unknown function attribute: 'cost.=1'"),
+        ("cost", "2:17: error: unknown function attribute: 'cost'"),
+        ("cost=N", "2:17: error: invalid cost: expression 'N': unknown variable: 'N'"),
+        ("cost=1-2", "2:17: error: invalid cost: -1; must not be negative"),
+    ])
+    def test_bad_costs(self, attrs, message, capsys):
+        spec = parse_bloc_string(
+            "/// a block\n"
+            f"function update {attrs}\n"
+        )
+        actual = (capsys.readouterr().err.strip(), spec)
+        expected = (f"<string>:{message}", None)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
     def test_too_few_tokens(self, capsys):
         spec = parse_bloc_string(
             "/// a block\n"
             "function\n"
         )
         actual = capsys.readouterr().err.strip()
-        expected = "<string>:2:1: error: 'function' declaration should be 'function <name>'"
+        expected = ("<string>:2:1: error: 'function' declaration should be "
+                    "'function <name> [on_change] [cost[.<target>]=<expr>]'")
         assert actual == expected
         assert spec is None
 
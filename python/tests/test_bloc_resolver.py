@@ -137,6 +137,34 @@ class TestResolveTopLevel:
         assert list(block_def.functions.keys()) == ["update"]
         assert list(block_def.namespace.keys()) == ["in", "update"]
 
+    def test_function_on_change(self):
+        spec = parse_bloc_string(
+            "/// the foo block\n"
+            "function update on_change\n"
+            "function reset\n"
+        )
+        assert spec is not None
+        block_def = resolve(spec, "foo", "components/foo.bloc")
+        actual = [(f.name, f.on_change) for f in block_def.functions.values()]
+        expected = [("update", True), ("reset", False)]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_function_costs(self):
+        spec = parse_bloc_string(
+            "/// the foo block\n"
+            "param u32 N default=2 min=1 max=8\n"
+            "function update cost=10+5*N cost.rp2040=4*N\n"
+            "function reset\n"
+        )
+        assert spec is not None
+        block_def = resolve(spec, "foo", "components/foo.bloc", {"N": 3})
+        update = block_def.functions["update"]
+        reset = block_def.functions["reset"]
+        actual = (update.costs, update.cost(), update.cost("rp2040"), update.cost("stm32"),
+                  reset.cost())
+        expected = ((("", 25), ("rp2040", 12)), 25, 12, 25, None)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
     def test_supplied_params_none_uses_defaults(self):
         spec = parse_bloc_string(
             "/// foo block\n"
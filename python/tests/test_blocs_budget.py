@@ -0,0 +1,136 @@
+# tests/test_blocs_budget.py
+from __future__ import annotations
+import pytest
+from parse_common import ctx
+from emblocs import Design
+from blocs_budget import plan_budget, read_measured
+import blocs_compiler
+
+from conftest import TMP_DIR, parse_design
+
+
+# ---------------------------------------------------------------------------
+# Fixtures
+# ---------------------------------------------------------------------------
+
+@pytest.fixture(autouse=True)
+def clean_context():
+    ctx.clear()
+    ctx.push(source="<test>")
+    yield
+    ctx.clear()
+
+BLOCS = {
+    "costed": (
+        "/// a block with costs\n"
+        "param u32 N default=2 min=1 max=8\n"
+        "pin float input in\n"
+        "pin float output out\n"
+        "function update cost=100*N cost.rp2040=60*N\n"
+        "function reset\n"
+    ),
+}
+
+pytestmark = pytest.mark.usefixtures("blocs_callbacks")
+
+def make_design() -> Design:
+    """
+    a1 and a2 (N=2) run in fast, at 1 us; b1 (N=5) and the reset of a1,
+    which has no cost, in slow, at 10 us; b2 is on core 1
+    """
+    blocs_str = (
+        "blockdef ca costed\n"
+        "blockdef cb costed N=5\n"
+        "block a1 ca\n"
+        "block a2 ca\n"
+        "block b1 cb\n"
+        "block b2 cb\n"
+        "thread fast 1000 +a1.update +a2.update\n"
+        "thread slow 10000 +b1.update +a1.reset\n"
+        "thread other 10000 +b2.update\n"
+        "other @1\n"
+    )
+    return parse_design(blocs_str)
+
+def summary(budget) -> list[tuple]:
+    return [(tb.thread.name, tb.cycles, tb.period, [f.full_name for f in tb.unknown])
+            for tb in budget.threads]
+
+
+# ---------------------------------------------------------------------------
+# Tests
+# ---------------------------------------------------------------------------
+
+class TestPlanBudget:
+    """Tests for plan_budget()"""
+
+    def test_annotations(self):
+        budget = plan_budget(make_design(), clock_hz=1_000_000_000)
+        actual = (summary(budget), budget.core_loads())
+        expected = ([("fast", 400, 1000, []), ("slow", 500, 10000, ["a1.reset"]),
+                     ("other", 500, 10000, [])],
+                    {0: 45.0, 1: 5.0})
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_target_and_measured(self):
+        design = make_design()
+        budget = plan_budget(design, "rp2040", {"a1.update": 70, "a1.reset": 9, "zz.update": 1})
+        actual = (summary(budget), budget.measured,
+                  [f.cycles for f in design.threads["fast"].functions], ctx.warning_count)
+        expected = ([("fast", 190, 0, []), ("slow", 309, 0, []), ("other", 300, 0, [])], 2,
+                    [70, 120], 1)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_no_costs(self):
+        design = make_design()
+        actual = plan_budget(design, measured={"a1.reset": 0}) is not None, plan_budget(
+            Design(abs_path="/work/empty.blocs"))
+        expected = (True, None)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestReadMeasured:
+    """Tests for read_measured()"""
+
+    def test_show_output(self):
+        path = TMP_DIR / "measured.txt"
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(
+            " thread 'fast', period 1000 ns\n"
+            "     a1.update\n"
+            "        last 61, min 58, max 75, mean 60, 1000 calls\n"
+            "     a2.update (off)\n"
+            "        last 0, min 0, max 0, mean 0, 0 calls\n"
+            "# measured by hand\n"
+            "b1.update 420   # worst seen\n"
+        )
+        actual = read_measured(path.as_posix())
+        expected = {"a1.update": 75, "b1.update": 420}
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_missing_file(self, capsys):
+        actual = (read_measured((TMP_DIR / "no_such_file.txt").as_posix()),
+                  "error: file" in capsys.readouterr().err)
+        expected = (None, True)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestReportBudget:
+    """Tests for blocs_compiler.report_budget()"""
+
+    def test_overloaded_core_fails(self, monkeypatch, capsys):
+        monkeypatch.setattr(blocs_compiler, "max_load", 40.0)
+        budget = plan_budget(make_design(), clock_hz=1_000_000_000)
+        capsys.readouterr()
+        blocs_compiler.report_budget(budget)
+        actual = capsys.readouterr().err.splitlines()
+        expected = [
+            "<test>: info: budget: thread fast: 400 cycles per run, 40.0% of 1000 cycles",
+            "<test>: info: budget: thread slow: 500 cycles per run, 5.0% of 10000 cycles;"
+            " no cost for a1.reset",
+            "<test>: info: budget: thread other: 500 cycles per run, 5.0% of 10000 cycles",
+            "<test>: error: budget: core 0 is 45.0% loaded at 1000000000 Hz,"
+            " more than --max-load 40%",
+            "<test>: info: budget: core 1 is 5.0% loaded at 1000000000 Hz",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
@@ -0,0 +1,171 @@
+# tests/test_blocs_changes.py
+from __future__ import annotations
+import pytest
+from parse_common import ctx
+from emblocs import Design
+from blocs_mailboxes import plan_mailboxes
+from blocs_changes import plan_changes
+from emblocs_output import thread_as_c_system
+
+from conftest import parse_design
+
+
+# ---------------------------------------------------------------------------
+# Fixtures
+# ---------------------------------------------------------------------------
+
+@pytest.fixture(autouse=True)
+def clean_context():
+    ctx.clear()
+    ctx.push(source="<test>")
+    yield
+    ctx.clear()
+
+pytestmark = pytest.mark.usefixtures("blocs_callbacks")
+
+def make_design(threads: str) -> Design:
+    """
+    b1 (simple) writes s1, which k1 and k2 read; k1 writes s2, which
+    k3 reads; nothing writes ofs, which k1 reads.  k1, k2 and k3 are
+    skippable.
+    """
+    blocs_str = (
+        "blockdef simple simple\n"
+        "blockdef skippable skippable\n"
+        "block b1 simple\n"
+        "block k1 skippable\n"
+        "block k2 skippable\n"
+        "block k3 skippable\n"
+        "signal s1 float +b1.out +k1.in +k2.in\n"
+        "signal s2 float +k1.out +k3.in\n"
+        "signal ofs float +k1.offset\n"
+    ) + threads
+    return parse_design(blocs_str)
+
+def summary(plan) -> list[tuple[str, str, list[str]]]:
+    return [(check.value, check.shadow, check.flags) for check in plan.checks]
+
+
+# ---------------------------------------------------------------------------
+# Tests
+# ---------------------------------------------------------------------------
+
+class TestPlanChanges:
+    """Tests for plan_changes()"""
+
+    def test_no_on_change_functions(self):
+        design = make_design("thread fast 1000000 +b1.update\n")
+        plan = plan_changes(design)
+        actual = (plan.flags, summary(plan))
+        expected = ({}, [])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_checks(self):
+        # s1 and s2 are checked by their writers, once for all readers;
+        # ofs has no writer, so k1 checks it itself
+        design = make_design(
+            "thread fast 1000000 +b1.update +k1.update +k2.update +k3.update\n")
+        plan = plan_changes(design)
+        b1 = design.blocks["b1"].functions["update"]
+        k1 = design.blocks["k1"].functions["update"]
+        actual = (list(plan.flags.values()), summary(plan),
+                  [c.value for c in plan.after[id(b1)]],
+                  [c.value for c in plan.after[id(k1)]],
+                  [c.value for c in plan.before[id(k1)]])
+        expected = (["chg_k1_update", "chg_k2_update", "chg_k3_update"],
+                    [("sig_s1", "chg_sig_s1", ["chg_k1_update", "chg_k2_update"]),
+                     ("sig_ofs", "chg_k1_update_ofs", ["chg_k1_update"]),
+                     ("sig_s2", "chg_sig_s2", ["chg_k3_update"])],
+                    ["sig_s1"], ["sig_s2"], ["sig_ofs"])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_writer_not_in_thread(self):
+        # b1 never runs, so s1 can only be changed by the application
+        design = make_design("thread fast 1000000 +k2.update\n")
+        plan = plan_changes(design)
+        actual = summary(plan)
+        expected = [("sig_s1", "chg_k2_update_s1", ["chg_k2_update"])]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_cross_core(self):
+        # k2 reads the copy of s1 on core 1, checked when it is taken
+        design = make_design(
+            "thread fast 1000000 +b1.update\n"
+            "thread remote 1000000 @1 +k2.update\n")
+        routing = plan_mailboxes(design)
+        plan = plan_changes(design, routing)
+        actual = (summary(plan), list(plan.taken.keys()))
+        expected = ([("sig_s1_core1", "chg_sig_s1_core1", ["chg_k2_update"])],
+                    ["mbox_fast_remote"])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestChangeOutput:
+    """Tests for the generated change tracking in thread functions"""
+
+    def test_thread(self):
+        design = make_design(
+            "thread fast 1000000 +b1.update +k1.update +k3.update\n")
+        plan = plan_changes(design)
+        lines = []
+        thread_as_c_system(lines, design.threads["fast"], "sys", None, plan)
+        start = lines.index("void sys_fast(uint32_t periodns) {")
+        actual = [line for line in lines[start:] if "PROFILE" not in line]
+        expected = [
+            "void sys_fast(uint32_t periodns) {",
+            "    BL_THREAD_STATS_BEGIN(stats_fast);",
+            "    if ( BL_FUNCTION_ENABLED(en_b1_update) ) {",
+            "        simple_update(&blk_b1, periodns);",
+            "        if ( sig_s1 != chg_sig_s1 ) {",
+            "            chg_sig_s1 = sig_s1;",
+            "            chg_k1_update = 1;",
+            "        }",
+            "    }",
+            "    if ( sig_ofs != chg_k1_update_ofs ) {",
+            "        chg_k1_update_ofs = sig_ofs;",
+            "        chg_k1_update = 1;",
+            "    }",
+            "    if ( BL_FUNCTION_ENABLED(en_k1_update) && chg_k1_update ) {",
+            "        chg_k1_update = 0;",
+            "        skippable_update(&blk_k1, periodns);",
+            "        if ( sig_s2 != chg_sig_s2 ) {",
+            "            chg_sig_s2 = sig_s2;",
+            "            chg_k3_update = 1;",
+            "        }",
+            "    }",
+            "    if ( BL_FUNCTION_ENABLED(en_k3_update) && chg_k3_update ) {",
+            "        chg_k3_update = 0;",
+            "        skippable_update(&blk_k3, periodns);",
+            "    }",
+            "    BL_THREAD_STATS_END(stats_fast);",
+            "}",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_meta_relinked_pins(self):
+        # on a --meta system the application can link k3.in to another
+        # signal, or set the unconnected k3.offset; k3 reads both through
+        # its pin pointers, so either change makes it run again
+        design = make_design(
+            "thread fast 1000000 +b1.update +k1.update +k3.update\n")
+        plan = plan_changes(design, pin_pointers=True)
+        lines = []
+        thread_as_c_system(lines, design.threads["fast"], "sys", None, plan, meta=True)
+        start = lines.index("void sys_fast(uint32_t periodns) {")
+        actual = (summary(plan), plan.after,
+                  [line for line in lines[start:] if "k3" in line])
+        expected = ([("*blk_k1.in_", "chg_k1_update_in", ["chg_k1_update"]),
+                     ("*blk_k1.offset_", "chg_k1_update_offset", ["chg_k1_update"]),
+                     ("*blk_k3.in_", "chg_k3_update_in", ["chg_k3_update"]),
+                     ("*blk_k3.offset_", "chg_k3_update_offset", ["chg_k3_update"])],
+                    {},
+                    ["    if ( *blk_k3.in_ != chg_k3_update_in ) {",
+                     "        chg_k3_update_in = *blk_k3.in_;",
+                     "        chg_k3_update = 1;",
+                     "    if ( *blk_k3.offset_ != chg_k3_update_offset ) {",
+                     "        chg_k3_update_offset = *blk_k3.offset_;",
+                     "        chg_k3_update = 1;",
+                     "    if ( BL_FUNCTION_ENABLED(en_k3_update) && chg_k3_update ) {",
+                     "        chg_k3_update = 0;",
+                     "        skippable_update(&blk_k3, periodns);"])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
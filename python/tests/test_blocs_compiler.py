@@ -6,7 +6,7 @@ import pytest
 from pathlib import Path
 
 import blocs_compiler
-from blocs_compiler import expand_path, get_blockspec, main
+from blocs_compiler import expand_path, get_blockspec, main, amalgamation_summary
 from emblocs import Design
 from parse_common import ctx
 from conftest import TMP_DIR, PYTHON_DIR, GOOD_DIR
@@ -262,6 +262,17 @@ class TestMain:
         assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
         assert result == 1
 
+    def test_meta_with_fold(self, capsys):
+        # the folded signals would be outside the generated RT pool
+        result = main([str(COMPILER_GOOD_DIR / "simple_test.blocs"),
+                      str(COMPILER_TMP_DIR), "--meta", "--fold"])
+        actual = capsys.readouterr().err.strip()
+        expected = (
+            "blocs_compiler.py: error: --meta can't be combined with --fold or --flash-pins\n"
+            "blocs_compiler.py: 1 error(s), 0 warning(s), 0 info(s)")
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+        assert result == 1
+
     def test_happy_path(self, monkeypatch, capsys, compiler_good_timestamps):
         captured = {}
 
@@ -316,3 +327,25 @@ class TestMain:
         assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
         assert result == 1
 
+
+class TestAmalgamationSummary:
+    """Tests for amalgamation_summary(), the --amalgamate report"""
+
+    CALLS = ["lim_update", "lim_update", "mux_update"]
+
+    def test_measured(self):
+        sizes = {"lim_update": 40, "mux_update": 100}
+        actual = amalgamation_summary(self.CALLS, sizes, 300, 1)
+        expected = ("3 call(s) per run, 300 cycles + 1 function(s) without a cost;"
+                    " 140 bytes as calls vs ~180 bytes inlined")
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_inlined(self):
+        actual = amalgamation_summary(self.CALLS, {}, 300, 0, inlined=150)
+        expected = "3 call(s) per run, 300 cycles; 150 bytes inlined"
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_unknown(self):
+        actual = amalgamation_summary(self.CALLS, {"lim_update": 40}, 0, 3)
+        expected = "3 call(s) per run, cycles unknown; code size unknown, see --sizes"
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
@@ -0,0 +1,129 @@
+# tests/test_blocs_constants.py
+from __future__ import annotations
+import pytest
+from parse_common import ctx
+from emblocs import Design
+from blocs_constants import plan_constants, drop_functions
+from blocs_changes import plan_changes
+from emblocs_output import design_as_c_system, block_as_c_direct
+
+from conftest import parse_design
+
+
+# ---------------------------------------------------------------------------
+# Fixtures
+# ---------------------------------------------------------------------------
+
+@pytest.fixture(autouse=True)
+def clean_context():
+    ctx.clear()
+    ctx.push(source="<test>")
+    yield
+    ctx.clear()
+
+pytestmark = pytest.mark.usefixtures("blocs_callbacks")
+
+def make_design(extra: str = "") -> Design:
+    """
+    b1 (simple) writes s1, which k1 reads; k1 writes s2, which k2
+    reads; k2 writes s3, which nothing reads.  ofs is set but never
+    driven.  k1 and k2 are skippable.
+    """
+    blocs_str = (
+        "blockdef simple simple\n"
+        "blockdef skippable skippable\n"
+        "block b1 simple\n"
+        "block k1 skippable\n"
+        "block k2 skippable\n"
+        "signal s1 float +b1.out +k1.in\n"
+        "signal s2 float +k1.out +k2.in\n"
+        "signal s3 float +k2.out\n"
+        "signal ofs float =1.5 +k1.offset +k2.offset\n"
+        "thread fast 1000000 +b1.update +k1.update +k2.update\n"
+    ) + extra
+    return parse_design(blocs_str)
+
+
+# ---------------------------------------------------------------------------
+# Tests
+# ---------------------------------------------------------------------------
+
+class TestPlanConstants:
+    """Tests for plan_constants()"""
+
+    def test_constants(self):
+        plan = plan_constants(make_design())
+        actual = [signal.name for signal in plan.signals.values()]
+        expected = ["ofs"]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_dead_chain(self):
+        # nothing reads s3, so k2 is dead, and then so is k1; b1 isn't
+        # on_change, so it stays
+        plan = plan_constants(make_design())
+        actual = [func.full_name for func in plan.dead]
+        expected = ["k1.update", "k2.update"]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_reader_not_running(self):
+        # b2 reads s3, but never runs
+        plan = plan_constants(make_design(
+            "block b2 simple\n"
+            "s3 +b2.in\n"))
+        actual = [func.full_name for func in plan.dead]
+        expected = ["k1.update", "k2.update"]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_reader_running(self):
+        plan = plan_constants(make_design(
+            "block b2 simple\n"
+            "s3 +b2.in\n"
+            "fast +b2.update\n"))
+        actual = [func.full_name for func in plan.dead]
+        expected = []
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_drop(self):
+        design = make_design()
+        plan = plan_constants(design)
+        drop_functions(plan.dead)
+        actual = ([func.full_name for func in design.threads["fast"].functions],
+                  design.blocks["k1"].functions["update"].thread)
+        expected = (["b1.update"], None)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestConstantOutput:
+    """Tests for the generated code for folded signals"""
+
+    def test_no_change_checks(self):
+        # a folded signal can't change, so k1 doesn't check it
+        design = make_design()
+        plan = plan_changes(design, None, plan_constants(design))
+        actual = [check.value for check in plan.checks]
+        expected = ["sig_s1", "sig_s2"]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_system(self):
+        design = make_design()
+        lines = []
+        design_as_c_system(lines, design, None, None, None, False, (), plan_constants(design))
+        actual = [line for line in lines if "ofs" in line]
+        expected = [
+            "bl_float_t const sig_ofs = 1.5;",
+            "    .offset_ = (bl_pin_float_t)&sig_ofs,",
+            "    .offset_ = (bl_pin_float_t)&sig_ofs,",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_direct_literal(self):
+        design = make_design()
+        lines = ["// EMBLOCS:  DO NOT REMOVE OR EDIT ABOVE THIS LINE"]
+        block_as_c_direct(lines, design.blocks["k1"], None, plan_constants(design).signals)
+        actual = [line for line in lines if "ofs" in line or "OFFSET_ " in line]
+        expected = [
+            "extern bl_float_t const sig_ofs;",
+            "#define pOFFSET_  ((bl_pin_float_t)&sig_ofs)",
+            "#define OFFSET_  ((bl_float_t)1.5)",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
@@ -0,0 +1,123 @@
+# tests/test_blocs_dataflow.py
+from __future__ import annotations
+import pytest
+from parse_common import ctx
+from emblocs import Design
+from blocs_dataflow import plan_dataflow, late_links, apply_order
+
+from conftest import parse_design
+
+
+# ---------------------------------------------------------------------------
+# Fixtures
+# ---------------------------------------------------------------------------
+
+@pytest.fixture(autouse=True)
+def clean_context():
+    ctx.clear()
+    ctx.push(source="<test>")
+    yield
+    ctx.clear()
+
+pytestmark = pytest.mark.usefixtures("blocs_callbacks")
+
+def make_design(rest: str) -> Design:
+    blocs_str = (
+        "blockdef simple simple\n"
+        "blockdef two_functs two_functs\n"
+        "block b1 simple\n"
+        "block b2 simple\n"
+        "block b3 simple\n"
+    ) + rest
+    return parse_design(blocs_str)
+
+def names(funcs) -> list[str]:
+    return [func.full_name for func in funcs]
+
+
+# ---------------------------------------------------------------------------
+# Tests
+# ---------------------------------------------------------------------------
+
+class TestFunctionPins:
+    """Tests for BlockDef.function_pins()"""
+
+    def test_association(self):
+        design = make_design("")
+        block_def = design.block_defs["two_functs"]
+        actual = ([pin.name for pin in block_def.function_pins("sample")],
+                  [pin.name for pin in block_def.function_pins("compute")])
+        expected = (["enable", "in"], ["enable", "out"])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestPlanDataflow:
+    """Tests for plan_dataflow() and friends"""
+
+    def test_already_sorted(self):
+        design = make_design(
+            "signal s1 float +b1.out +b2.in\n"
+            "signal s2 float +b2.out +b3.in\n"
+            "thread fast 1000000 +b1.update +b3.update +b2.update\n")
+        # b3 only has to follow b2
+        plan = plan_dataflow(design)
+        actual = (names(plan.order["fast"]), names(l.reader for l in late_links(plan, design)))
+        expected = (["b1.update", "b2.update", "b3.update"], ["b3.update"])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_stable(self):
+        # nothing links b1 and b3, so they keep their order
+        design = make_design(
+            "signal s1 float +b2.out +b3.in\n"
+            "thread fast 1000000 +b3.update +b1.update +b2.update\n")
+        plan = plan_dataflow(design)
+        actual = names(plan.order["fast"])
+        expected = ["b1.update", "b2.update", "b3.update"]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_apply(self):
+        design = make_design(
+            "signal s1 float +b1.out +b2.in\n"
+            "thread fast 1000000 +b2.update +b1.update\n"
+            "thread slow 2000000 +b3.update\n")
+        plan = plan_dataflow(design)
+        changed = apply_order(plan, design)
+        actual = ([t.name for t in changed], names(design.threads["fast"].functions),
+                  late_links(plan, design))
+        expected = (["fast"], ["b1.update", "b2.update"], [])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_loop(self):
+        # b1 and b2 feed each other, and stay in their order as a group
+        design = make_design(
+            "signal s1 float +b1.out +b2.in\n"
+            "signal s2 float +b2.out +b1.in +b3.in\n"
+            "thread fast 1000000 +b3.update +b2.update +b1.update\n")
+        plan = plan_dataflow(design)
+        actual = ([names(loop) for loop in plan.loops], names(plan.order["fast"]))
+        expected = ([["b2.update", "b1.update"]], ["b2.update", "b1.update", "b3.update"])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_crossing(self):
+        design = make_design(
+            "signal s1 float +b1.out +b2.in\n"
+            "thread fast 1000000 +b1.update\n"
+            "thread slow 2000000 +b2.update\n")
+        plan = plan_dataflow(design)
+        actual = ([(l.signal.name, l.writer.full_name, l.reader.full_name) for l in plan.crossing],
+                  plan.links)
+        expected = ([("s1", "b1.update", "b2.update")], [])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_function_pins(self):
+        # t.sample reads what b1 writes, t.compute writes what b2 reads;
+        # with all of t's pins on both functions this would be a loop
+        design = make_design(
+            "block t two_functs\n"
+            "signal s1 float +b1.out +t.in\n"
+            "signal s2 float +t.out +b2.in\n"
+            "thread fast 1000000 +t.compute +b2.update +b1.update +t.sample\n")
+        plan = plan_dataflow(design)
+        actual = (names(plan.order["fast"]), plan.loops)
+        expected = (["t.compute", "b2.update", "b1.update", "t.sample"], [])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
@@ -0,0 +1,164 @@
+# tests/test_blocs_footprint.py
+from __future__ import annotations
+import json
+import pytest
+from parse_common import ctx
+from emblocs import Design
+from blocs_footprint import plan_footprint, read_sizes
+from emblocs_output import footprint_as_text, footprint_as_json
+
+from conftest import TMP_DIR, parse_design
+
+
+# ---------------------------------------------------------------------------
+# Fixtures
+# ---------------------------------------------------------------------------
+
+@pytest.fixture(autouse=True)
+def clean_context():
+    ctx.clear()
+    ctx.push(source="<test>")
+    yield
+    ctx.clear()
+
+BLOCS = {
+    "filt": (
+        "/// a filter\n"
+        "pin float input in\n"
+        "pin float output out\n"
+        "pin u32 input gain\n"
+        "function update\n"
+        "function reset\n"
+    ),
+}
+
+pytestmark = pytest.mark.usefixtures("blocs_callbacks")
+
+def make_design() -> Design:
+    """
+    a1 and a2 run in fast, and the reset of a1 in slow; b1 is in no
+    thread; a1.out drives a2.in, every other pin has a dummy
+    """
+    blocs_str = (
+        "blockdef f filt\n"
+        "block a1 f\n"
+        "block a2 f\n"
+        "block b1 f\n"
+        "signal s float +a1.out +a2.in\n"
+        "thread fast 1000 +a1.update +a2.update\n"
+        "thread slow 10000 +a1.reset\n"
+    )
+    return parse_design(blocs_str)
+
+SIZES = {"blk_a1": 20, "pins_a1": 24, "dsig_a1_in": 4, "f_update": 100, "sys_fast": 30}
+
+def summary(footprint) -> tuple:
+    return ([(b.name, b.struct, b.pin_table, b.dummies, b.dummy_ram, b.thread, b.measured)
+             for b in footprint.blocks],
+            [(t.name, t.ram, t.flash, t.code, t.unknown) for t in footprint.threads],
+            (footprint.ram, footprint.flash, footprint.code))
+
+
+# ---------------------------------------------------------------------------
+# Tests
+# ---------------------------------------------------------------------------
+
+class TestPlanFootprint:
+    """Tests for plan_footprint()"""
+
+    def test_estimated(self):
+        actual = summary(plan_footprint(make_design()))
+        expected = ([("a1", 12, 0, 2, 8, "fast", False), ("a2", 12, 0, 2, 8, "fast", False),
+                     ("b1", 12, 0, 3, 12, None, False)],
+                    [("fast", 40, 0, 0, ["f_update"]), ("slow", 0, 0, 0, ["f_reset"])],
+                    (64, 0, 0))
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_measured(self):
+        footprint = plan_footprint(make_design(), SIZES, flash_pins=True)
+        variant = footprint.variants["f"]
+        actual = (*summary(footprint), variant.struct, variant.code)
+        expected = ([("a1", 20, 24, 2, 8, "fast", True), ("a2", 20, 24, 2, 8, "fast", False),
+                     ("b1", 20, 24, 3, 12, None, False)],
+                    [("fast", 56, 48, 130, []), ("slow", 0, 0, 0, ["f_reset"])],
+                    (88, 72, 100), 20, {"update": 100, "reset": None})
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestReadSizes:
+    """Tests for read_sizes()"""
+
+    def test_map(self):
+        path = TMP_DIR / "sizes.map"
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(
+            "Discarded input sections\n"
+            "\n"
+            " .text.f_reset   0x00000000       0x10 sys.o\n"
+            "\n"
+            "Linker script and memory map\n"
+            "\n"
+            " .text.f_update  0x10000100       0x64 sys.o\n"
+            " .text.a_very_long_function_name\n"
+            "                 0x10000164       0x1c sys.o\n"
+            " .bss.blk_a1     0x20000010       0x14 sys.o\n"
+            "                 0x20000010                blk_a1\n"
+        )
+        actual = read_sizes(path.as_posix())
+        expected = {"f_update": 100, "a_very_long_function_name": 28, "blk_a1": 20}
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_nm(self):
+        path = TMP_DIR / "sizes.nm"
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(
+            "10000100 00000064 T f_update\n"
+            "20000010 00000014 B blk_a1\n"
+            "         U memcpy\n"
+        )
+        actual = read_sizes(path.as_posix())
+        expected = {"f_update": 100, "blk_a1": 20}
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_missing_file(self, capsys):
+        actual = (read_sizes((TMP_DIR / "no_such_file.map").as_posix()),
+                  "error: file" in capsys.readouterr().err)
+        expected = (None, True)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestFootprintOutput:
+    """Tests for footprint_as_text() and footprint_as_json()"""
+
+    def test_text(self):
+        design = make_design()
+        lines: list[str] = []
+        footprint_as_text(lines, design, plan_footprint(design))
+        actual = lines
+        expected = [
+            "Footprint of sys.blocs, in bytes (estimated, ~; ? unknown)",
+            "",
+            "variant              blocks  struct   pins  code",
+            "f                         3     ~12     ~0  update ?, reset ?",
+            "",
+            "block                variant               struct   pins  dummies  thread",
+            "a1                   f                        ~12     ~0     2/~8  fast",
+            "a2                   f                        ~12     ~0     2/~8  fast",
+            "b1                   f                        ~12     ~0    3/~12  -",
+            "",
+            "thread                   RAM  flash    code  unknown code",
+            "fast                      40      0       0  f_update",
+            "slow                       0      0       0  f_reset",
+            "(no thread)               24      0       0  -",
+            "total                     64      0       0",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_json(self):
+        lines: list[str] = []
+        footprint_as_json(lines, plan_footprint(make_design(), SIZES))
+        data = json.loads("\n".join(lines))
+        actual = (data["measured"], data["totals"], data["threads"][0])
+        expected = (True, {"ram": 88, "flash": 0, "code": 100},
+                    {"name": "fast", "ram": 56, "flash": 0, "code": 130, "unknown": []})
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
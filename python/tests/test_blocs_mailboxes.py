@@ -0,0 +1,150 @@
+# tests/test_blocs_mailboxes.py
+from __future__ import annotations
+import pytest
+import subprocess
+from parse_common import ctx
+from emblocs import Design
+from blocs_mailboxes import plan_mailboxes
+from emblocs_output import mailbox_as_c_functions, thread_as_c_system
+
+from conftest import parse_design
+
+
+# ---------------------------------------------------------------------------
+# Fixtures
+# ---------------------------------------------------------------------------
+
+@pytest.fixture(autouse=True)
+def clean_context():
+    ctx.clear()
+    ctx.push(source="<test>")
+    yield
+    ctx.clear()
+
+pytestmark = pytest.mark.usefixtures("blocs_callbacks")
+
+def make_design(threads: str) -> Design:
+    """ b1 writes s1, which b2 and b3 read; b2 writes s2, which b4 reads """
+    blocs_str = (
+        "blockdef simple simple\n"
+        "block b1 simple\n"
+        "block b2 simple\n"
+        "block b3 simple\n"
+        "block b4 simple\n"
+        "signal s1 float +b1.out +b2.in +b3.in\n"
+        "signal s2 float +b2.out +b4.in\n"
+    ) + threads
+    return parse_design(blocs_str)
+
+def summary(routing) -> list[tuple[str, str, list[str]]]:
+    return [(m.producer.name, m.consumer.name, [s.name for s in m.signals])
+            for m in routing.mailboxes]
+
+
+# ---------------------------------------------------------------------------
+# Tests
+# ---------------------------------------------------------------------------
+
+class TestPlanMailboxes:
+    """Tests for plan_mailboxes()"""
+
+    def test_single_core(self):
+        design = make_design(
+            "thread fast 1000000 +b1.update +b2.update +b3.update +b4.update\n")
+        routing = plan_mailboxes(design)
+        actual = (summary(routing), routing.targets)
+        expected = ([], {})
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_crossing_signal(self):
+        # s1 crosses to core 1, s2 stays on core 1; the faster of
+        # the two threads that read s1 on core 1 takes it
+        design = make_design(
+            "thread fast 1000000 +b1.update +b3.update\n"
+            "thread slow 2000000 @1 +b4.update\n"
+            "thread remote 1000000 @1 +b2.update\n")
+        routing = plan_mailboxes(design)
+        b2_in = design.blocks["b2"].pins["in"]
+        actual = (summary(routing), routing.targets)
+        expected = ([("fast", "remote", ["s1"])], {id(b2_in): "sig_s1_core1"})
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_writer_not_in_thread(self):
+        # nothing writes s1 at run time, so there is nothing to send
+        design = make_design(
+            "thread fast 1000000 +b3.update\n"
+            "thread remote 1000000 @1 +b2.update +b4.update\n")
+        routing = plan_mailboxes(design)
+        actual = (summary(routing), routing.targets)
+        expected = ([], {})
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestMailboxOutput:
+    """Tests for the generated mailbox access and thread hooks"""
+
+    @pytest.fixture
+    def design(self) -> Design:
+        return make_design(
+            "thread fast 1000000 +b1.update\n"
+            "thread remote 1000000 @1 +b2.update\n")
+
+    def test_access_functions(self, design):
+        routing = plan_mailboxes(design)
+        lines = []
+        mailbox_as_c_functions(lines, routing.mailboxes[0])
+        actual = "\n".join(lines)
+        expected = (
+            "\n"
+            "static void mbox_fast_remote_put(void) {\n"
+            "    bl_sig_data_t *frame = (bl_sig_data_t *)mb_put_begin(&mbox_fast_remote);\n"
+            "    frame[0].f = sig_s1;\n"
+            "    mb_put_end(&mbox_fast_remote);\n"
+            "}\n"
+            "\n"
+            "static void mbox_fast_remote_get(void) {\n"
+            "    bl_sig_data_t const *frame = (bl_sig_data_t const *)mb_get_begin(&mbox_fast_remote);\n"
+            "    if ( frame == NULL ) {\n"
+            "        return;\n"
+            "    }\n"
+            "    sig_s1_core1 = frame[0].f;\n"
+            "    mb_get_end(&mbox_fast_remote);\n"
+            "}")
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_thread_hooks(self, design):
+        routing = plan_mailboxes(design)
+        lines = []
+        thread_as_c_system(lines, design.threads["fast"], "sys", routing)
+        thread_as_c_system(lines, design.threads["remote"], "sys", routing)
+        actual = [line for line in lines if "mbox" in line or "simple_" in line]
+        expected = [
+            "        simple_update(&blk_b1, periodns);",
+            "    mbox_fast_remote_put();",
+            "    mbox_fast_remote_get();",
+            "        simple_update(&blk_b2, periodns);",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestMailboxHost:
+    """Runs the pthreads mailbox test program"""
+
+    @pytest.mark.parametrize("width", [1, 16])
+    def test_no_torn_frames(self, mailbox_host, width):
+        result = subprocess.run([str(mailbox_host), "200000", str(width)],
+                                capture_output=True, text=True, timeout=60)
+        actual = (result.returncode, "0 torn, 0 stale, 0 old" in result.stdout)
+        expected = (0, True)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n{result.stdout}"
+
+    def test_fast_producer_takes_newest(self, mailbox_host):
+        # the consumer takes a frame far less often than the producer
+        # puts one, as a slow thread fed by a fast one on another core;
+        # every frame it takes must be the newest put before the take
+        result = subprocess.run([str(mailbox_host), "2000000", "4", "2000"],
+                                capture_output=True, text=True, timeout=60)
+        actual = (result.returncode, "sequence: 0 torn, 0 stale, 0 old" in result.stdout,
+                  "0 torn, 0 stale, 0 old" in result.stdout.splitlines()[-1])
+        expected = (0, True, True)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n{result.stdout}"
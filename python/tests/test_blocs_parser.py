@@ -6,7 +6,7 @@ from pathlib import Path
 from parse_common import (Token, ctx)
 from blocs_parser import (
     lex_lines, set_get_block_spec, set_expand_path, unlink_no_arg_handler,
-    parse_blocs, parse_blocs_string, parse_blocs_file,
+    parse_blocs, parse_blocs_string, parse_blocs_file, get_value,
 )
 from bloc_parser import parse_bloc_file
 from emblocs import (
@@ -783,6 +783,25 @@ class TestCmdThread:
         assert result is True
         assert design.threads["t1"].period_ns == 1000000
 
+    def test_thread_core(self, capsys):
+        blocs_str = "thread t1 1000000 @1\n"
+        design = Design(abs_path="test_design")
+        result = parse_blocs_string(blocs_str, design, source=BLOCS_SRC)
+        actual = capsys.readouterr().err.strip()
+        assert actual == "test.blocs: 0 error(s), 0 warning(s), 0 info(s)"
+        assert result is True
+        assert design.threads["t1"].core == 1
+
+    def test_thread_bad_core_fails(self, capsys):
+        blocs_str = "thread t1 1000000 @2\n"
+        design = Design(abs_path="test_design")
+        result = parse_blocs_string(blocs_str, design, source=BLOCS_SRC)
+        actual = capsys.readouterr().err.strip()
+        assert actual == (
+            "test.blocs:1:19: error: core must be 0 to 1, got 2\n"
+            "test.blocs: 1 error(s), 0 warning(s), 0 info(s)")
+        assert result is False
+
     def test_thread_missing_args_fails(self, capsys):
         blocs_str = "thread\n"
         design = Design(abs_path="test_design")
@@ -1128,6 +1147,34 @@ class TestSubcmdEquals:
             "test.blocs: 1 error(s), 0 warning(s), 0 info(s)")
         assert result is False
 
+class TestGetValue:
+    """Plain numbers skip the expression evaluator; the results must not change"""
+
+    @pytest.mark.parametrize("text, value_type, expected", [
+        ("42",     PinType.U32,   42),
+        ("0x1F",   PinType.U32,   31),
+        ("0b101",  PinType.U32,   5),
+        ("1_000",  PinType.U32,   1000),
+        ("-7",     PinType.S32,   -7),
+        ("+7",     PinType.S32,   7),
+        ("--7",    PinType.S32,   7),
+        ("1",      PinType.BOOL,  1),
+        ("-2.5e1", PinType.FLOAT, -25.0),
+        (".5",     PinType.FLOAT, 0.5),
+        ("3",      PinType.FLOAT, 3.0),
+        ("0x10",   PinType.FLOAT, 16.0),
+        ("010",    PinType.U32,   None),
+        ("1.5",    PinType.U32,   None),
+        ("inf",    PinType.FLOAT, None),
+        ("nan",    PinType.FLOAT, None),
+        ("1e39",   PinType.FLOAT, None),
+    ])
+    def test_values(self, text, value_type, expected):
+        actual = get_value(text, value_type)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+        assert type(actual) is type(expected)
+
+
 # ---------------------------------------------------------------------------
 # subcommand '+' tests
 # ---------------------------------------------------------------------------
@@ -0,0 +1,119 @@
+# tests/test_blocs_pools.py
+from __future__ import annotations
+import pytest
+from parse_common import ctx
+from emblocs import Design
+from blocs_pools import count_pools, var_size, index_bits, _index_slots
+from emblocs_output import pools_as_h_system
+
+from conftest import parse_design
+
+
+# ---------------------------------------------------------------------------
+# Fixtures
+# ---------------------------------------------------------------------------
+
+@pytest.fixture(autouse=True)
+def clean_context():
+    ctx.clear()
+    ctx.push(source="<test>")
+    yield
+    ctx.clear()
+
+pytestmark = pytest.mark.usefixtures("blocs_callbacks")
+
+def make_design() -> Design:
+    """
+    b1 and b2 (simple) run in fast, t1 (two_functs) in slow; s1 links
+    all three, and t1 writes s2.
+    """
+    blocs_str = (
+        "blockdef simple simple\n"
+        "blockdef two_functs two_functs\n"
+        "block b1 simple\n"
+        "block b2 simple\n"
+        "block t1 two_functs\n"
+        "signal s1 float +b1.out +b2.in +t1.in\n"
+        "signal s2 float +t1.out\n"
+        "thread slow 2000000 +t1.sample +t1.compute\n"
+        "thread fast 1000000 +b1.update +b2.update\n"
+    )
+    return parse_design(blocs_str)
+
+
+# ---------------------------------------------------------------------------
+# Tests
+# ---------------------------------------------------------------------------
+
+class TestVarSize:
+    """Tests for var_size()"""
+
+    def test_sizes(self):
+        actual = [var_size(decl) for decl in (
+            "float last;", "uint8_t flags[3];", "GPIO_TypeDef *base_addr;",
+            "double acc[2][2];", "unsigned int count;", "GPIO_TypeDef port;")]
+        expected = [(4, 4), (3, 1), (4, 4), (32, 8), (4, 4), None]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestCountPools:
+    """Tests for count_pools()"""
+
+    def test_counts(self):
+        # each thread's layout moves the signals of its blocks, dummies
+        # included, that an earlier thread didn't: b1.in, s1 and b2.out
+        # for fast, then t1.enable and s2 for slow
+        counts = count_pools(make_design())
+        actual = (counts.blocks, counts.pins, counts.functions, counts.signals,
+                  counts.threads, counts.table_entries, counts.layout_signals,
+                  counts.index_slots, counts.block_data, counts.guessed)
+        expected = (3, 7, 4, 2, 2, 6, 5, 48, 8 + 8 + 16, [])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_bytes(self):
+        counts = count_pools(make_design())
+        actual = (counts.rt_bytes, counts.meta_bytes)
+        expected = (32 + 14 * 4 + 4 * 12 + 2 * 24 + 6 * 8,
+                    3 * 24 + 7 * 12 + 4 * 12 + 2 * 12 + 2 * 12)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_index_slots(self):
+        # the index doubles when an insertion would make it over 3/4 full,
+        # and the tables it outgrew stay allocated
+        actual = [_index_slots(n) for n in (0, 1, 12, 13, 25)]
+        expected = [0, 16, 16, 48, 112]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_index_bits(self):
+        actual = [index_bits(n) for n in (8, 512, 516, 2048, 4096)]
+        expected = [1, 7, 8, 9, 10]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestPoolsOutput:
+    """Tests for pools_as_h_system()"""
+
+    def test_header(self):
+        design = make_design()
+        lines = []
+        pools_as_h_system(lines, design, count_pools(design))
+        start = lines.index("#define SYS_POOLS_H")
+        actual = lines[start + 1:]
+        expected = [
+            "",
+            "#define BL_POOL_BLOCKS          (3)",
+            "#define BL_POOL_BLOCK_DATA      (32)  // bytes",
+            "#define BL_POOL_PINS            (7)",
+            "#define BL_POOL_FUNCTIONS       (4)",
+            "#define BL_POOL_SIGNALS         (2)",
+            "#define BL_POOL_THREADS         (2)",
+            "#define BL_POOL_TABLE_ENTRIES   (6)",
+            "#define BL_POOL_LAYOUT_SIGNALS  (5)",
+            "#define BL_POOL_INDEX_SLOTS     (48)",
+            "",
+            "// in the base configuration: RT pool 232 bytes, 6 index bits;",
+            "// meta pool 252 bytes, 6 index bits",
+            "",
+            "#endif // SYS_POOLS_H",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
@@ -0,0 +1,131 @@
+# tests/test_blocs_scheduler.py
+from __future__ import annotations
+import pytest
+from parse_common import ctx
+from emblocs import Design
+from blocs_scheduler import plan_schedule, MAX_HYPERPERIOD
+from emblocs_output import schedule_as_c_system
+
+
+# ---------------------------------------------------------------------------
+# Fixtures
+# ---------------------------------------------------------------------------
+
+@pytest.fixture(autouse=True)
+def clean_context():
+    ctx.clear()
+    ctx.push(source="<test>")
+    yield
+    ctx.clear()
+
+def make_design(periods: dict[str, int]) -> Design:
+    """ threads only; costs are all zero since there are no functions """
+    design = Design(abs_path="/work/sys.blocs")
+    for name, period_ns in periods.items():
+        design.add_thread(name, period_ns)
+    return design
+
+def phases(schedule) -> dict[str, tuple[int, int]]:
+    return {e.thread.name: (e.divisor, e.phase) for e in schedule.entries}
+
+
+# ---------------------------------------------------------------------------
+# Tests
+# ---------------------------------------------------------------------------
+
+class TestPlanSchedule:
+    """Tests for plan_schedule()"""
+
+    def test_no_threads(self):
+        actual = plan_schedule(make_design({}))
+        expected = None
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_slow_threads_spread(self, monkeypatch):
+        # give every thread the same cost; unbalanced, all three
+        # slow threads would land on tick 0 for a peak of 4
+        monkeypatch.setattr("blocs_scheduler.thread_cost", lambda thread: 1)
+        schedule = plan_schedule(make_design(
+            {"fast": 1000, "a": 4000, "b": 4000, "c": 2000}))
+        actual = (phases(schedule), schedule.loads, schedule.peak)
+        expected = ({"fast": (1, 0), "a": (4, 1), "b": (4, 3), "c": (2, 0)},
+                    [2, 2, 2, 2], 2)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_expensive_thread_placed_first(self, monkeypatch):
+        costs = {"fast": 1, "big": 5, "small": 1}
+        monkeypatch.setattr("blocs_scheduler.thread_cost", lambda thread: costs[thread.name])
+        schedule = plan_schedule(make_design(
+            {"fast": 1000, "small": 2000, "big": 2000}))
+        actual = (phases(schedule), schedule.peak)
+        expected = ({"fast": (1, 0), "small": (2, 1), "big": (2, 0)}, 6)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_cores_balanced_separately(self, monkeypatch):
+        # on one core, b would go to phase 1 to avoid a; on its own
+        # core it has the ticks to itself
+        monkeypatch.setattr("blocs_scheduler.thread_cost", lambda thread: 1)
+        design = make_design({"fast": 1000, "a": 2000, "b": 2000})
+        design.set_thread_core(design.threads["b"], 1)
+        schedule = plan_schedule(design)
+        actual = (phases(schedule), schedule.loads)
+        expected = ({"fast": (1, 0), "a": (2, 0), "b": (2, 0)}, [2, 1])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_not_a_multiple(self):
+        schedule = plan_schedule(make_design({"fast": 1000, "odd": 1500}))
+        actual = (phases(schedule), ctx.warning_count)
+        expected = ({"fast": (1, 0)}, 1)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_hyperperiod_over_cap(self, monkeypatch):
+        # 7*11*13*17 = 17017 ticks; balancing would take that many
+        # slots per core, so the phases stay at zero
+        monkeypatch.setattr("blocs_scheduler.thread_cost", lambda thread: 1)
+        schedule = plan_schedule(make_design(
+            {"fast": 1000, "a": 7000, "b": 11000, "c": 13000, "d": 17000}))
+        actual = (phases(schedule), len(schedule.loads), schedule.peak, ctx.warning_count)
+        expected = ({"fast": (1, 0), "a": (7, 0), "b": (11, 0), "c": (13, 0), "d": (17, 0)},
+                    MAX_HYPERPERIOD, 5, 1)
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestScheduleOutput:
+    """Tests for the generated <system>_tick() function"""
+
+    def test_tick_function(self):
+        schedule = plan_schedule(make_design({"slow": 3000, "fast": 1000}))
+        lines = []
+        schedule_as_c_system(lines, schedule, "sys")
+        actual = "\n".join(lines)
+        expected = (
+            "\n"
+            "// call from a timer interrupt every 1000 ns\n"
+            "void sys_tick(void) {\n"
+            "    static uint32_t count_slow = 1;\n"
+            "    sys_fast(1000);\n"
+            "    if ( --count_slow == 0 ) {\n"
+            "        count_slow = 3;\n"
+            "        sys_slow(3000);\n"
+            "    }\n"
+            "}")
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_tick_function_per_core(self):
+        design = make_design({"fast": 1000, "remote": 1000})
+        design.set_thread_core(design.threads["remote"], 1)
+        lines = []
+        schedule_as_c_system(lines, plan_schedule(design), "sys")
+        actual = "\n".join(lines)
+        expected = (
+            "\n"
+            "// call from a timer interrupt on core 0 every 1000 ns\n"
+            "void sys_tick_core0(void) {\n"
+            "    sys_fast(1000);\n"
+            "}\n"
+            "\n"
+            "// call from a timer interrupt on core 1 every 1000 ns\n"
+            "void sys_tick_core1(void) {\n"
+            "    sys_remote(1000);\n"
+            "}")
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
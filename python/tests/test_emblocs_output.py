@@ -0,0 +1,741 @@
+# tests/test_emblocs_output.py
+from __future__ import annotations
+import pytest
+from pathlib import Path
+from parse_common import ctx
+from blocs_parser import set_get_block_spec, set_expand_path, parse_blocs_string
+from bloc_parser import parse_bloc_file
+from emblocs import Design, BlockSpec
+from emblocs_output import (
+    thread_as_c_system, design_as_h_system, execution_order,
+    block_as_c_system, block_as_c_direct, design_as_cmake,
+    thread_as_c_amalgamated, design_as_c_system, blockdef_as_h_variant,
+    thread_loops, static_rt_as_c_system, static_meta_as_c_system,
+    static_names_as_c_system, design_as_depfile,
+)
+from blocs_mailboxes import plan_mailboxes
+from blocs_changes import plan_changes
+
+from conftest import PYTHON_DIR, GOOD_DIR
+
+
+# ---------------------------------------------------------------------------
+# Fixtures
+# ---------------------------------------------------------------------------
+
+@pytest.fixture(autouse=True)
+def clean_context():
+    ctx.clear()
+    ctx.push(source="<test>")
+    yield
+    ctx.clear()
+
+def block_spec_getter(name: str, design: Design) -> BlockSpec | None:
+    bloc_path = GOOD_DIR / f"{name}.bloc"
+    if not bloc_path.is_file():
+        ctx.error(f"'{name}.bloc' not found on block search path")
+        return None
+    return parse_bloc_file(bloc_path.as_posix())
+
+def path_expander(raw: str) -> Path | None:
+    return (PYTHON_DIR / raw).resolve()
+
+@pytest.fixture(autouse=True)
+def set_callbacks():
+    set_get_block_spec(block_spec_getter)
+    set_expand_path(path_expander)
+    yield
+    set_get_block_spec(None)
+    set_expand_path(None)
+
+@pytest.fixture
+def threads_design() -> Design:
+    """ provides a design with one populated thread and one empty thread """
+    blocs_str = (
+        "blockdef simple simple\n"
+        "block b1 simple\n"
+        "block b2 simple\n"
+        "thread fast 1000000 +b1.update +b2.update\n"
+        "thread idle 1000000\n"
+    )
+    design = Design(abs_path="/work/sys.blocs")
+    result = parse_blocs_string(blocs_str, design)
+    assert result is True
+    return design
+
+
+# ---------------------------------------------------------------------------
+# Tests
+# ---------------------------------------------------------------------------
+
+class TestThreadProfiling:
+    """Tests for profiling and stats hooks in generated thread functions"""
+
+    def test_thread_function(self, threads_design):
+        lines = []
+        thread_as_c_system(lines, threads_design.threads["fast"], "sys")
+        actual = "\n".join(lines)
+        expected = (
+            "\n"
+            "#ifdef EBL_THREAD_STATS\n"
+            "bl_thread_stats_t stats_fast = { .reset = 1, .period_ns = 1000000 };\n"
+            "#endif\n"
+            "\n"
+            "#ifdef EBL_PROFILE\n"
+            "volatile uint32_t prof_fast_reset;\n"
+            "bl_profile_t prof_fast[2];\n"
+            "#endif\n"
+            "\n"
+            "#ifdef EBL_FUNCTION_ENABLE\n"
+            "volatile uint32_t en_b1_update = 1;\n"
+            "volatile uint32_t en_b2_update = 1;\n"
+            "#endif\n"
+            "\n"
+            "void sys_fast(uint32_t periodns) {\n"
+            "    BL_THREAD_STATS_BEGIN(stats_fast);\n"
+            "    BL_PROFILE_BEGIN(prof_fast, 2, prof_fast_reset);\n"
+            "    if ( BL_FUNCTION_ENABLED(en_b1_update) ) {\n"
+            "        simple_update(&blk_b1, periodns);\n"
+            "    }\n"
+            "    BL_PROFILE_MARK(prof_fast[0]);\n"
+            "    if ( BL_FUNCTION_ENABLED(en_b2_update) ) {\n"
+            "        simple_update(&blk_b2, periodns);\n"
+            "    }\n"
+            "    BL_PROFILE_MARK(prof_fast[1]);\n"
+            "    BL_THREAD_STATS_END(stats_fast);\n"
+            "}")
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_empty_thread(self, threads_design):
+        lines = []
+        thread_as_c_system(lines, threads_design.threads["idle"], "sys")
+        actual = "\n".join(lines)
+        expected = (
+            "\n"
+            "#ifdef EBL_THREAD_STATS\n"
+            "bl_thread_stats_t stats_idle = { .reset = 1, .period_ns = 1000000 };\n"
+            "#endif\n"
+            "\n"
+            "void sys_idle(uint32_t periodns) {\n"
+            "    BL_THREAD_STATS_BEGIN(stats_idle);\n"
+            "    BL_THREAD_STATS_END(stats_idle);\n"
+            "}")
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_system_header(self, threads_design):
+        lines = []
+        design_as_h_system(lines, threads_design)
+        actual = "\n".join(lines)
+        expected = (
+            "// Auto-generated from sys.blocs - Do not edit.\n"
+            "\n"
+            "#ifndef SYS_H\n"
+            "#define SYS_H\n"
+            "\n"
+            "#include <stdint.h>\n"
+            "#include <emblocs_profile.h>\n"
+            "\n"
+            "void sys_fast(uint32_t periodns);\n"
+            "void sys_idle(uint32_t periodns);\n"
+            "\n"
+            "#ifdef EBL_THREAD_STATS\n"
+            "extern bl_thread_stats_t stats_fast;\n"
+            "#endif\n"
+            "\n"
+            "#ifdef EBL_PROFILE\n"
+            "extern volatile uint32_t prof_fast_reset;\n"
+            "extern bl_profile_t prof_fast[2];\n"
+            "#endif\n"
+            "\n"
+            "#ifdef EBL_FUNCTION_ENABLE\n"
+            "extern volatile uint32_t en_b1_update;\n"
+            "extern volatile uint32_t en_b2_update;\n"
+            "#endif\n"
+            "\n"
+            "#ifdef EBL_THREAD_STATS\n"
+            "extern bl_thread_stats_t stats_idle;\n"
+            "#endif\n"
+            "\n"
+            "#endif // SYS_H")
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestExecutionOrder:
+    """Tests for execution_order()"""
+
+    def test_order(self):
+        blocs_str = (
+            "blockdef simple simple\n"
+            "block b1 simple\n"
+            "block b2 simple\n"
+            "block b3 simple\n"
+            "block cold simple\n"
+            "signal s1 float +b1.out +b3.in\n"
+            "signal s2 float +b3.out +b2.in\n"
+            "signal s3 float +cold.in\n"
+            "thread slow 2000000 +b2.update\n"
+            "thread fast 1000000 +b1.update +b3.update\n"
+        )
+        design = Design(abs_path="/work/sys.blocs")
+        assert parse_blocs_string(blocs_str, design) is True
+        actual = [obj.name for obj in execution_order(design)]
+        expected = ["s1", "b1", "s2", "b3", "b2"]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestDirectOutput:
+    """Tests for the direct-addressed output of --direct mode"""
+
+    # stands in for simple.c and parameterized.c
+    C_LINES = [
+        "#include <emblocs_comp.h>",
+        "// EMBLOCS:  DO NOT REMOVE OR EDIT ABOVE THIS LINE",
+        "",
+        "void BL_MANGLE(update)(void *instance_data, uint32_t periodns) {",
+        "}",
+    ]
+
+    @pytest.fixture
+    def design(self) -> Design:
+        blocs_str = (
+            "blockdef simple simple\n"
+            "blockdef par parameterized NCHAN=3 MASK=5\n"
+            "block b1 simple\n"
+            "block b2 simple\n"
+            "block p1 par\n"
+            "signal s1 float +b1.in\n"
+            "signal s2 float +p1.ch0_in\n"
+            "thread fast 1000000 +b1.update +p1.update\n"
+        )
+        design = Design(abs_path="/work/sys.blocs")
+        assert parse_blocs_string(blocs_str, design) is True
+        return design
+
+    def test_scalar_pins(self, design):
+        lines = list(self.C_LINES)
+        block_as_c_direct(lines, design.blocks["b1"])
+        start = lines.index("typedef simple_t direct_b1_t;")
+        actual = lines[start:]
+        expected = [
+            "typedef simple_t direct_b1_t;",
+            "",
+            "extern simple_t blk_b1;",
+            "extern bl_float_t sig_s1;",
+            "extern bl_float_t dsig_b1_out;",
+            "",
+            "#undef pIN_",
+            "#undef IN_",
+            "#define pIN_  (&sig_s1)",
+            "#define IN_  (*pIN_)",
+            "#undef pOUT_",
+            "#undef OUT_",
+            "#define pOUT_  (&dsig_b1_out)",
+            "#define OUT_  (*pOUT_)",
+            "",
+            '#pragma GCC diagnostic ignored "-Wunused-variable"',
+            "",
+            "static inline __attribute__((always_inline))",
+            "void direct_b1_update(void *instance_data, uint32_t periodns);",
+            f'#line 3 "{(GOOD_DIR / "simple.c").as_posix()}"',
+            "",
+            "void BL_MANGLE(update)(void *instance_data, uint32_t periodns) {",
+            "}",
+            "",
+            "void simple_update_b1(uint32_t periodns) {",
+            "    direct_b1_update(&blk_b1, periodns);",
+            "}",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_array_pins(self, design):
+        # raw pins are cast; ch1_in isn't exported, so its entry is NULL
+        lines = list(self.C_LINES)
+        block_as_c_direct(lines, design.blocks["p1"])
+        start = lines.index("#undef CH0_IN_")
+        actual = lines[start+1:start+8]
+        expected = [
+            "static bl_pin_raw_t const direct_p1_ch0_in_[3] = {",
+            "    (bl_pin_raw_t)&sig_s2,",
+            "    NULL,",
+            "    (bl_pin_raw_t)&dsig_p1_ch2_in,",
+            "};",
+            "#define pCH0_IN_  (direct_p1_ch0_in_)",
+            "#define CH0_IN_(i)  (*(direct_p1_ch0_in_[i]))",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_system(self, design):
+        # threads call the direct functions, and dummies must be visible
+        # to direct_<block>.c
+        lines = []
+        block_as_c_system(lines, design.blocks["b1"], "", None, True)
+        thread_as_c_system(lines, design.threads["fast"], "sys", direct=True)
+        actual = [line for line in lines if "dsig" in line or "periodns);" in line]
+        expected = [
+            "bl_float_t dsig_b1_out = 0;",
+            "    .out_ = &dsig_b1_out,",
+            "        simple_update_b1(periodns);",
+            "        par_update_p1(periodns);",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_cmake(self, design):
+        # b2 doesn't run in a thread, so it has no direct_b2.c
+        lines = []
+        design_as_cmake(lines, design, direct=True)
+        actual = [line for line in lines if "CMAKE_BINARY_DIR" in line]
+        expected = [
+            "    ${CMAKE_BINARY_DIR}/simple.c",
+            "    ${CMAKE_BINARY_DIR}/par.c",
+            "    ${CMAKE_BINARY_DIR}/direct_b1.c",
+            "    ${CMAKE_BINARY_DIR}/direct_p1.c",
+            "    ${CMAKE_BINARY_DIR}/sys.c",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_cmake_outputs(self, design):
+        # everything the build rule in emblocs.cmake makes
+        lines = []
+        design_as_cmake(lines, design, direct=True)
+        start = lines.index("set(BLOCS_OUTPUTS")
+        actual = lines[start + 1:lines.index(")", start)]
+        expected = [
+            "    simple.h",
+            "    simple.c",
+            "    par.h",
+            "    par.c",
+            "    direct_b1.c",
+            "    direct_p1.c",
+            "    sys.h",
+            "    sys.c",
+            "    sys_pools.h",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_depfile(self, design):
+        # par is a variant of parameterized, whose files are read once
+        lines = []
+        design_as_depfile(lines, design, Path("/build dir/sys.stamp"))
+        actual = lines
+        good = GOOD_DIR.as_posix().replace(" ", "\\ ")
+        expected = [
+            "/build\\ dir/sys.stamp: \\",
+            "  /work/sys.blocs \\",
+            f"  {good}/parameterized.bloc \\",
+            f"  {good}/parameterized.c \\",
+            f"  {good}/parameterized.h \\",
+            f"  {good}/simple.bloc \\",
+            f"  {good}/simple.c \\",
+            f"  {good}/simple.h",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_depfile_costs(self, design):
+        # a --costs file decides whether the build passes, so it is listed
+        lines = []
+        design_as_depfile(lines, design, Path("/build/sys.stamp"), [Path("/work/costs.txt")])
+        actual = lines[-2:]
+        good = GOOD_DIR.as_posix().replace(" ", "\\ ")
+        expected = [f"  {good}/simple.h \\", "  /work/costs.txt"]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestFlashPinsOutput:
+    """Tests for the const pin tables of --flash-pins mode"""
+
+    @pytest.fixture
+    def design(self) -> Design:
+        blocs_str = (
+            "blockdef simple simple\n"
+            "blockdef two_functs two_functs\n"
+            "block b1 simple\n"
+            "block t1 two_functs\n"
+            "signal s1 float +b1.out +t1.in\n"
+            "thread fast 1000000 +b1.update +t1.sample\n"
+        )
+        design = Design(abs_path="/work/sys.blocs")
+        assert parse_blocs_string(blocs_str, design) is True
+        return design
+
+    def test_variant_header(self, design):
+        lines = []
+        blockdef_as_h_variant(lines, design.block_defs["two_functs"], flash_pins=True)
+        start = lines.index("typedef struct {")
+        actual = lines[start:lines.index("#define OUT_  (*self->pins->out_)") + 1]
+        expected = [
+            "typedef struct {",
+            "    bl_pin_bit_t enable_;",
+            "    bl_pin_float_t in_;",
+            "    bl_pin_float_t out_;",
+            "} two_functs_pins_t;",
+            "",
+            "typedef struct {",
+            "    two_functs_pins_t const *pins;",
+            "    float last;",
+            "} two_functs_t;",
+            "",
+            "#define pENABLE_  (self->pins->enable_)",
+            "#define ENABLE_  (*self->pins->enable_)",
+            "#define pIN_  (self->pins->in_)",
+            "#define IN_  (*self->pins->in_)",
+            "#define pOUT_  (self->pins->out_)",
+            "#define OUT_  (*self->pins->out_)",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_system(self, design):
+        # the pin table is const, so it doesn't get the tag
+        lines = []
+        block_as_c_system(lines, design.blocks["b1"], "EBL_FAST_DATA ", flash_pins=True)
+        actual = lines
+        expected = [
+            "",
+            "EBL_FAST_DATA static bl_float_t dsig_b1_in = 0;",
+            "static simple_pins_t const pins_b1 = {",
+            "    .in_ = &dsig_b1_in,",
+            "    .out_ = &sig_s1,",
+            "};",
+            "EBL_FAST_DATA simple_t blk_b1 = {",
+            "    .pins = &pins_b1,",
+            "};",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestLoopOutput:
+    """Tests for the looped calls of --loops mode"""
+
+    @pytest.fixture
+    def design(self) -> Design:
+        # k1 feeds k2, so they can't share a loop
+        blocs_str = (
+            "blockdef simple simple\n"
+            "blockdef skippable skippable\n"
+            "block b1 simple\n"
+            "block b2 simple\n"
+            "block k1 skippable\n"
+            "block k2 skippable\n"
+            "block k3 skippable\n"
+            "signal s1 float +k1.out +k2.in\n"
+            "thread fast 1000000 +b1.update +b2.update +k1.update +k2.update +k3.update\n"
+        )
+        design = Design(abs_path="/work/sys.blocs")
+        assert parse_blocs_string(blocs_str, design) is True
+        return design
+
+    def test_runs(self, design):
+        changes = plan_changes(design)
+        runs = thread_loops(design.threads["fast"], changes)
+        actual = [[func.block.name for func in run] for run in runs]
+        expected = [["b1", "b2"], ["k1"], ["k2", "k3"]]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_thread(self, design):
+        changes = plan_changes(design)
+        lines = []
+        thread_as_c_system(lines, design.threads["fast"], "sys", None, changes, loops=True)
+        start = lines.index("    BL_PROFILE_BEGIN(prof_fast, 5, prof_fast_reset);")
+        actual = lines[start+1:]
+        expected = [
+            "    for ( uint32_t i = 0 ; i < 2 ; i++ ) {",
+            "        if ( BL_FUNCTION_ENABLED(*loop_fast_0_en[i]) ) {",
+            "            simple_update(loop_fast_0[i], periodns);",
+            "        }",
+            "        BL_PROFILE_MARK(prof_fast[0 + i]);",
+            "    }",
+            "    if ( BL_FUNCTION_ENABLED(en_k1_update) && chg_k1_update ) {",
+            "        chg_k1_update = 0;",
+            "        skippable_update(&blk_k1, periodns);",
+            "        if ( sig_s1 != chg_sig_s1 ) {",
+            "            chg_sig_s1 = sig_s1;",
+            "            chg_k2_update = 1;",
+            "        }",
+            "    }",
+            "    BL_PROFILE_MARK(prof_fast[2]);",
+            "    for ( uint32_t i = 0 ; i < 2 ; i++ ) {",
+            "        if ( BL_FUNCTION_ENABLED(*loop_fast_3_en[i]) && *loop_fast_3_chg[i] ) {",
+            "            *loop_fast_3_chg[i] = 0;",
+            "            skippable_update(loop_fast_3[i], periodns);",
+            "        }",
+            "        BL_PROFILE_MARK(prof_fast[3 + i]);",
+            "    }",
+            "    BL_THREAD_STATS_END(stats_fast);",
+            "}",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_tables(self, design):
+        changes = plan_changes(design)
+        lines = []
+        thread_as_c_system(lines, design.threads["fast"], "sys", None, changes, loops=True)
+        start = lines.index("static skippable_t * const loop_fast_3[2] = {")
+        actual = lines[start:lines.index("void sys_fast(uint32_t periodns) {")]
+        expected = [
+            "static skippable_t * const loop_fast_3[2] = {",
+            "    &blk_k2,",
+            "    &blk_k3,",
+            "};",
+            "#ifdef EBL_FUNCTION_ENABLE",
+            "static uint32_t const volatile * const loop_fast_3_en[2] = {",
+            "    &en_k2_update,",
+            "    &en_k3_update,",
+            "};",
+            "#endif",
+            "static volatile uint8_t * const loop_fast_3_chg[2] = {",
+            "    &chg_k2_update,",
+            "    &chg_k3_update,",
+            "};",
+            "",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestAmalgamatedOutput:
+    """Tests for the per-thread files of --amalgamate mode"""
+
+    # stands in for simple.c
+    C_LINES = [
+        "#include <emblocs_comp.h>",
+        "// EMBLOCS:  DO NOT REMOVE OR EDIT ABOVE THIS LINE",
+        "",
+        "void BL_MANGLE(update)(void *instance_data, uint32_t periodns) {",
+        "}",
+    ]
+
+    @pytest.fixture
+    def design(self) -> Design:
+        blocs_str = (
+            "blockdef simple simple\n"
+            "block b1 simple\n"
+            "block b2 simple\n"
+            "signal s1 float +b1.out +b2.in\n"
+            "thread fast 1000000 +b1.update\n"
+            "thread remote 1000000 @1 +b2.update\n"
+        )
+        design = Design(abs_path="/work/sys.blocs")
+        assert parse_blocs_string(blocs_str, design) is True
+        return design
+
+    def test_thread_file(self, design):
+        routing = plan_mailboxes(design)
+        lines = []
+        thread_as_c_amalgamated(lines, design.threads["fast"], "sys",
+                                {"simple": self.C_LINES}, routing)
+        end = lines.index("#ifdef EBL_THREAD_STATS")
+        actual = lines[:end]
+        expected = [
+            "// Auto-generated from sys.blocs - Do not edit.",
+            "// Thread fast, with the block functions it calls inlined",
+            "",
+            "#include <emblocs_comp.h>",
+            "#include <target_hooks.h>",
+            "#include <sys.h>",
+            "",
+            "// ---- simple ----",
+            "#define BL_BLOCK_NAME simple",
+            "static inline __attribute__((always_inline))",
+            "void simple_update(void *instance_data, uint32_t periodns);",
+            '#include "simple.h"',
+            f'#line 3 "{(GOOD_DIR / "simple.c").as_posix()}"',
+            "",
+            "void BL_MANGLE(update)(void *instance_data, uint32_t periodns) {",
+            "}",
+            '#line 18 "sys_fast.c"',
+            "#undef BL_BLOCK_NAME",
+            "#undef pIN_",
+            "#undef IN_",
+            "#undef pOUT_",
+            "#undef OUT_",
+            "",
+            "// defined in sys.c",
+            "extern simple_t blk_b1;",
+            "void mbox_fast_remote_put(void);",
+            "",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_system(self, design):
+        # the mailbox functions are called from sys_fast.c, so they
+        # can't be static
+        routing = plan_mailboxes(design)
+        lines = []
+        design_as_c_system(lines, design, None, routing, None, False, ["fast"])
+        actual = [line for line in lines if "sys_" in line or "(void) {" in line]
+        expected = [
+            "void mbox_fast_remote_put(void) {",
+            "void mbox_fast_remote_get(void) {",
+            "// sys_fast() is in sys_fast.c",
+            "void sys_remote(uint32_t periodns) {",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestStaticMetaOutput:
+    """Tests for the generated pools of --meta mode"""
+
+    @pytest.fixture
+    def design(self) -> Design:
+        # t1.compute is in no thread
+        blocs_str = (
+            "blockdef simple simple\n"
+            "blockdef two_functs two_functs\n"
+            "block b1 simple\n"
+            "block t1 two_functs\n"
+            "signal s1 float =1.5 +b1.out +t1.in\n"
+            "thread fast 1000000 +b1.update +t1.sample\n"
+        )
+        design = Design(abs_path="/work/sys.blocs")
+        assert parse_blocs_string(blocs_str, design) is True
+        return design
+
+    def test_rt_struct(self, design):
+        # every pin has a dummy, every function its realtime data
+        lines = []
+        static_rt_as_c_system(lines, design)
+        actual = lines[1:lines.index("};")]
+        expected = [
+            "struct bl_static_rt_s {",
+            "    bl_float_t sig_s1;",
+            "    bl_float_t dsig_b1_in;",
+            "    bl_float_t dsig_b1_out;",
+            "    simple_t blk_b1;",
+            "    bl_bit_t dsig_t1_enable;",
+            "    bl_float_t dsig_t1_in;",
+            "    bl_float_t dsig_t1_out;",
+            "    two_functs_t blk_t1;",
+            "    bl_function_rtdata_t fn_b1_update;",
+            "    bl_function_rtdata_t fn_t1_sample;",
+            "    bl_function_rtdata_t fn_t1_compute;",
+            "    bl_thread_data_t thd_fast;",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_rt_initializer(self, design):
+        lines = []
+        static_rt_as_c_system(lines, design)
+        start = lines.index("EBL_FAST_DATA struct bl_static_rt_s bl_static_rt = {")
+        actual = lines[start + 1:lines.index("    .fn_t1_sample = {")]
+        expected = [
+            "    .sig_s1 = 1.5,",
+            "    .dsig_b1_in = 0,",
+            "    .dsig_b1_out = 0,",
+            "    .blk_b1 = {",
+            "        .in_ = &bl_static_rt.dsig_b1_in,",
+            "        .out_ = &bl_static_rt.sig_s1,",
+            "    },",
+            "    .dsig_t1_enable = 0,",
+            "    .dsig_t1_in = 0,",
+            "    .dsig_t1_out = 0,",
+            "    .blk_t1 = {",
+            "        .enable_ = &bl_static_rt.dsig_t1_enable,",
+            "        .in_ = &bl_static_rt.sig_s1,",
+            "        .out_ = &bl_static_rt.dsig_t1_out,",
+            "    },",
+            "    .fn_b1_update = {",
+            "        .funct = simple_update,",
+            "        .block_data = &bl_static_rt.blk_b1,",
+            "        .next = &bl_static_rt.fn_t1_sample,",
+            "#ifdef EBL_FUNCTION_ENABLE",
+            "        .enabled = 1,",
+            "#endif",
+            "    },",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_function_list(self, design):
+        # in name order, as the core would have linked it
+        lines = []
+        static_meta_as_c_system(lines, design)
+        start = lines.index("    .fn_t1_compute = {")
+        actual = lines[start:start + 14]
+        expected = [
+            "    .fn_t1_compute = {",
+            "        .next = (bl_function_meta_t *)&bl_static_meta.fn_t1_sample,",
+            "        .rtdata_index = offsetof(struct bl_static_rt_s, fn_t1_compute) / 4,",
+            "        .nofp = BL_HAS_FP,",
+            "        .thread_index = BL_META_MAX_INDEX,",
+            "        .name = \"compute\",",
+            "    },",
+            "    .fn_t1_sample = {",
+            "        .next = NULL,",
+            "        .rtdata_index = offsetof(struct bl_static_rt_s, fn_t1_sample) / 4,",
+            "        .nofp = BL_HAS_FP,",
+            "        .thread_index = offsetof(struct bl_static_meta_s, thd_fast) / 4,",
+            "        .name = \"sample\",",
+            "    },",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_pin_meta(self, design):
+        lines = []
+        static_meta_as_c_system(lines, design)
+        start = lines.index("    .pin_t1_enable = {")
+        actual = lines[start:start + 8]
+        expected = [
+            "    .pin_t1_enable = {",
+            "        .next = (bl_pin_meta_t *)&bl_static_meta.pin_t1_in,",
+            "        .ptr_index = (offsetof(struct bl_static_rt_s, blk_t1)"
+            " + offsetof(two_functs_t, enable_)) / 4,",
+            "        .data_type = BL_TYPE_BIT,",
+            "        .dummy_index = offsetof(struct bl_static_rt_s, dsig_t1_enable) / 4,",
+            "        .pin_dir = BL_DIR_IN,",
+            "        .name = \"enable\",",
+            "    },",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_roots(self, design):
+        lines = []
+        static_meta_as_c_system(lines, design)
+        actual = lines[-5:]
+        expected = [
+            "bl_block_meta_t *block_root = (bl_block_meta_t *)&bl_static_meta.blk_b1;",
+            "bl_signal_meta_t *signal_root = (bl_signal_meta_t *)&bl_static_meta.sig_s1;",
+            "bl_thread_meta_t *thread_root = (bl_thread_meta_t *)&bl_static_meta.thd_fast;",
+            "const uint32_t bl_rt_pool_size = sizeof(bl_static_rt);",
+            "const uint32_t bl_meta_pool_size = sizeof(bl_static_meta);",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_names(self, design):
+        # enable flags and stats are the ones the core sees
+        lines = []
+        static_names_as_c_system(lines, design)
+        actual = lines
+        expected = [
+            "// realtime data by name",
+            "#define sig_s1 (bl_static_rt.sig_s1)",
+            "#define blk_b1 (bl_static_rt.blk_b1)",
+            "#define blk_t1 (bl_static_rt.blk_t1)",
+            "#ifdef EBL_FUNCTION_ENABLE",
+            "#define en_b1_update (bl_static_rt.fn_b1_update.enabled)",
+            "#define en_t1_sample (bl_static_rt.fn_t1_sample.enabled)",
+            "#endif",
+            "#ifdef EBL_THREAD_STATS",
+            "#define stats_fast (bl_static_rt.thd_fast.stats)",
+            "#endif",
+            "",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_system(self, design):
+        # no separate signals, blocks, stats or enable flags
+        lines = []
+        design_as_c_system(lines, design, meta=True)
+        actual = [line for line in lines
+                  if line.startswith(("#include", "#error", "EBL_FAST_DATA", "struct", "void"))]
+        expected = [
+            "#include <stddef.h>",
+            "#include <emblocs_priv.h>",
+            "#include <target_hooks.h>",
+            "#include <sys.h>",
+            '#include "simple.h"',
+            '#include "two_functs.h"',
+            '#error "sys.c was generated with --meta, and needs EBL_STATIC_META"',
+            "struct bl_static_rt_s {",
+            "EBL_FAST_DATA struct bl_static_rt_s bl_static_rt = {",
+            "struct bl_static_meta_s {",
+            "struct bl_static_meta_s const bl_static_meta = {",
+            "void sys_fast(uint32_t periodns) {",
+        ]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
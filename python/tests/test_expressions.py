@@ -1,6 +1,6 @@
 from __future__ import annotations
 import pytest
-from expressions import evaluate, ExpressionError
+from expressions import evaluate, compile_expression, ExpressionError
 
 
 @pytest.mark.parametrize("expr, mode, expected", [
@@ -259,3 +259,31 @@ def test_error_cases(expr, variables, mode, expected_message):
 def test_invalid_mode():
     with pytest.raises(ValueError, match="invalid mode"):
         evaluate("1", mode="bool")
+
+
+def test_compile_is_cached():
+    # one compiled function per expression and mode, used with any variables
+    f = compile_expression("(MASK>>i)&1")
+    actual = (compile_expression("(MASK>>i)&1") is f,
+              compile_expression("(MASK>>i)&1", "float") is f,
+              [f({"MASK": 0b0101, "i": i}) for i in range(4)])
+    expected = (True, False, [1, 0, 1, 0])
+    assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+@pytest.mark.parametrize("expr, variables, expected_message", [
+    # errors come from the compiled function, and only from the parts evaluated
+    ("1+", {}, "expression '1+': invalid syntax"),
+    ("A&&len(x)", {"A": 1}, "expression 'A&&len(x)': unsupported construct: Call"),
+    ("A&&len(x)", {"A": 0}, None),
+    ("A||foo", {"A": 0}, "expression 'A||foo': unknown variable: 'foo'"),
+    ("A||foo", {"A": 1}, None),
+])
+def test_compile_errors_deferred(expr, variables, expected_message):
+    f = compile_expression(expr)
+    try:
+        f(variables)
+        actual = None
+    except ExpressionError as e:
+        actual = str(e)
+    assert actual == expected_message, (
+        f"\nEXPECT: {expected_message!r}\nACTUAL: {actual!r}\n")
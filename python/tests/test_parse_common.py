@@ -9,7 +9,7 @@ from parse_common import (
     read_source_file,
     read_source_string,
     ctx, OMIT,
-    tokenize_line,
+    Token, tokenize_line,
     MAX_ENCODING_ERRORS,
 )
 
@@ -335,6 +335,13 @@ class TestTokenizeLine:
         tokens = tokenize_line("   foo", 1)
         assert tokens[0].column == 4
 
+    def test_repeated_text_columns(self):
+        tokens = tokenize_line("  a ab  a\tb ", 7)
+        actual = [tuple(t) for t in tokens]
+        expected = [("a", 7, 3), ("ab", 7, 5), ("a", 7, 9), ("b", 7, 11)]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+        assert all(type(t) is Token for t in tokens)
+
     def test_tab_separator(self):
         tokens = tokenize_line("foo\tbar", 1)
         assert len(tokens) == 2
@@ -0,0 +1,59 @@
+# tests/test_protocol.py
+from __future__ import annotations
+import pytest
+from protocol import (
+    decode_profile_records, ProfileRecord,
+    decode_thread_stats, thread_stats_words,
+)
+
+
+class TestProfileRecords:
+    """Tests for decode_profile_records()"""
+
+    def test_two_records(self):
+        words = [10, 8, 12, 4, 40, 0,
+                 7, 5, 0x80000000, 3, 0x00000002, 0x00000001]
+        actual = decode_profile_records(words)
+        expected = [ProfileRecord(10, 8, 12, 4, 40),
+                    ProfileRecord(7, 5, 0x80000000, 3, 0x100000002)]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+        assert actual[0].mean == 10.0
+
+    def test_no_calls(self):
+        actual = decode_profile_records([0, 0, 0, 0, 0, 0])[0].mean
+        expected = 0.0
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_bad_length(self):
+        with pytest.raises(ValueError) as exc:
+            decode_profile_records([1, 2, 3])
+        actual = str(exc.value)
+        expected = "expected a multiple of 6 words, got 3"
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+
+class TestThreadStats:
+    """Tests for decode_thread_stats()"""
+
+    def test_default_edges(self):
+        words = list(range(13)) + [25, 50, 75, 90, 100] + [6, 5, 4, 3, 2, 1]
+        stats = decode_thread_stats(words)
+        actual = (stats.runs, stats.exec_max, stats.edges, stats.hist)
+        expected = (6, 12, [25, 50, 75, 90, 100], [6, 5, 4, 3, 2, 1])
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_custom_edges(self):
+        actual = thread_stats_words(2)
+        expected = 18
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+        stats = decode_thread_stats([0] * 13 + [50, 100] + [1, 2, 3], 2)
+        actual = stats.hist
+        expected = [1, 2, 3]
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
+
+    def test_bad_length(self):
+        with pytest.raises(ValueError) as exc:
+            decode_thread_stats([0] * 13)
+        actual = str(exc.value)
+        expected = "expected 24 words, got 13"
+        assert actual == expected, f"\nEXPECT: {expected!r}\nACTUAL: {actual!r}\n"
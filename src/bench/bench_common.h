@@ -0,0 +1,20 @@
+/***************************************************************
+ *
+ * bench_common.h - common definitions for EMBLOCS benchmarks
+ *
+ * The benchmarks are meant to run on the target.  The
+ * application supplies a free running timer; the results are
+ * in ticks of that timer.
+ *
+ **************************************************************/
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* a free running timer that counts up; it may wrap */
+typedef uint32_t (bench_timer_t)(void);
+
+#endif // BENCH_COMMON_H
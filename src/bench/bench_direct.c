@@ -0,0 +1,143 @@
+/***************************************************************
+ *
+ * bench_direct.c - direct-addressed pin benchmark
+ *
+ **************************************************************/
+
+#include <emblocs_common.h>
+#include <bench_direct.h>
+#include <stdio.h>      // printf
+
+#define PERIOD_NS   (1000000u)
+
+/* signals: the integrator reads vel and writes pos, the mux
+   picks pos or lim by sel and writes out */
+static bl_float_t vel, pos, lim, out;
+static bl_u32_t sel;
+
+/* same layout and work as the integrator and mux variants; the
+   functions are called through non-inlined functions, just as
+   generated threads call block functions in other translation
+   units */
+typedef struct bench_integ_s {
+    bl_pin_float_t in_;
+    bl_pin_float_t out_;
+    float accumulator;
+} bench_integ_t;
+
+typedef struct bench_mux_s {
+    bl_pin_raw_t in0_[2];
+    bl_pin_raw_t out_;
+    bl_pin_u32_t select_;
+} bench_mux_t;
+
+static bench_integ_t integ = { &vel, &pos, 0.0f };
+static bench_mux_t mux = { { (bl_pin_raw_t)&pos, (bl_pin_raw_t)&lim }, (bl_pin_raw_t)&out, &sel };
+
+/* through pin pointers, as <variant>.c does it */
+static __attribute__((noinline)) void bench_integ_update(void *instance_data, uint32_t periodns)
+{
+    bench_integ_t *self = (bench_integ_t *)instance_data;
+    float dt = periodns * 0.000000001;
+
+    self->accumulator += *self->in_ * dt;
+    *self->out_ = self->accumulator;
+}
+
+static __attribute__((noinline)) void bench_mux_update(void *instance_data, uint32_t periodns)
+{
+    bench_mux_t *self = (bench_mux_t *)instance_data;
+
+    (void)periodns;
+    *self->out_ = *(self->in0_[*self->select_]);
+}
+
+/* directly, as direct_<block>.c does it; array pins still go
+   through a table, but a constant one, and raw pins are cast
+   from the signal's address */
+#pragma GCC optimize ("no-strict-aliasing")
+
+static bl_pin_raw_t const direct_mux_in0_[2] = { (bl_pin_raw_t)&pos, (bl_pin_raw_t)&lim };
+
+static __attribute__((noinline)) void bench_integ_direct(uint32_t periodns)
+{
+    float dt = periodns * 0.000000001;
+
+    integ.accumulator += vel * dt;
+    pos = integ.accumulator;
+}
+
+static __attribute__((noinline)) void bench_mux_direct(uint32_t periodns)
+{
+    (void)periodns;
+    *(bl_pin_raw_t)&out = *(direct_mux_in0_[sel]);
+}
+#pragma GCC reset_options
+
+static void bench_reset(void)
+{
+    vel = 1.0f;
+    pos = lim = out = 0.0f;
+    sel = 0;
+    integ.accumulator = 0.0f;
+}
+
+static uint32_t bench_pointers(bench_timer_t *timer, uint32_t iterations)
+{
+    uint32_t start;
+
+    bench_reset();
+    start = timer();
+    for ( uint32_t n = 0 ; n < iterations ; n++ ) {
+        sel = n & 1;
+        bench_integ_update(&integ, PERIOD_NS);
+        bench_mux_update(&mux, PERIOD_NS);
+    }
+    return timer() - start;
+}
+
+static uint32_t bench_directly(bench_timer_t *timer, uint32_t iterations)
+{
+    uint32_t start;
+
+    bench_reset();
+    start = timer();
+    for ( uint32_t n = 0 ; n < iterations ; n++ ) {
+        sel = n & 1;
+        bench_integ_direct(PERIOD_NS);
+        bench_mux_direct(PERIOD_NS);
+    }
+    return timer() - start;
+}
+
+static void bench_print(char const *label, uint32_t ticks, uint32_t runs)
+{
+    uint64_t hundredths;
+
+    hundredths = (uint64_t)ticks * 100 / runs;
+    printf("  %-10s %10lu ticks, %6lu.%02lu per run\n", label, (unsigned long)ticks,
+                (unsigned long)(hundredths / 100), (unsigned long)(hundredths % 100));
+}
+
+bool bench_direct(bench_timer_t *timer, uint32_t iterations)
+{
+    uint32_t pointer_ticks, direct_ticks;
+    bl_float_t pointer_pos, pointer_out;
+
+    if ( iterations == 0 ) {
+        printf("bench_direct: bad arguments\n");
+        return false;
+    }
+    pointer_ticks = bench_pointers(timer, iterations);
+    pointer_pos = pos;
+    pointer_out = out;
+    direct_ticks = bench_directly(timer, iterations);
+    printf("direct: integrator and mux x %lu runs\n", (unsigned long)iterations);
+    bench_print("pointers:", pointer_ticks, iterations);
+    bench_print("direct:", direct_ticks, iterations);
+    if ( ( pos != pointer_pos ) || ( out != pointer_out ) ) {
+        printf("bench_direct: outputs differ\n");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,27 @@
+/***************************************************************
+ *
+ * bench_direct.h - direct-addressed pin benchmark
+ *
+ * Measures what the system compiler's --direct mode saves.  An
+ * integrator feeding one input of a mux is run two ways: as the
+ * normal variants run, with every pin access loading a pointer
+ * from the instance struct, and as the per-instance functions
+ * in direct_<block>.c run, with 'self' constant and each pin
+ * naming its signal.
+ *
+ **************************************************************/
+
+#ifndef BENCH_DIRECT_H
+#define BENCH_DIRECT_H
+
+#include <bench_common.h>
+
+/***************************************************************
+ * Runs the integrator and the mux 'iterations' times through
+ * pin pointers and then directly, and prints the average time
+ * per run for each case.  Returns false on error, or if the two
+ * cases don't compute the same outputs.
+ */
+bool bench_direct(bench_timer_t *timer, uint32_t iterations);
+
+#endif // BENCH_DIRECT_H
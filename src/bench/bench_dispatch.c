@@ -0,0 +1,102 @@
+/***************************************************************
+ *
+ * bench_dispatch.c - thread dispatch benchmark for EMBLOCS
+ *
+ **************************************************************/
+
+#include <emblocs_api.h>
+#include <emblocs_comp.h>
+#include <bench_dispatch.h>
+#include <stdio.h>      // printf
+
+/* a trivial component with one function, so the benchmark
+   measures dispatch cost and not the work done by the block */
+typedef struct bench_block_s {
+    uint32_t count;
+} bench_block_t;
+
+static void bench_function(void *block_data, uint32_t period_ns)
+{
+    (void)period_ns;
+    ((bench_block_t *)block_data)->count++;
+}
+
+static bl_function_def_t const bench_functions[] = {
+    { "update", BL_NO_FP, &bench_function }
+};
+
+static bl_comp_def_t const bench_comp_def = {
+    "bench",
+    NULL,
+    sizeof(bench_block_t),
+    BL_NO_PERSONALITY,
+    0,
+    _countof(bench_functions),
+    NULL,
+    bench_functions
+};
+
+/* the core keeps pointers to names, so they must persist */
+static char bench_names[BENCH_DISPATCH_MAX_FUNCTS][8];
+
+static uint32_t bench_run(bench_timer_t *timer, struct bl_thread_data_s *data, uint32_t iterations)
+{
+    uint32_t start;
+
+    start = timer();
+    for ( uint32_t n = 0 ; n < iterations ; n++ ) {
+        bl_thread_run(data, 0);
+    }
+    return timer() - start;
+}
+
+static void bench_print(char const *label, uint32_t ticks, uint32_t calls)
+{
+    uint64_t hundredths;
+
+    hundredths = (uint64_t)ticks * 100 / calls;
+    printf("  %-6s %10lu ticks, %6lu.%02lu per function\n", label, (unsigned long)ticks,
+                (unsigned long)(hundredths / 100), (unsigned long)(hundredths % 100));
+}
+
+bool bench_dispatch(bench_timer_t *timer, uint32_t funct_count, uint32_t iterations)
+{
+    struct bl_thread_meta_s *thread;
+    struct bl_block_meta_s *blk;
+    struct bl_function_meta_s *funct;
+    struct bl_thread_data_s *data;
+    uint32_t list_ticks, table_ticks, calls;
+
+    if ( ( funct_count == 0 ) || ( funct_count > BENCH_DISPATCH_MAX_FUNCTS ) || ( iterations == 0 ) ) {
+        printf("bench_dispatch: bad arguments\n");
+        return false;
+    }
+    thread = bl_thread_new("bench", 1000000, BL_NO_FP);
+    if ( thread == NULL ) {
+        printf("bench_dispatch: %s\n", bl_errstr());
+        return false;
+    }
+    for ( uint32_t n = 0 ; n < funct_count ; n++ ) {
+        snprintf(bench_names[n], sizeof(bench_names[n]), "b%lu", (unsigned long)n);
+        blk = bl_block_new(bench_names[n], &bench_comp_def, NULL);
+        funct = ( blk != NULL ) ? bl_function_find_in_block("update", blk) : NULL;
+        if ( ( funct == NULL ) || ! bl_function_linkto_thread(funct, thread) ) {
+            printf("bench_dispatch: %s\n", bl_errstr());
+            return false;
+        }
+    }
+    data = bl_thread_get_data(thread);
+    calls = funct_count * iterations;
+    // before: walk the linked list
+    list_ticks = bench_run(timer, data, iterations);
+    // after: walk the packed table
+    if ( ! bl_thread_finalize(thread) ) {
+        printf("bench_dispatch: %s\n", bl_errstr());
+        return false;
+    }
+    table_ticks = bench_run(timer, data, iterations);
+    printf("dispatch: %lu functions x %lu runs\n", (unsigned long)funct_count, (unsigned long)iterations);
+    bench_print("list:", list_ticks, calls);
+    bench_print("table:", table_ticks, calls);
+    return true;
+}
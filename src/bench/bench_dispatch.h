@@ -0,0 +1,33 @@
+/***************************************************************
+ *
+ * bench_dispatch.h - thread dispatch benchmark for EMBLOCS
+ *
+ * Measures the cost of calling functions from bl_thread_run(),
+ * first walking the linked list of functions, then walking
+ * the packed table built by bl_thread_finalize().
+ *
+ * This is meant to run on the target, since dispatch cost
+ * depends on the memory system (flash wait states, XIP
+ * cache, etc).  The application supplies a free running
+ * timer; the results are in ticks of that timer.
+ *
+ **************************************************************/
+
+#ifndef BENCH_DISPATCH_H
+#define BENCH_DISPATCH_H
+
+#include <bench_common.h>
+
+/* maximum number of functions in the benchmark thread */
+#define BENCH_DISPATCH_MAX_FUNCTS   (64)
+
+/***************************************************************
+ * Creates a thread with 'funct_count' trivial functions and
+ * runs it 'iterations' times unsealed and then sealed, then
+ * prints the average time per function call for each case.
+ * Uses the normal EMBLOCS pools, so it should be called from
+ * an otherwise empty system.  Returns false on error.
+ */
+bool bench_dispatch(bench_timer_t *timer, uint32_t funct_count, uint32_t iterations);
+
+#endif // BENCH_DISPATCH_H
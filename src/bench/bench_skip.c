@@ -0,0 +1,129 @@
+/***************************************************************
+ *
+ * bench_skip.c - on_change function skipping benchmark
+ *
+ **************************************************************/
+
+#include <emblocs_common.h>
+#include <bench_skip.h>
+#include <stdio.h>      // printf
+
+/* same layout and work as limit1; the stages are called through
+   a non-inlined function, just as generated threads call block
+   functions in other translation units */
+typedef struct bench_stage_s {
+    bl_float_t *in;
+    bl_float_t *min;
+    bl_float_t *max;
+    bl_float_t *out;
+} bench_stage_t;
+
+static __attribute__((noinline)) void bench_stage_update(void *block_data, uint32_t period_ns)
+{
+    bench_stage_t *self = (bench_stage_t *)block_data;
+    float val;
+
+    (void)period_ns;
+    val = *self->in;
+    if ( val < *self->min ) {
+        val = *self->min;
+    }
+    if ( val > *self->max ) {
+        val = *self->max;
+    }
+    *self->out = val;
+}
+
+/* the chain: stage n reads sig[n] and writes sig[n+1] */
+static bench_stage_t stages[BENCH_SKIP_MAX_STAGES];
+static bl_float_t sigs[BENCH_SKIP_MAX_STAGES+1];
+static bl_float_t min = -1000.0f, max = 1000.0f;
+
+/* change tracking, as emitted by the system compiler */
+static volatile uint8_t flags[BENCH_SKIP_MAX_STAGES];
+static bl_float_t shadows[BENCH_SKIP_MAX_STAGES+1];
+
+static void bench_source(uint32_t n, uint32_t change_every)
+{
+    // stays inside [min, max], so every change goes down the chain
+    sigs[0] = (float)(( n / change_every ) & 0xFF);
+}
+
+static uint32_t bench_always(bench_timer_t *timer, uint32_t stage_count,
+                             uint32_t change_every, uint32_t iterations)
+{
+    uint32_t start;
+
+    start = timer();
+    for ( uint32_t n = 0 ; n < iterations ; n++ ) {
+        bench_source(n, change_every);
+        for ( uint32_t s = 0 ; s < stage_count ; s++ ) {
+            bench_stage_update(&stages[s], 0);
+        }
+    }
+    return timer() - start;
+}
+
+static uint32_t bench_on_change(bench_timer_t *timer, uint32_t stage_count,
+                                uint32_t change_every, uint32_t iterations, uint32_t *calls)
+{
+    uint32_t start;
+
+    for ( uint32_t s = 0 ; s < stage_count ; s++ ) {
+        flags[s] = 1;
+        shadows[s] = 0.0f;
+    }
+    *calls = 0;
+    start = timer();
+    for ( uint32_t n = 0 ; n < iterations ; n++ ) {
+        bench_source(n, change_every);
+        if ( sigs[0] != shadows[0] ) {
+            shadows[0] = sigs[0];
+            flags[0] = 1;
+        }
+        for ( uint32_t s = 0 ; s < stage_count ; s++ ) {
+            if ( flags[s] ) {
+                flags[s] = 0;
+                bench_stage_update(&stages[s], 0);
+                (*calls)++;
+                if ( ( s+1 < stage_count ) && ( sigs[s+1] != shadows[s+1] ) ) {
+                    shadows[s+1] = sigs[s+1];
+                    flags[s+1] = 1;
+                }
+            }
+        }
+    }
+    return timer() - start;
+}
+
+static void bench_print(char const *label, uint32_t ticks, uint32_t runs)
+{
+    uint64_t hundredths;
+
+    hundredths = (uint64_t)ticks * 100 / runs;
+    printf("  %-10s %10lu ticks, %6lu.%02lu per stage run\n", label, (unsigned long)ticks,
+                (unsigned long)(hundredths / 100), (unsigned long)(hundredths % 100));
+}
+
+bool bench_skip(bench_timer_t *timer, uint32_t stage_count, uint32_t change_every, uint32_t iterations)
+{
+    uint32_t always_ticks, skip_ticks, calls, runs;
+
+    if ( ( stage_count == 0 ) || ( stage_count > BENCH_SKIP_MAX_STAGES )
+            || ( change_every == 0 ) || ( iterations == 0 ) ) {
+        printf("bench_skip: bad arguments\n");
+        return false;
+    }
+    for ( uint32_t s = 0 ; s < stage_count ; s++ ) {
+        stages[s] = (bench_stage_t){ &sigs[s], &min, &max, &sigs[s+1] };
+    }
+    runs = stage_count * iterations;
+    always_ticks = bench_always(timer, stage_count, change_every, iterations);
+    skip_ticks = bench_on_change(timer, stage_count, change_every, iterations, &calls);
+    printf("skip: %lu stages x %lu runs, input changes every %lu runs, %lu of %lu calls made\n",
+                (unsigned long)stage_count, (unsigned long)iterations, (unsigned long)change_every,
+                (unsigned long)calls, (unsigned long)runs);
+    bench_print("always:", always_ticks, runs);
+    bench_print("on_change:", skip_ticks, runs);
+    return true;
+}
@@ -0,0 +1,36 @@
+/***************************************************************
+ *
+ * bench_skip.h - on_change function skipping benchmark
+ *
+ * Measures what the system compiler's change tracking for
+ * 'on_change' functions costs and what it saves.  A chain of
+ * limit1-like stages, each reading the output of the one
+ * before, is run the way a generated thread runs it: first
+ * calling every stage every time, then with the run flags and
+ * shadow compares that the system compiler emits for on_change
+ * functions.
+ *
+ * The input to the chain changes every 'change_every' runs.
+ * With a change on every run nothing can be skipped, so that
+ * case shows the bookkeeping overhead per stage; with rarer
+ * changes, most calls are skipped.
+ *
+ **************************************************************/
+
+#ifndef BENCH_SKIP_H
+#define BENCH_SKIP_H
+
+#include <bench_common.h>
+
+/* maximum number of stages in the chain */
+#define BENCH_SKIP_MAX_STAGES   (64)
+
+/***************************************************************
+ * Runs a chain of 'stage_count' stages 'iterations' times,
+ * always calling every stage and then calling only the stages
+ * whose input changed, and prints the average time per stage
+ * per run for each case.  Returns false on error.
+ */
+bool bench_skip(bench_timer_t *timer, uint32_t stage_count, uint32_t change_every, uint32_t iterations);
+
+#endif // BENCH_SKIP_H
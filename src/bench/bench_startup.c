@@ -0,0 +1,112 @@
+/***************************************************************
+ *
+ * bench_startup.c - system build benchmark for EMBLOCS
+ *
+ **************************************************************/
+
+#include <emblocs_api.h>
+#include <emblocs_comp.h>
+#include <bench_startup.h>
+#include <stdio.h>      // printf
+
+/* a trivial component with one pin and one function */
+typedef struct bench_block_s {
+    bl_s32_t *in;
+} bench_block_t;
+
+static void bench_function(void *block_data, uint32_t period_ns)
+{
+    (void)block_data;
+    (void)period_ns;
+}
+
+static bl_pin_def_t const bench_pins[] = {
+    { "in", BL_TYPE_S32, BL_DIR_IN, offsetof(bench_block_t, in) }
+};
+
+static bl_function_def_t const bench_functions[] = {
+    { "update", BL_NO_FP, &bench_function }
+};
+
+static bl_comp_def_t const bench_comp_def = {
+    "bench",
+    NULL,
+    sizeof(bench_block_t),
+    BL_NO_PERSONALITY,
+    _countof(bench_pins),
+    _countof(bench_functions),
+    bench_pins,
+    bench_functions
+};
+
+/* the core keeps pointers to names, so they must persist */
+static char bench_block_names[BENCH_STARTUP_MAX_BLOCKS][8];
+static char bench_signal_names[BENCH_STARTUP_MAX_BLOCKS][8];
+
+/* creates block 'n' and its signal, and links them, using
+   lookups by name the same way the parser does */
+static bool bench_add_block(uint32_t n)
+{
+    struct bl_block_meta_s *blk;
+    struct bl_signal_meta_s *sig;
+    struct bl_pin_meta_s *pin;
+
+    snprintf(bench_block_names[n], sizeof(bench_block_names[n]), "b%lu", (unsigned long)n);
+    snprintf(bench_signal_names[n], sizeof(bench_signal_names[n]), "s%lu", (unsigned long)n);
+    if ( bl_block_new(bench_block_names[n], &bench_comp_def, NULL) == NULL ) return false;
+    if ( bl_signal_new(bench_signal_names[n], BL_TYPE_S32) == NULL ) return false;
+    blk = bl_block_find(bench_block_names[n]);
+    sig = bl_signal_find(bench_signal_names[n]);
+    if ( ( blk == NULL ) || ( sig == NULL ) ) return false;
+    pin = bl_pin_find_in_block("in", blk);
+    if ( pin == NULL ) return false;
+    return bl_pin_linkto_signal(pin, sig);
+}
+
+static void bench_print(char const *label, uint32_t ticks, uint32_t count)
+{
+    uint64_t hundredths;
+
+    hundredths = (uint64_t)ticks * 100 / count;
+    printf("  %-8s %10lu ticks, %6lu.%02lu per block\n", label, (unsigned long)ticks,
+                (unsigned long)(hundredths / 100), (unsigned long)(hundredths % 100));
+}
+
+bool bench_startup(bench_timer_t *timer, uint32_t block_count)
+{
+    uint32_t done, step, start, build_ticks, find_ticks;
+
+    if ( ( block_count == 0 ) || ( block_count > BENCH_STARTUP_MAX_BLOCKS ) ) {
+        printf("bench_startup: bad arguments\n");
+        return false;
+    }
+    done = 0;
+    step = 10;
+    while ( done < block_count ) {
+        if ( step > block_count ) {
+            step = block_count;
+        }
+        start = timer();
+        for ( uint32_t n = done ; n < step ; n++ ) {
+            if ( ! bench_add_block(n) ) {
+                printf("bench_startup: %s\n", bl_errstr());
+                return false;
+            }
+        }
+        build_ticks = timer() - start;
+        start = timer();
+        for ( uint32_t n = 0 ; n < step ; n++ ) {
+            if ( bl_block_find(bench_block_names[n]) == NULL ) {
+                printf("bench_startup: %s\n", bl_errstr());
+                return false;
+            }
+        }
+        find_ticks = timer() - start;
+        printf("startup: %lu to %lu blocks\n", (unsigned long)done, (unsigned long)step);
+        bench_print("build:", build_ticks, step - done);
+        bench_print("find:", find_ticks, step);
+        done = step;
+        step *= 10;
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+/***************************************************************
+ *
+ * bench_startup.h - system build benchmark for EMBLOCS
+ *
+ * Measures the cost of building a system at runtime: creating
+ * blocks and signals, finding pins and linking them, which is
+ * what bl_parse_string() does for each command.  Without
+ * EBL_NAME_INDEX, each new object is inserted into a sorted
+ * list and each name is found by walking a list, so the cost
+ * per block grows with the size of the system.
+ *
+ * The system is grown in steps of 10, 100, 1000 blocks; each
+ * step reports the time per block to get there, and the time
+ * to find a block by name once there.
+ *
+ **************************************************************/
+
+#ifndef BENCH_STARTUP_H
+#define BENCH_STARTUP_H
+
+#include <bench_common.h>
+
+/* maximum number of blocks in the benchmark system */
+#define BENCH_STARTUP_MAX_BLOCKS    (1000)
+
+/***************************************************************
+ * Grows a system to 'block_count' blocks, each with one signal
+ * connected to its pin, and prints the results of each step.
+ * Uses the normal EMBLOCS pools, so it should be called from
+ * an otherwise empty system, and the pools must be big enough;
+ * on a 32-bit target, 1000 blocks need roughly 64K of meta pool
+ * (plus 32K with EBL_NAME_INDEX) and 24K of RT pool.  Returns
+ * false on error.
+ */
+bool bench_startup(bench_timer_t *timer, uint32_t block_count);
+
+#endif // BENCH_STARTUP_H
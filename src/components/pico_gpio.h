@@ -15,13 +15,9 @@ typedef struct {
 #endif
 #if (OUTPUTS!=0)
     bl_pin_bit_t pin00_out_[30];
-#endif
 #if (ENABLES!=0)
     bl_pin_bit_t pin00_oe_[30];
 #endif
-#if (INPUTS!=0)
-#endif
-#if (OUTPUTS!=0)
 #endif
 } BL_MANGLE(t);
 
@@ -32,10 +28,10 @@ typedef struct {
 #if (OUTPUTS!=0)
 #define pPIN00_OUT_  (self->pin00_out_)
 #define PIN00_OUT_(i)  (*(self->pin00_out_[i]))
-#endif
 #if (ENABLES!=0)
 #define pPIN00_OE_  (self->pin00_oe_)
 #define PIN00_OE_(i)  (*(self->pin00_oe_[i]))
 #endif
+#endif
 
 #endif // PICO_GPIO_H
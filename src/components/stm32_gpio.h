@@ -12,32 +12,28 @@
 // define instance structure
 typedef struct {
     GPIO_TypeDef *base_addr;
-#if (INPUTS!=0)
+#if ((INPUTS!=0))
     bl_pin_bit_t pin00_in_[16];
 #endif
-#if (OUTPUTS!=0)
+#if ((OUTPUTS!=0))
     bl_pin_bit_t pin00_out_[16];
-#endif
 #if (ENABLES!=0)
     bl_pin_bit_t pin00_oe_[16];
 #endif
-#if ((INPUTS!=0))
-#endif
-#if ((OUTPUTS!=0))
 #endif
 } BL_MANGLE(t);
 
-#if (INPUTS!=0)
+#if ((INPUTS!=0))
 #define pPIN00_IN_  (self->pin00_in_)
 #define PIN00_IN_(i)  (*(self->pin00_in_[i]))
 #endif
-#if (OUTPUTS!=0)
+#if ((OUTPUTS!=0))
 #define pPIN00_OUT_  (self->pin00_out_)
 #define PIN00_OUT_(i)  (*(self->pin00_out_[i]))
-#endif
 #if (ENABLES!=0)
 #define pPIN00_OE_  (self->pin00_oe_)
 #define PIN00_OE_(i)  (*(self->pin00_oe_[i]))
 #endif
+#endif
 
 #endif // STM32_GPIO_H
@@ -90,6 +90,50 @@ bool bl_function_linkto_thread(struct bl_function_meta_s *funct, struct bl_threa
 bool bl_function_unlink(struct bl_function_meta_s *funct);
 #endif
 
+#ifdef EBL_FUNCTION_ENABLE
+/**************************************************************
+ * Switch a function off or back on without unlinking it.  A
+ * function that is off stays in its thread, but the thread
+ * skips it.  Functions start out on.  This doesn't touch the
+ * thread's function list or table, so it takes O(1) time and
+ * can be done at any time, even while the thread is running;
+ * the change takes effect the next time the thread gets to
+ * the function.
+ */
+bool bl_function_enable(struct bl_function_meta_s const *funct, bool enable);
+bool bl_function_is_enabled(struct bl_function_meta_s const *funct);
+#endif
+
+/**************************************************************
+ * Seal a thread (or all threads) after configuration.  This
+ * compiles the thread's functions into a packed dispatch
+ * table, so bl_thread_run() doesn't have to follow a linked
+ * list scattered across the RT pool.  Functions can still be
+ * linked and unlinked later; each change rebuilds the table.
+ */
+bool bl_thread_finalize(struct bl_thread_meta_s const *thread);
+bool bl_thread_finalize_all(void);
+
+/**************************************************************
+ * Lay out a thread's signals in execution order.  Signals are
+ * allocated in creation order, so the ones a thread uses are
+ * scattered across the RT pool.  This moves every signal (or
+ * dummy signal) connected to a pin of a block in the thread
+ * into a contiguous run at the end of the pool, in the order
+ * the thread calls the blocks.  A signal already moved by an
+ * earlier call, for another thread, stays where it is, so
+ * each signal goes with the first thread laid out that uses
+ * it.  Block data itself does not move, since a component may
+ * keep pointers into it.  The old locations are not
+ * reclaimed, so this costs 4 bytes of RT pool per signal
+ * moved.  Call it after all connections are made, fastest
+ * thread first, then finalize the threads so their tables
+ * follow the signals.  A signal can be shared
+ * with another thread, and moving it is not atomic, so this
+ * fails with BL_ERR_BUSY once any thread has been finalized.
+ */
+bool bl_thread_layout(struct bl_thread_meta_s const *thread);
+
 /**************************************************************
  * A structure that carries the realtime data for a thread.
  * An application passes it to bl_thread_run() to execute
@@ -106,7 +150,83 @@ struct bl_thread_data_s;
  * the 'thread_ns' value from thread creation will be passed 
  * instead.
  */
-void bl_thread_run(struct bl_thread_data_s const *thread, uint32_t period_ns);
+void bl_thread_run(struct bl_thread_data_s *thread, uint32_t period_ns);
+
+#ifdef EBL_PROFILE
+/**************************************************************
+ * Clear the profile data of every function in a thread.  The
+ * data is actually cleared by the thread itself, the next
+ * time it runs.
+ */
+bool bl_thread_profile_reset(struct bl_thread_meta_s const *thread);
+#endif
+
+#ifdef EBL_THREAD_STATS
+/**************************************************************
+ * Clear the statistics of a thread.  Like the profile data,
+ * they are actually cleared by the thread the next time it
+ * runs.
+ */
+bool bl_thread_stats_reset(struct bl_thread_meta_s const *thread);
+#endif
+
+#ifdef EBL_BATCH
+/**************************************************************
+ * Reconfiguration batches.  Linking, unlinking or setting
+ * things with the functions above takes effect immediately,
+ * so a running thread can see a half-made change.  A batch
+ * instead stages a set of changes to one thread, checking
+ * each one as it is staged, without touching anything the
+ * thread can see.  bl_batch_commit() queues the batch, and
+ * the thread applies all of it at the start of its next
+ * run, before calling any functions.  The time that takes
+ * is bounded by the size of the batch.
+ *
+ * bl_batch_new() allocates a batch that can hold 'max_ops'
+ * operations from the RT pool.  Unlinking a pin takes two
+ * operations, everything else takes one.  Once a batch is
+ * done it can be reused; staging into it starts over.
+ *
+ * Function links and unlinks need a finalized thread,
+ * since they are applied by swapping dispatch tables.  They
+ * are made in the thread's function list (and visible to
+ * bl_show_thread()) when the batch is committed.  While a
+ * batch is pending, linking or unlinking functions in the
+ * thread directly fails with BL_ERR_BUSY.
+ */
+typedef enum {
+    BL_BATCH_STAGING,   // accepting operations
+    BL_BATCH_PENDING,   // committed, waiting for the thread to run
+    BL_BATCH_DONE       // applied by the thread
+} bl_batch_status_t;
+
+struct bl_batch_s;
+
+struct bl_batch_s *bl_batch_new(struct bl_thread_meta_s const *thread, uint32_t max_ops);
+bool bl_batch_pin_linkto_signal(struct bl_batch_s *batch, struct bl_pin_meta_s const *pin, struct bl_signal_meta_s const *sig);
+bool bl_batch_signal_set(struct bl_batch_s *batch, struct bl_signal_meta_s const *sig, bl_sig_data_t const *value);
+bool bl_batch_pin_set(struct bl_batch_s *batch, struct bl_pin_meta_s const *pin, bl_sig_data_t const *value);
+bool bl_batch_function_linkto_thread(struct bl_batch_s *batch, struct bl_function_meta_s *funct);
+#ifdef BL_ENABLE_UNLINK
+bool bl_batch_pin_unlink(struct bl_batch_s *batch, struct bl_pin_meta_s const *pin);
+bool bl_batch_function_unlink(struct bl_batch_s *batch, struct bl_function_meta_s *funct);
+#endif
+
+/**************************************************************
+ * Discard everything staged in a batch that has not been
+ * committed.
+ */
+bool bl_batch_clear(struct bl_batch_s *batch);
+
+/**************************************************************
+ * Queue a batch to be applied by its thread.  Fails with
+ * BL_ERR_BUSY if another batch is still pending for the
+ * thread.  Poll bl_batch_status() for BL_BATCH_DONE to know
+ * when the changes have been made.
+ */
+bool bl_batch_commit(struct bl_batch_s *batch);
+bl_batch_status_t bl_batch_status(struct bl_batch_s const *batch);
+#endif
 
 /**************************************************************
  * Helper function to get the address of thread data; this is
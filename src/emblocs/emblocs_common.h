@@ -57,6 +57,9 @@ typedef enum {
     BL_ERR_TOO_BIG,         // object size exceeds limit
     BL_ERR_RAW_SIGNAL,      // signals cannot be of type 'raw', only pins
     BL_ERR_INTERNAL,        // internal error in emblocs data structures
+    BL_ERR_NOT_SEALED,      // operation needs a finalized thread
+    BL_ERR_BUSY,            // busy (pending batch, table in use, threads sealed); retry later
+    BL_ERR_READ_ONLY,       // metadata is const, see EBL_STATIC_META
     BL_ERRNO_MAX
 } bl_errno_t;
 
@@ -150,4 +153,15 @@ struct bl_signal_meta_s;
 struct bl_thread_meta_s;
 struct bl_thread_data_s;
 
+/**************************************************************
+ * Tests the enable flag of a thread function, in the threads
+ * generated by the system compiler.  Without EBL_FUNCTION_ENABLE
+ * the flags don't exist and every function is always called.
+ */
+#ifdef EBL_FUNCTION_ENABLE
+#define BL_FUNCTION_ENABLED(flag)   (flag)
+#else
+#define BL_FUNCTION_ENABLED(flag)   (1)
+#endif
+
 #endif // EMBLOCS_COMMON_H
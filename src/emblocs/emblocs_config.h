@@ -55,4 +55,71 @@
  */
 #define EBL_NULL_POINTER_CHECKS
 
+/* Uncomment this define to index blocks, signals and
+ * threads by name with hash tables in the meta pool.
+ * Lookups and insertions become O(1) instead of O(n),
+ * which matters when building large systems at runtime.
+ * Costs 8 to 16 bytes of meta pool per object.
+ */
+//#define EBL_NAME_INDEX
+
+/* Uncomment this define to measure the time used by
+ * every thread function, using EBL_CYCLE_COUNT() from
+ * target_hooks.h.  See emblocs_profile.h.  Adds two
+ * counter reads and some bookkeeping to each call.
+ */
+//#define EBL_PROFILE
+
+/* Uncomment this define to keep statistics for every
+ * thread: actual period, a histogram of execution time,
+ * and counts of overruns and re-entries.  It is cheap
+ * enough to leave enabled in production.  Needs the
+ * cycle counter hooks in target_hooks.h.
+ */
+//#define EBL_THREAD_STATS
+
+/* Uncomment this define to support reconfiguration
+ * batches, which stage pin, signal and function changes
+ * and apply them all at once at the start of a thread
+ * run.  See bl_batch_new() in emblocs_api.h.  Adds one
+ * pointer test to every thread run.
+ */
+//#define EBL_BATCH
+
+/* Uncomment this define to give every thread function an
+ * enable flag, so it can be switched off and on again
+ * without unlinking it.  See bl_function_enable() in
+ * emblocs_api.h.  Adds one flag test to every function
+ * call.
+ */
+//#define EBL_FUNCTION_ENABLE
+
+/* Uncomment this define to size the memory pools exactly
+ * for one system, using the header that blocs_compiler.py
+ * writes next to the system's .c file.  Define
+ * BL_RT_POOL_SPARE and BL_META_POOL_SPARE (in bytes) to
+ * leave room for anything the application builds later.
+ */
+//#define EBL_POOL_HEADER             "system_pools.h"
+
+/* Uncomment this define when the system is generated by
+ * blocs_compiler.py --meta.  The metadata is then const
+ * data in flash, built by the compiler instead of at
+ * startup, and the pools are the generated realtime data
+ * and metadata.  Show, find and pin and signal changes
+ * still work, but nothing can be created, and functions
+ * can't be moved between threads.  Can't be used with
+ * EBL_NAME_INDEX.
+ */
+//#define EBL_STATIC_META
+
+/* Edges of the thread execution time histogram, in
+ * percent of the thread period, in ascending order.
+ * There is one more bucket than there are edges; the
+ * last bucket counts runs that were longer than the
+ * last edge.
+ */
+#define EBL_THREAD_HIST_EDGE_COUNT  (5)
+#define EBL_THREAD_HIST_EDGES       25, 50, 75, 90, 100
+
 #endif // EMBLOCS_CONFIG_H
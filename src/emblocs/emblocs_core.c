@@ -1,5 +1,7 @@
 #include <emblocs_priv.h>
 #include <linked_list.h>
+#include <name_index.h>
+#include <target_hooks.h>   // EBL_FAST_DATA, EBL_MEMORY_BARRIER
 #include <string.h>         // strcmp
 #include <stdio.h>      // FIXME - printf for rasp pi
 
@@ -24,6 +26,9 @@ static char const *error_strings[] = {
     "object too large",
     "signal cannot be 'raw'",
     "internal data structure error",
+    "thread not finalized",
+    "busy: retry later",
+    "metadata is read-only",
     "unknown error"
 };
 
@@ -41,7 +46,16 @@ char const *bl_errstr(void)
  * memory pools
  */
 
-uint32_t bl_rt_pool[BL_RT_POOL_SIZE >> 2]  __attribute__ ((aligned(4)));
+#ifdef EBL_STATIC_META
+/* The generated system defines the pools, already full, and
+ * their sizes. */
+uint32_t *bl_rt_pool_next = NULL;
+uint32_t bl_rt_pool_avail = 0;
+
+uint32_t *bl_meta_pool_next = NULL;
+uint32_t bl_meta_pool_avail = 0;
+#else
+EBL_FAST_DATA uint32_t bl_rt_pool[BL_RT_POOL_SIZE >> 2]  __attribute__ ((aligned(4)));
 uint32_t *bl_rt_pool_next = bl_rt_pool;
 uint32_t bl_rt_pool_avail = sizeof(bl_rt_pool);
 const uint32_t bl_rt_pool_size = sizeof(bl_rt_pool);
@@ -50,6 +64,7 @@ uint32_t bl_meta_pool[BL_META_POOL_SIZE >> 2]  __attribute__ ((aligned(4)));
 uint32_t *bl_meta_pool_next = bl_meta_pool;
 uint32_t bl_meta_pool_avail = sizeof(bl_meta_pool);
 const uint32_t bl_meta_pool_size = sizeof(bl_meta_pool);
+#endif
 
 /* memory allocation functions */
 
@@ -92,6 +107,7 @@ static void *alloc_from_meta_pool(uint32_t size)
 }
 
 
+#ifndef EBL_STATIC_META
 /* root of block linked list */
 bl_block_meta_t *block_root;
 
@@ -100,7 +116,23 @@ bl_signal_meta_t *signal_root;
 
 /* root of thread linked list */
 bl_thread_meta_t *thread_root;
+#endif
+
 
+/* Hash indexes of the top-level lists, used if EBL_NAME_INDEX
+ * is defined.  The slots are allocated from the meta pool,
+ * starting with BL_NAME_INDEX_MIN_SLOTS and doubling each time
+ * an index gets full.  Old slots are not reclaimed, so at most
+ * half the space used by an index is wasted. */
+#define BL_NAME_INDEX_MIN_SLOTS (16)
+static ni_index_t block_index = NI_INDEX_INIT(bl_block_meta_t);
+static ni_index_t signal_index = NI_INDEX_INIT(bl_signal_meta_t);
+static ni_index_t thread_index = NI_INDEX_INIT(bl_thread_meta_t);
+
+/* With an index, new nodes are pushed on the head of a list
+ * instead of being inserted in order, and the lists are sorted
+ * when needed, see bl_sort_metadata() */
+static bool lists_sorted = true;
 
 /* linked list callback functions */
 static int block_meta_compare_names(void *node1, void *node2)
@@ -139,6 +171,47 @@ static int thread_meta_compare_names(void *node1, void *node2)
 }
 
 
+/* Adds 'node' to one of the top-level lists.  Without an index,
+ * insertion walks the sorted list, so building a system of n
+ * blocks takes O(n^2) time.  With an index, it takes O(1). */
+static bool list_add(void **root, void *node, ll_funct_cmp_nodes_t funct, ni_index_t *index)
+{
+#ifdef EBL_NAME_INDEX
+    void **slots;
+    uint32_t size;
+
+    (void)funct;
+    if ( ni_full(index) ) {
+        size = ( index->size > 0 ) ? index->size * 2 : BL_NAME_INDEX_MIN_SLOTS;
+        slots = alloc_from_meta_pool(size * sizeof(void *));
+        CHECK_RETURN(slots);
+        ni_rehash(index, slots, size);
+    }
+    if ( ni_insert(index, node) != 0 ) {
+        ERROR_RETURN(BL_ERR_NAME_EXISTS);
+    }
+    ll_push(root, node);
+    lists_sorted = false;
+#else
+    (void)index;
+    if ( ll_insert(root, node, funct) != 0 ) {
+        ERROR_RETURN(BL_ERR_NAME_EXISTS);
+    }
+#endif
+    return true;
+}
+
+void bl_sort_metadata(void)
+{
+    if ( ! lists_sorted ) {
+        ll_sort((void **)(&block_root), block_meta_compare_names);
+        ll_sort((void **)(&signal_root), sig_meta_compare_names);
+        ll_sort((void **)(&thread_root), thread_meta_compare_names);
+        lists_sorted = true;
+    }
+}
+
+
 /**************************************************************
  * Top-level EMBLOCS API functions used to build a system     *
  **************************************************************/
@@ -176,7 +249,7 @@ struct bl_signal_meta_s *bl_signal_new(char const *name, bl_type_t type)
 {
     struct bl_signal_meta_s *meta;
     bl_sig_data_t *data;
-    int ll_result;
+    bool retval __attribute__ ((unused));
 
     CHECK_NULL(name);
     // signals cannot be 'raw'
@@ -196,10 +269,8 @@ struct bl_signal_meta_s *bl_signal_new(char const *name, bl_type_t type)
     meta->data_type = type;
     meta->name = name;
     // add metadata to master signal list
-    ll_result = ll_insert((void **)(&(signal_root)), (void *)meta, sig_meta_compare_names);
-    if ( ll_result != 0 ) {
-        ERROR_RETURN(BL_ERR_NAME_EXISTS);
-    }
+    retval = list_add((void **)(&(signal_root)), (void *)meta, sig_meta_compare_names, &signal_index);
+    CHECK_RETURN(retval);
     return meta;
 }
 
@@ -273,7 +344,7 @@ struct bl_thread_meta_s *bl_thread_new(char const *name, uint32_t period_ns, bl_
 {
     bl_thread_meta_t *meta;
     bl_thread_data_t *data;
-    int ll_result;
+    bool retval __attribute__ ((unused));
 
     CHECK_NULL(name);
     // allocate memory for metadata
@@ -285,26 +356,186 @@ struct bl_thread_meta_s *bl_thread_new(char const *name, uint32_t period_ns, bl_
     // initialize data fields
     data->period_ns = period_ns;
     data->start = NULL;
+    data->table = NULL;
+    data->spare = NULL;
+    data->walking = NULL;
+    data->table_size = 0;
+    data->spare_size = 0;
+#ifdef EBL_PROFILE
+    data->profile_reset = 0;
+#endif
+#ifdef EBL_BATCH
+    data->batch = NULL;
+#endif
+#ifdef EBL_THREAD_STATS
+    // the rest is initialized by the first run of the thread
+    data->stats.period_ns = period_ns;
+    data->stats.reset = 1;
+#endif
     // initialise metadata fields
     meta->data_index = TO_RT_INDEX(data);
     meta->nofp = nofp;
     meta->name = name;
     // add metadata to master thread list
-    ll_result = ll_insert((void **)(&(thread_root)), (void *)meta, thread_meta_compare_names);
-    if ( ll_result != 0 ) {
-        ERROR_RETURN(BL_ERR_NAME_EXISTS);
-    }
+    retval = list_add((void **)(&(thread_root)), (void *)meta, thread_meta_compare_names, &thread_index);
+    CHECK_RETURN(retval);
     return meta;
 }
 
+/* dispatch table helper functions */
+static uint32_t thread_count_functions(bl_thread_data_t const *data)
+{
+    bl_function_rtdata_t *funct_data;
+    uint32_t count;
+
+    count = 0;
+    funct_data = data->start;
+    while ( funct_data != NULL ) {
+        count++;
+        funct_data = funct_data->next;
+    }
+    return count;
+}
+
+/* makes sure the spare table can hold 'count' functions */
+static bool thread_reserve_table(bl_thread_data_t *data, uint32_t count)
+{
+    bl_dispatch_entry_t *table;
+
+#ifdef EBL_BATCH
+    // a pending batch may have built its table in the spare
+    if ( data->batch != NULL ) ERROR_RETURN(BL_ERR_BUSY);
+#endif
+    if ( ( data->spare != NULL ) && ( data->spare_size >= count ) ) {
+        // the thread may not be done with it yet, if it started
+        // its run before the last swap
+        EBL_MEMORY_BARRIER();
+        if ( data->walking == data->spare ) ERROR_RETURN(BL_ERR_BUSY);
+        return true;
+    }
+    if ( count > UINT16_MAX ) ERROR_RETURN(BL_ERR_RANGE);
+    if ( data->table != NULL ) {
+        // sealed, so it will be rebuilt again; without headroom
+        // every link would abandon a table in the pool
+        count += count/2 + 1;
+        if ( count > UINT16_MAX ) count = UINT16_MAX;
+    }
+    // allocate room for 'count' entries plus the terminator
+    table = alloc_from_rt_pool((count+1)*sizeof(bl_dispatch_entry_t));
+    CHECK_RETURN(table);
+    data->spare = table;
+    data->spare_size = (uint16_t)count;
+    return true;
+}
+
+/* fills the spare table from the function list; caller must
+   have reserved enough space */
+static void thread_fill_spare(bl_thread_data_t *data)
+{
+    bl_function_rtdata_t *funct_data;
+    bl_dispatch_entry_t *entry;
+
+    entry = data->spare;
+    funct_data = data->start;
+    while ( funct_data != NULL ) {
+        entry->funct = funct_data->funct;
+        entry->block_data = funct_data->block_data;
+#ifdef EBL_PROFILE
+        entry->profile = &(funct_data->profile);
+#endif
+#ifdef EBL_FUNCTION_ENABLE
+        entry->enabled = &(funct_data->enabled);
+#endif
+        entry++;
+        funct_data = funct_data->next;
+    }
+    entry->funct = NULL;
+    entry->block_data = NULL;
+#ifdef EBL_PROFILE
+    entry->profile = NULL;
+#endif
+#ifdef EBL_FUNCTION_ENABLE
+    entry->enabled = NULL;
+#endif
+}
+
+/* makes the spare table the active one; bl_thread_run() only
+   reads 'table' */
+static void thread_swap_tables(bl_thread_data_t *data)
+{
+    bl_dispatch_entry_t *old_table;
+    uint16_t old_size;
+
+    old_table = data->table;
+    old_size = data->table_size;
+    // the entries must be in memory before the thread can see
+    // the table
+    EBL_MEMORY_BARRIER();
+    data->table = data->spare;
+    data->table_size = data->spare_size;
+    data->spare = old_table;
+    data->spare_size = old_size;
+}
+
+/* fills the spare table from the function list, then makes it
+   the active table; caller must have reserved enough space */
+static void thread_build_table(bl_thread_data_t *data)
+{
+    thread_fill_spare(data);
+    thread_swap_tables(data);
+}
+
+/* function list helper functions */
+static void thread_append_function(bl_thread_data_t *thread_data, bl_function_rtdata_t *funct_data)
+{
+    bl_function_rtdata_t *prev, **prev_ptr;
+
+    // find end of thread
+    prev_ptr = &(thread_data->start);
+    prev = *prev_ptr;
+    while ( prev != NULL ) {
+        prev_ptr = &(prev->next);
+        prev = *prev_ptr;
+    }
+    // append function RT data to thread
+    funct_data->next = NULL;
+    *prev_ptr = funct_data;
+}
+
+#if defined(BL_ENABLE_UNLINK) || defined(EBL_BATCH)
+/* returns false if the function is not in the thread */
+static bool thread_remove_function(bl_thread_data_t *thread_data, bl_function_rtdata_t *funct_data)
+{
+    bl_function_rtdata_t *prev, **prev_ptr;
+
+    // traverse thread list
+    prev_ptr = &(thread_data->start);
+    prev = *prev_ptr;
+    while ( prev != NULL ) {
+        if ( prev == funct_data ) {
+            // found it, unlink
+            *prev_ptr = funct_data->next;
+            return true;
+        }
+        prev_ptr = &(prev->next);
+        prev = *prev_ptr;
+    }
+    return false;
+}
+#endif
+
 bool bl_function_linkto_thread(struct bl_function_meta_s *funct, struct bl_thread_meta_s const *thread)
 {
     bl_function_rtdata_t *funct_data;
     bl_thread_data_t *thread_data;
-    bl_function_rtdata_t *prev, **prev_ptr;
+    bool retval __attribute__ ((unused));
 
     CHECK_NULL(funct);
     CHECK_NULL(thread);
+#ifdef EBL_STATIC_META
+    // the generated threads don't use the function lists
+    ERROR_RETURN(BL_ERR_READ_ONLY);
+#endif
     // validate floating point
     if ( ( thread->nofp == BL_NO_FP) && ( funct->nofp == BL_HAS_FP ) ) {
         ERROR_RETURN(BL_ERR_TYPE_MISMATCH);
@@ -316,21 +547,20 @@ bool bl_function_linkto_thread(struct bl_function_meta_s *funct, struct bl_threa
         ERROR_RETURN(BL_ERR_ALREADY_LINKED);
         #endif
     }
-    // link function metadata back to the thread
-    funct->thread_index = TO_META_INDEX(thread);
     // get pointers to realtime data
     funct_data = TO_RT_ADDR(funct->rtdata_index);
     thread_data = TO_RT_ADDR(thread->data_index);
-    // find end of thread
-    prev_ptr = &(thread_data->start);
-    prev = *prev_ptr;
-    while ( prev != NULL ) {
-        prev_ptr = &(prev->next);
-        prev = *prev_ptr;
+    if ( thread_data->table != NULL ) {
+        // sealed thread, make sure the table can be rebuilt
+        retval = thread_reserve_table(thread_data, thread_count_functions(thread_data)+1);
+        CHECK_RETURN(retval);
+    }
+    // link function metadata back to the thread
+    funct->thread_index = TO_META_INDEX(thread);
+    thread_append_function(thread_data, funct_data);
+    if ( thread_data->table != NULL ) {
+        thread_build_table(thread_data);
     }
-    // append function RT data to thread
-    funct_data->next = NULL;
-    *prev_ptr = funct_data;
     return true;
 }
 
@@ -340,9 +570,12 @@ bool bl_function_unlink(struct bl_function_meta_s *funct)
     bl_thread_meta_t *thread;
     bl_function_rtdata_t *funct_data;
     bl_thread_data_t *thread_data;
-    bl_function_rtdata_t *prev, **prev_ptr;
+    bool retval __attribute__ ((unused));
 
     CHECK_NULL(funct);
+#ifdef EBL_STATIC_META
+    ERROR_RETURN(BL_ERR_READ_ONLY);
+#endif
     if ( funct->thread_index == BL_META_MAX_INDEX ) {
         // function is not in a thread; done
         return true;
@@ -351,38 +584,591 @@ bool bl_function_unlink(struct bl_function_meta_s *funct)
     // get pointers to realtime data
     funct_data = TO_RT_ADDR(funct->rtdata_index);
     thread_data = TO_RT_ADDR(thread->data_index);
-    // traverse thread list
-    prev_ptr = &(thread_data->start);
-    prev = *prev_ptr;
-    while ( prev != NULL ) {
-        if ( prev == funct_data ) {
-            // found it, unlink
-            *prev_ptr = funct_data->next;
-            // reset metadata to 'unlinked'
+    if ( thread_data->table != NULL ) {
+        // sealed thread, make sure the table can be rebuilt
+        retval = thread_reserve_table(thread_data, thread_count_functions(thread_data));
+        CHECK_RETURN(retval);
+    }
+    if ( ! thread_remove_function(thread_data, funct_data) ) {
+        // not found in thread
+        ERROR_RETURN(BL_ERR_INTERNAL);
+    }
+    // reset metadata to 'unlinked'
+    funct->thread_index = BL_META_MAX_INDEX;
+    if ( thread_data->table != NULL ) {
+        thread_build_table(thread_data);
+    }
+    return true;
+}
+#endif
+
+#ifdef EBL_FUNCTION_ENABLE
+bool bl_function_enable(struct bl_function_meta_s const *funct, bool enable)
+{
+    bl_function_rtdata_t *funct_data;
+
+    CHECK_NULL(funct);
+    funct_data = TO_RT_ADDR(funct->rtdata_index);
+    // a single word store, so the thread sees either the old
+    // or the new value, and can be running while we do it
+    funct_data->enabled = enable ? 1 : 0;
+    return true;
+}
+
+bool bl_function_is_enabled(struct bl_function_meta_s const *funct)
+{
+    bl_function_rtdata_t *funct_data;
+
+    CHECK_NULL(funct);
+    funct_data = TO_RT_ADDR(funct->rtdata_index);
+    return funct_data->enabled != 0;
+}
+#endif
+
+bool bl_thread_finalize(struct bl_thread_meta_s const *thread)
+{
+    bl_thread_data_t *thread_data;
+    bool retval __attribute__ ((unused));
+
+    CHECK_NULL(thread);
+    thread_data = TO_RT_ADDR(thread->data_index);
+    retval = thread_reserve_table(thread_data, thread_count_functions(thread_data));
+    CHECK_RETURN(retval);
+    thread_build_table(thread_data);
+    return true;
+}
+
+bool bl_thread_finalize_all(void)
+{
+    bl_thread_meta_t *thread;
+    bool retval __attribute__ ((unused));
+
+    thread = thread_root;
+    while ( thread != NULL ) {
+        retval = bl_thread_finalize(thread);
+        CHECK_RETURN(retval);
+        thread = thread->next;
+    }
+    return true;
+}
+
+#ifdef EBL_BATCH
+struct bl_batch_s *bl_batch_new(struct bl_thread_meta_s const *thread, uint32_t max_ops)
+{
+    bl_batch_t *batch;
+
+    CHECK_NULL(thread);
+    if ( ( max_ops == 0 ) || ( max_ops > UINT16_MAX ) ) ERROR_RETURN(BL_ERR_RANGE);
+    // the thread reads the batch, so it goes in the RT pool
+    batch = alloc_from_rt_pool(sizeof(bl_batch_t) + max_ops*sizeof(bl_batch_op_t));
+    CHECK_RETURN(batch);
+    batch->thread = thread;
+    batch->thread_data = TO_RT_ADDR(thread->data_index);
+    batch->status = BL_BATCH_STAGING;
+    batch->op_count = 0;
+    batch->max_ops = (uint16_t)max_ops;
+    batch->swap_tables = 0;
+    return batch;
+}
+
+/* makes sure there is room to stage 'count' more operations,
+   starting over if the batch has already been applied */
+static bool batch_reserve_ops(bl_batch_t *batch, uint32_t count)
+{
+    if ( batch->status == BL_BATCH_PENDING ) ERROR_RETURN(BL_ERR_BUSY);
+    if ( batch->status == BL_BATCH_DONE ) {
+        batch->op_count = 0;
+        batch->swap_tables = 0;
+        batch->status = BL_BATCH_STAGING;
+    }
+    if ( ( batch->op_count + count ) > batch->max_ops ) ERROR_RETURN(BL_ERR_TOO_BIG);
+    return true;
+}
+
+/* caller must have reserved room */
+static bl_batch_op_t *batch_add_op(bl_batch_t *batch, uint32_t kind, void *dest)
+{
+    bl_batch_op_t *op;
+
+    op = &(batch->ops[batch->op_count++]);
+    op->kind = kind;
+    op->dest = dest;
+    return op;
+}
+
+/* returns the value the pointer at 'dest' will have once the
+   staged operations are applied */
+static void *batch_peek_ptr(bl_batch_t const *batch, void *dest)
+{
+    void *value;
+
+    value = *(void **)dest;
+    for ( uint32_t n = 0 ; n < batch->op_count ; n++ ) {
+        if ( ( batch->ops[n].kind == BL_BATCH_OP_PTR ) && ( batch->ops[n].dest == dest ) ) {
+            value = batch->ops[n].value.p;
+        }
+    }
+    return value;
+}
+
+/* returns true if 'funct' will be in the batch's thread once
+   the staged operations are applied */
+static bool batch_peek_funct(bl_batch_t const *batch, bl_function_meta_t const *funct)
+{
+    bool linked;
+
+    linked = ( funct->thread_index == TO_META_INDEX(batch->thread) );
+    for ( uint32_t n = 0 ; n < batch->op_count ; n++ ) {
+        if ( batch->ops[n].dest == funct ) {
+            if ( batch->ops[n].kind == BL_BATCH_OP_LINK ) {
+                linked = true;
+            } else if ( batch->ops[n].kind == BL_BATCH_OP_UNLINK ) {
+                linked = false;
+            }
+        }
+    }
+    return linked;
+}
+
+bool bl_batch_pin_linkto_signal(struct bl_batch_s *batch, bl_pin_meta_t const *pin, bl_signal_meta_t const *sig)
+{
+    bl_batch_op_t *op;
+    bool retval __attribute__ ((unused));
+
+    CHECK_NULL(batch);
+    CHECK_NULL(pin);
+    CHECK_NULL(sig);
+    // check types
+    if ( ( pin->data_type != sig->data_type ) && ( pin->data_type != BL_TYPE_RAW ) ) {
+        ERROR_RETURN(BL_ERR_TYPE_MISMATCH);
+    }
+    #ifndef BL_ENABLE_IMPLICIT_UNLINK
+    if ( batch_peek_ptr(batch, TO_RT_ADDR(pin->ptr_index)) != TO_RT_ADDR(pin->dummy_index) ) {
+        ERROR_RETURN(BL_ERR_ALREADY_LINKED);
+    }
+    #endif
+    retval = batch_reserve_ops(batch, 1);
+    CHECK_RETURN(retval);
+    op = batch_add_op(batch, BL_BATCH_OP_PTR, TO_RT_ADDR(pin->ptr_index));
+    op->value.p = TO_RT_ADDR(sig->data_index);
+    return true;
+}
+
+#ifdef BL_ENABLE_UNLINK
+bool bl_batch_pin_unlink(struct bl_batch_s *batch, bl_pin_meta_t const *pin)
+{
+    bl_batch_op_t *op;
+    bool retval __attribute__ ((unused));
+
+    CHECK_NULL(batch);
+    CHECK_NULL(pin);
+    retval = batch_reserve_ops(batch, 2);
+    CHECK_RETURN(retval);
+    // copy the value of the signal the pin will be linked to
+    // at that point to the dummy, then link pin to its dummy
+    op = batch_add_op(batch, BL_BATCH_OP_COPY, TO_RT_ADDR(pin->dummy_index));
+    op->value.src = batch_peek_ptr(batch, TO_RT_ADDR(pin->ptr_index));
+    op = batch_add_op(batch, BL_BATCH_OP_PTR, TO_RT_ADDR(pin->ptr_index));
+    op->value.p = TO_RT_ADDR(pin->dummy_index);
+    return true;
+}
+#endif
+
+bool bl_batch_signal_set(struct bl_batch_s *batch, bl_signal_meta_t const *sig, bl_sig_data_t const *value)
+{
+    bl_batch_op_t *op;
+    bool retval __attribute__ ((unused));
+
+    CHECK_NULL(batch);
+    CHECK_NULL(sig);
+    CHECK_NULL(value);
+    retval = batch_reserve_ops(batch, 1);
+    CHECK_RETURN(retval);
+    op = batch_add_op(batch, BL_BATCH_OP_WORD, TO_RT_ADDR(sig->data_index));
+    op->value.u = value->u;
+    return true;
+}
+
+bool bl_batch_pin_set(struct bl_batch_s *batch, bl_pin_meta_t const *pin, bl_sig_data_t const *value)
+{
+    bl_batch_op_t *op;
+    bool retval __attribute__ ((unused));
+
+    CHECK_NULL(batch);
+    CHECK_NULL(pin);
+    CHECK_NULL(value);
+    retval = batch_reserve_ops(batch, 1);
+    CHECK_RETURN(retval);
+    // sets whatever the pin will be linked to at that point
+    op = batch_add_op(batch, BL_BATCH_OP_WORD, batch_peek_ptr(batch, TO_RT_ADDR(pin->ptr_index)));
+    op->value.u = value->u;
+    return true;
+}
+
+bool bl_batch_function_linkto_thread(struct bl_batch_s *batch, struct bl_function_meta_s *funct)
+{
+    bool retval __attribute__ ((unused));
+
+    CHECK_NULL(batch);
+    CHECK_NULL(funct);
+    if ( batch->thread_data->table == NULL ) ERROR_RETURN(BL_ERR_NOT_SEALED);
+    // validate floating point
+    if ( ( batch->thread->nofp == BL_NO_FP) && ( funct->nofp == BL_HAS_FP ) ) {
+        ERROR_RETURN(BL_ERR_TYPE_MISMATCH);
+    }
+    if ( ( ( funct->thread_index != BL_META_MAX_INDEX ) && ( funct->thread_index != TO_META_INDEX(batch->thread) ) )
+            || batch_peek_funct(batch, funct) ) {
+        ERROR_RETURN(BL_ERR_ALREADY_LINKED);
+    }
+    retval = batch_reserve_ops(batch, 1);
+    CHECK_RETURN(retval);
+    batch_add_op(batch, BL_BATCH_OP_LINK, funct);
+    return true;
+}
+
+#ifdef BL_ENABLE_UNLINK
+bool bl_batch_function_unlink(struct bl_batch_s *batch, struct bl_function_meta_s *funct)
+{
+    bool retval __attribute__ ((unused));
+
+    CHECK_NULL(batch);
+    CHECK_NULL(funct);
+    if ( batch->thread_data->table == NULL ) ERROR_RETURN(BL_ERR_NOT_SEALED);
+    if ( ! batch_peek_funct(batch, funct) ) ERROR_RETURN(BL_ERR_NOT_FOUND);
+    retval = batch_reserve_ops(batch, 1);
+    CHECK_RETURN(retval);
+    batch_add_op(batch, BL_BATCH_OP_UNLINK, funct);
+    return true;
+}
+#endif
+
+bool bl_batch_clear(struct bl_batch_s *batch)
+{
+    CHECK_NULL(batch);
+    if ( batch->status == BL_BATCH_PENDING ) ERROR_RETURN(BL_ERR_BUSY);
+    batch->op_count = 0;
+    batch->swap_tables = 0;
+    batch->status = BL_BATCH_STAGING;
+    return true;
+}
+
+/* makes the staged function links and unlinks in the function
+   list, and builds the new dispatch table in the spare */
+static bool batch_commit_functions(bl_batch_t *batch)
+{
+    bl_thread_data_t *thread_data;
+    bl_function_meta_t *funct;
+    uint32_t count, links;
+    bool retval __attribute__ ((unused));
+
+    thread_data = batch->thread_data;
+    links = 0;
+    count = thread_count_functions(thread_data);
+    for ( uint32_t n = 0 ; n < batch->op_count ; n++ ) {
+        if ( batch->ops[n].kind == BL_BATCH_OP_LINK ) {
+            links++;
+            count++;
+        } else if ( batch->ops[n].kind == BL_BATCH_OP_UNLINK ) {
+            links++;
+            count--;
+        }
+    }
+    if ( links == 0 ) {
+        return true;
+    }
+    // the batch was validated as it was staged, so after this
+    // nothing can fail
+    retval = thread_reserve_table(thread_data, count);
+    CHECK_RETURN(retval);
+    for ( uint32_t n = 0 ; n < batch->op_count ; n++ ) {
+        funct = batch->ops[n].dest;
+        if ( batch->ops[n].kind == BL_BATCH_OP_LINK ) {
+            funct->thread_index = TO_META_INDEX(batch->thread);
+            thread_append_function(thread_data, TO_RT_ADDR(funct->rtdata_index));
+        } else if ( batch->ops[n].kind == BL_BATCH_OP_UNLINK ) {
             funct->thread_index = BL_META_MAX_INDEX;
-            return true;
+            thread_remove_function(thread_data, TO_RT_ADDR(funct->rtdata_index));
         }
-        prev_ptr = &(prev->next);
-        prev = *prev_ptr;
     }
-    // not found in thread
-    ERROR_RETURN(BL_ERR_INTERNAL);
+    thread_fill_spare(thread_data);
+    batch->swap_tables = 1;
+    return true;
+}
+
+bool bl_batch_commit(struct bl_batch_s *batch)
+{
+    bool retval __attribute__ ((unused));
+
+    CHECK_NULL(batch);
+    if ( ( batch->status == BL_BATCH_PENDING ) || ( batch->thread_data->batch != NULL ) ) {
+        ERROR_RETURN(BL_ERR_BUSY);
+    }
+    if ( batch->status == BL_BATCH_DONE ) {
+        // nothing new staged
+        return true;
+    }
+    retval = batch_commit_functions(batch);
+    CHECK_RETURN(retval);
+    batch->status = BL_BATCH_PENDING;
+    // everything above must be in memory before the thread
+    // can see the batch
+    EBL_MEMORY_BARRIER();
+    batch->thread_data->batch = batch;
+    return true;
+}
+
+bl_batch_status_t bl_batch_status(struct bl_batch_s const *batch)
+{
+    return (bl_batch_status_t)batch->status;
+}
+
+/* called by the thread, before it calls any functions */
+static void thread_apply_batch(bl_thread_data_t *thread)
+{
+    bl_batch_t *batch;
+    bl_batch_op_t const *op, *end;
+
+    batch = thread->batch;
+    op = batch->ops;
+    end = op + batch->op_count;
+    while ( op < end ) {
+        switch ( op->kind ) {
+        case BL_BATCH_OP_WORD:
+            *(uint32_t *)(op->dest) = op->value.u;
+            break;
+        case BL_BATCH_OP_PTR:
+            *(void **)(op->dest) = op->value.p;
+            break;
+        case BL_BATCH_OP_COPY:
+            *(uint32_t *)(op->dest) = *(uint32_t const *)(op->value.src);
+            break;
+        default:
+            // function links were made by bl_batch_commit()
+            break;
+        }
+        op++;
+    }
+    if ( batch->swap_tables ) {
+        thread_swap_tables(thread);
+    }
+    thread->batch = NULL;
+    batch->status = BL_BATCH_DONE;
 }
 #endif
 
-void bl_thread_run(struct bl_thread_data_s const *thread, uint32_t period_ns)
+/* Moves a signal (real or dummy) to 'new_addr', and fixes up
+ * everything that refers to it: pin pointers, pin dummy
+ * indexes, and signal data indexes.  The old location is
+ * abandoned, since the RT pool has no free. */
+static void relocate_signal(bl_sig_data_t *old_addr, bl_sig_data_t *new_addr)
+{
+    bl_block_meta_t *blk;
+    bl_pin_meta_t *pin;
+    bl_signal_meta_t *sig;
+    bl_sig_data_t **ptr_addr;
+    uint32_t old_index, new_index;
+
+    *new_addr = *old_addr;
+    old_index = TO_RT_INDEX(old_addr);
+    new_index = TO_RT_INDEX(new_addr);
+    blk = block_root;
+    while ( blk != NULL ) {
+        pin = blk->pin_list;
+        while ( pin != NULL ) {
+            ptr_addr = TO_RT_ADDR(pin->ptr_index);
+            if ( *ptr_addr == old_addr ) {
+                *ptr_addr = new_addr;
+            }
+            if ( pin->dummy_index == old_index ) {
+                pin->dummy_index = new_index & BL_RT_INDEX_MASK;
+            }
+            pin = pin->next;
+        }
+        blk = blk->next;
+    }
+    sig = signal_root;
+    while ( sig != NULL ) {
+        if ( sig->data_index == old_index ) {
+            sig->data_index = new_index & BL_RT_INDEX_MASK;
+        }
+        sig = sig->next;
+    }
+}
+
+/* start of the run of signals that bl_thread_layout() moved,
+ * NULL until its first call; everything at or above it has
+ * been laid out by a call for this or a faster thread */
+static uint32_t *layout_start = NULL;
+
+/* returns the block that owns 'block_data', or NULL */
+static bl_block_meta_t *find_block_by_data(void *block_data)
+{
+    bl_block_meta_t *blk;
+
+    blk = block_root;
+    while ( blk != NULL ) {
+        if ( TO_RT_ADDR(blk->data_index) == block_data ) {
+            return blk;
+        }
+        blk = blk->next;
+    }
+    return NULL;
+}
+
+bool bl_thread_layout(struct bl_thread_meta_s const *thread)
 {
+    bl_thread_meta_t *other;
+    bl_thread_data_t *thread_data;
     bl_function_rtdata_t *function;
+    bl_block_meta_t *blk;
+    bl_pin_meta_t *pin;
+    bl_sig_data_t **ptr_addr, *new_addr;
 
-    if ( period_ns == 0 ) {
-        period_ns = thread->period_ns;
+    CHECK_NULL(thread);
+    // moving a signal isn't atomic, and it may be shared with any
+    // thread, so no thread may be able to run
+    other = thread_root;
+    while ( other != NULL ) {
+        thread_data = TO_RT_ADDR(other->data_index);
+        if ( thread_data->table != NULL ) ERROR_RETURN(BL_ERR_BUSY);
+        other = other->next;
+    }
+    thread_data = TO_RT_ADDR(thread->data_index);
+    if ( layout_start == NULL ) {
+        layout_start = bl_rt_pool_next;
+    }
+    function = thread_data->start;
+    while ( function != NULL ) {
+        blk = find_block_by_data(function->block_data);
+        if ( blk == NULL ) {
+            ERROR_RETURN(BL_ERR_INTERNAL);
+        }
+        pin = blk->pin_list;
+        while ( pin != NULL ) {
+            ptr_addr = TO_RT_ADDR(pin->ptr_index);
+            if ( (uint32_t *)(*ptr_addr) < layout_start ) {
+                // not laid out yet; successive allocations are
+                // contiguous
+                new_addr = alloc_from_rt_pool(sizeof(bl_sig_data_t));
+                CHECK_RETURN(new_addr);
+                relocate_signal(*ptr_addr, new_addr);
+            }
+            pin = pin->next;
+        }
+        function = function->next;
     }
+    return true;
+}
+
+#ifdef EBL_PROFILE
+/* call a thread function and record how long it took */
+#define CALL_FUNCTION(funct, block_data, period_ns, prof) do { \
+        uint32_t start = EBL_CYCLE_COUNT(); \
+        (*(funct))(block_data, period_ns); \
+        bl_profile_record(prof, (EBL_CYCLE_COUNT() - start) & EBL_CYCLE_MASK); \
+    } while (0)
+#else
+#define CALL_FUNCTION(funct, block_data, period_ns, prof) (*(funct))(block_data, period_ns)
+#endif
+
+#ifdef EBL_FUNCTION_ENABLE
+/* true unless the function has been switched off */
+#define FUNCTION_ENABLED(enabled) (*(enabled))
+#else
+#define FUNCTION_ENABLED(enabled) (1)
+#endif
+
+#ifdef EBL_PROFILE
+bool bl_thread_profile_reset(struct bl_thread_meta_s const *thread)
+{
+    bl_thread_data_t *thread_data;
+
+    CHECK_NULL(thread);
+    thread_data = TO_RT_ADDR(thread->data_index);
+    // the data is cleared by the thread itself, see bl_thread_run()
+    thread_data->profile_reset = 1;
+    return true;
+}
+
+static void thread_profile_clear(struct bl_thread_data_s *thread)
+{
+    bl_function_rtdata_t *function;
+
     function = thread->start;
     while ( function != NULL ) {
-        // call the function
-        (*(function->funct))(function->block_data, period_ns);
+        bl_profile_clear(&(function->profile), 1);
         function = function->next;
     }
+    thread->profile_reset = 0;
+}
+#endif
+
+#ifdef EBL_THREAD_STATS
+bool bl_thread_stats_reset(struct bl_thread_meta_s const *thread)
+{
+    bl_thread_data_t *thread_data;
+
+    CHECK_NULL(thread);
+    thread_data = TO_RT_ADDR(thread->data_index);
+    // the stats are cleared by the thread itself, see bl_thread_run()
+    thread_data->stats.reset = 1;
+    return true;
+}
+#endif
+
+void bl_thread_run(struct bl_thread_data_s *thread, uint32_t period_ns)
+{
+    bl_dispatch_entry_t const *entry, *claimed;
+    bl_function_rtdata_t *function;
+
+#ifdef EBL_THREAD_STATS
+    bl_thread_stats_begin(&(thread->stats));
+#endif
+    if ( period_ns == 0 ) {
+        period_ns = thread->period_ns;
+    }
+#ifdef EBL_BATCH
+    if ( thread->batch != NULL ) {
+        thread_apply_batch(thread);
+    }
+#endif
+#ifdef EBL_PROFILE
+    if ( thread->profile_reset ) {
+        thread_profile_clear(thread);
+    }
+#endif
+    entry = thread->table;
+    if ( entry != NULL ) {
+        // sealed thread; claim the table so that it isn't rebuilt
+        // under us, then make sure it is still the active one
+        do {
+            claimed = entry;
+            thread->walking = claimed;
+            EBL_MEMORY_BARRIER();
+            entry = thread->table;
+        } while ( entry != claimed );
+        // walk the packed table
+        while ( entry->funct != NULL ) {
+            if ( FUNCTION_ENABLED(entry->enabled) ) {
+                CALL_FUNCTION(entry->funct, entry->block_data, period_ns, entry->profile);
+            }
+            entry++;
+        }
+        EBL_MEMORY_BARRIER();
+        thread->walking = NULL;
+    } else {
+        function = thread->start;
+        while ( function != NULL ) {
+            // call the function
+            if ( FUNCTION_ENABLED(&(function->enabled)) ) {
+                CALL_FUNCTION(function->funct, function->block_data, period_ns, &(function->profile));
+            }
+            function = function->next;
+        }
+    }
+#ifdef EBL_THREAD_STATS
+    bl_thread_stats_end(&(thread->stats));
+#endif
 }
 
 struct bl_thread_data_s *bl_thread_get_data(struct bl_thread_meta_s *thread)
@@ -428,12 +1214,39 @@ int bl_function_meta_compare_name_key(void *node, void *key)
     return strcmp(np->name, kp);
 }
 
+bl_block_meta_t *bl_block_lookup(char const *name)
+{
+#ifdef EBL_NAME_INDEX
+    return ni_find(&block_index, name);
+#else
+    return ll_find((void **)(&(block_root)), (void *)(name), bl_block_meta_compare_name_key);
+#endif
+}
+
+bl_signal_meta_t *bl_signal_lookup(char const *name)
+{
+#ifdef EBL_NAME_INDEX
+    return ni_find(&signal_index, name);
+#else
+    return ll_find((void **)(&(signal_root)), (void *)(name), bl_sig_meta_compare_name_key);
+#endif
+}
+
+bl_thread_meta_t *bl_thread_lookup(char const *name)
+{
+#ifdef EBL_NAME_INDEX
+    return ni_find(&thread_index, name);
+#else
+    return ll_find((void **)(&(thread_root)), (void *)(name), bl_thread_meta_compare_name_key);
+#endif
+}
+
 struct bl_block_meta_s *bl_block_find(char const *name)
 {
     bl_block_meta_t *retval;
 
     CHECK_NULL(name);
-    retval = ll_find((void **)(&(block_root)), (void *)(name), bl_block_meta_compare_name_key);
+    retval = bl_block_lookup(name);
     if ( retval == NULL ) {
         ERROR_RETURN(BL_ERR_NOT_FOUND);
     }
@@ -445,7 +1258,7 @@ struct bl_signal_meta_s *bl_signal_find(char const *name)
     bl_signal_meta_t *retval;
 
     CHECK_NULL(name);
-    retval = ll_find((void **)(&(signal_root)), (void *)(name), bl_sig_meta_compare_name_key);
+    retval = bl_signal_lookup(name);
     if ( retval == NULL ) {
         ERROR_RETURN(BL_ERR_NOT_FOUND);
     }
@@ -457,7 +1270,7 @@ struct bl_thread_meta_s *bl_thread_find(char const *name)
     bl_thread_meta_t *retval;
 
     CHECK_NULL(name);
-    retval = ll_find((void **)(&(thread_root)), (void *)(name), bl_thread_meta_compare_name_key);
+    retval = bl_thread_lookup(name);
     if ( retval == NULL ) {
         ERROR_RETURN(BL_ERR_NOT_FOUND);
     }
@@ -508,7 +1321,7 @@ struct bl_block_meta_s *bl_block_create(char const *name, bl_comp_def_t const *c
 {
     bl_block_meta_t *meta;
     void *data;
-    int ll_result;
+    bool retval __attribute__ ((unused));
 
     CHECK_NULL(name);
     CHECK_NULL(comp_def);
@@ -531,10 +1344,8 @@ struct bl_block_meta_s *bl_block_create(char const *name, bl_comp_def_t const *c
     meta->name = name;
     meta->pin_list = NULL;
     // add metadata to master block list
-    ll_result = ll_insert((void **)(&block_root), (void *)meta, block_meta_compare_names);
-    if ( ll_result != 0 ) {
-        ERROR_RETURN(BL_ERR_NAME_EXISTS);
-    }
+    retval = list_add((void **)(&block_root), (void *)meta, block_meta_compare_names, &block_index);
+    CHECK_RETURN(retval);
     return meta;
 }
 
@@ -617,6 +1428,12 @@ bool bl_block_add_function(struct bl_block_meta_s *blk, bl_function_def_t const
     data->funct = def->fp;
     data->block_data = TO_RT_ADDR(blk->data_index);
     data->next = NULL;
+#ifdef EBL_PROFILE
+    bl_profile_clear(&(data->profile), 1);
+#endif
+#ifdef EBL_FUNCTION_ENABLE
+    data->enabled = 1;
+#endif
     // initialise metadata fields
     meta->rtdata_index = TO_RT_INDEX(data);
     meta->nofp = def->nofp;
@@ -806,13 +806,13 @@ static bool is_name(char const * token)
 #pragma GCC optimize ("no-strict-aliasing")
 static bool is_new_name(char const *token)
 {
-    if ( ll_find((void **)(&(block_root)), (void *)(token), bl_block_meta_compare_name_key) ) {
+    if ( bl_block_lookup(token) ) {
         return false;
     }
-    if ( ll_find((void **)(&(signal_root)), (void *)(token), bl_sig_meta_compare_name_key) ) {
+    if ( bl_signal_lookup(token) ) {
         return false;
     }
-    if ( ll_find((void **)(&(thread_root)), (void *)(token), bl_thread_meta_compare_name_key) ) {
+    if ( bl_thread_lookup(token) ) {
         return false;
     }
     return true;
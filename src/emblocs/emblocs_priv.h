@@ -13,6 +13,92 @@
 
 #include <emblocs_api.h>
 #include <emblocs_comp.h>
+#include <emblocs_profile.h>
+
+/**************************************************************
+ * The realtime data structures below hold no pool indexes, so
+ * they come before the pool sizes, which can depend on them.
+ **************************************************************/
+
+/**************************************************************
+ * Realtime data for a function.  These structures are created
+ * when the block is created.  Later, when the function is
+ * added to a realtime thread, the 'next' field is used to
+ * link this structure into the list that corresponds to the
+ * thread.  If function enables are supported, the thread
+ * skips the function while 'enabled' is zero.
+ */
+typedef struct bl_function_rtdata_s {
+    bl_rt_function_t *funct;
+    void *block_data;
+    struct bl_function_rtdata_s *next;
+#ifdef EBL_PROFILE
+    bl_profile_t profile;
+#endif
+#ifdef EBL_FUNCTION_ENABLE
+    volatile uint32_t enabled;
+#endif
+} bl_function_rtdata_t;
+
+/**************************************************************
+ * Entry in a thread's dispatch table.  When a thread is
+ * finalized ("sealed"), its linked list of functions is
+ * copied into a packed array of these entries, terminated
+ * by an entry with a NULL 'funct'.  bl_thread_run() then
+ * walks contiguous memory instead of chasing 'next' pointers
+ * scattered across the RT pool.  The enable flag stays in the
+ * function's realtime data, so that switching a function on
+ * or off never needs a table rebuild.
+ */
+typedef struct bl_dispatch_entry_s {
+    bl_rt_function_t *funct;
+    void *block_data;
+#ifdef EBL_PROFILE
+    bl_profile_t *profile;
+#endif
+#ifdef EBL_FUNCTION_ENABLE
+    uint32_t const volatile *enabled;
+#endif
+} bl_dispatch_entry_t;
+
+/**************************************************************
+ * Realtime data needed for a thread.  'start' is the linked
+ * list of functions and is always maintained.  'table' is
+ * NULL until the thread is finalized; after that every link
+ * or unlink rebuilds the table.  Rebuilding is done in the
+ * 'spare' table, then the two are swapped, so a running
+ * thread never sees a partially built table.  'walking' is
+ * the table bl_thread_run() is walking, or NULL between
+ * runs; a spare that is still being walked is not rebuilt,
+ * the rebuild fails with BL_ERR_BUSY instead.  A spare too
+ * small for a rebuild after the thread is sealed is replaced
+ * by one with headroom, so that both tables soon stay big
+ * enough.  Sizes are in entries, not counting the
+ * terminator.  If profiling is enabled, a non-zero
+ * 'profile_reset' tells bl_thread_run() to clear the
+ * profile data of every function in the thread.  If
+ * thread statistics are enabled, they are in 'stats'.  If
+ * batches are enabled, 'batch' is a committed batch that
+ * bl_thread_run() must apply before calling any functions.
+ */
+typedef struct bl_thread_data_s {
+    uint32_t period_ns;
+    struct bl_function_rtdata_s *start;
+    struct bl_dispatch_entry_s * volatile table;
+    struct bl_dispatch_entry_s *spare;
+    struct bl_dispatch_entry_s const * volatile walking;
+    uint16_t table_size;
+    uint16_t spare_size;
+#ifdef EBL_PROFILE
+    uint32_t profile_reset;
+#endif
+#ifdef EBL_THREAD_STATS
+    bl_thread_stats_t stats;
+#endif
+#ifdef EBL_BATCH
+    struct bl_batch_s * volatile batch;
+#endif
+} bl_thread_data_t;
 
 /**************************************************************
  * Realtime data and object metadata are stored in separate
@@ -23,6 +109,46 @@
  * they can be stored in a 10 bit field.
  */
 
+/* Sizes of the metadata structures below, which can't use sizeof()
+ * here since their bitfields depend on the pool sizes.  Each is
+ * checked after its definition. */
+#define BL_BLOCK_META_SIZE      (6*4)
+#define BL_PIN_META_SIZE        (3*4)
+#define BL_FUNCTION_META_SIZE   (3*4)
+#define BL_SIGNAL_META_SIZE     (3*4)
+#define BL_THREAD_META_SIZE     (3*4)
+
+/* With EBL_POOL_HEADER, blocs_compiler.py has counted what the
+ * system takes from the pools, and the sizes are exact for it.
+ * BL_RT_POOL_SPARE and BL_META_POOL_SPARE add room for anything
+ * built later, such as batches. */
+#ifdef EBL_POOL_HEADER
+#include EBL_POOL_HEADER
+#ifndef BL_RT_POOL_SPARE
+#define BL_RT_POOL_SPARE    (0)
+#endif
+#ifndef BL_META_POOL_SPARE
+#define BL_META_POOL_SPARE  (0)
+#endif
+#ifdef EBL_NAME_INDEX
+#define BL_POOL_INDEX_BYTES (BL_POOL_INDEX_SLOTS*sizeof(void *))
+#else
+#define BL_POOL_INDEX_BYTES (0)
+#endif
+#define BL_RT_POOL_SIZE     (BL_POOL_BLOCK_DATA + \
+                             (BL_POOL_PINS+BL_POOL_SIGNALS+BL_POOL_LAYOUT_SIGNALS)*sizeof(bl_sig_data_t) + \
+                             BL_POOL_FUNCTIONS*sizeof(bl_function_rtdata_t) + \
+                             BL_POOL_THREADS*sizeof(bl_thread_data_t) + \
+                             BL_POOL_TABLE_ENTRIES*sizeof(bl_dispatch_entry_t) + \
+                             BL_RT_POOL_SPARE)
+#define BL_META_POOL_SIZE   (BL_POOL_BLOCKS*BL_BLOCK_META_SIZE + \
+                             BL_POOL_PINS*BL_PIN_META_SIZE + \
+                             BL_POOL_FUNCTIONS*BL_FUNCTION_META_SIZE + \
+                             BL_POOL_SIGNALS*BL_SIGNAL_META_SIZE + \
+                             BL_POOL_THREADS*BL_THREAD_META_SIZE + \
+                             BL_POOL_INDEX_BYTES + BL_META_POOL_SPARE)
+#endif
+
 /* default sizes if not defined elsewhere */
 #ifndef BL_RT_POOL_SIZE
 #define BL_RT_POOL_SIZE     (2048)
@@ -39,12 +165,26 @@
 #define BL_META_INDEX_BITS  (BITS2STORE(BL_META_MAX_INDEX))
 
 /* the memory pools */
+#ifdef EBL_STATIC_META
+/* With static metadata, blocs_compiler.py generates the pools:
+ * the system's realtime data, as one struct, and its metadata,
+ * as another, const, in flash.  Pool indexes are offsets into
+ * them, and nothing more can be allocated. */
+#ifdef EBL_NAME_INDEX
+#error "EBL_NAME_INDEX is built at run time in the meta pool, so it can't be used with EBL_STATIC_META"
+#endif
+extern struct bl_static_rt_s bl_static_rt;
+extern struct bl_static_meta_s const bl_static_meta;
+#define bl_rt_pool          ((uint32_t *)&bl_static_rt)
+#define bl_meta_pool        ((uint32_t *)&bl_static_meta)
+#else
 extern uint32_t bl_rt_pool[];
+extern uint32_t bl_meta_pool[];
+#endif
 extern uint32_t *bl_rt_pool_next;
 extern uint32_t bl_rt_pool_avail;
 extern const uint32_t bl_rt_pool_size;
 
-extern uint32_t bl_meta_pool[];
 extern uint32_t *bl_meta_pool_next;
 extern uint32_t bl_meta_pool_avail;
 extern const uint32_t bl_meta_pool_size;
@@ -94,6 +234,7 @@ typedef struct bl_block_meta_s {
 
 /* Verify that bitfields fit in one uint32_t */
 _Static_assert((BL_RT_INDEX_BITS+BL_BLOCK_DATA_SIZE_BITS) <= 32, "block bitfields too big");
+_Static_assert(sizeof(bl_block_meta_t) == BL_BLOCK_META_SIZE, "BL_BLOCK_META_SIZE is wrong");
 
 /**************************************************************
  * Data structure that describes a pin.  Each block has a
@@ -112,6 +253,7 @@ typedef struct bl_pin_meta_s {
 
 /* Verify that bitfields fit in one uint32_t */
 _Static_assert((BL_RT_INDEX_BITS*2+BL_TYPE_BITS+BL_DIR_BITS) <= 32, "pin bitfields too big");
+_Static_assert(sizeof(bl_pin_meta_t) == BL_PIN_META_SIZE, "BL_PIN_META_SIZE is wrong");
 
 /**************************************************************
  * Data structure that describes a function.  Each block
@@ -133,19 +275,7 @@ _Static_assert((BL_RT_INDEX_BITS*2+BL_TYPE_BITS+BL_DIR_BITS) <= 32, "pin bitfiel
 
 /* Verify that bitfields fit in one uint32_t */
 _Static_assert((BL_RT_INDEX_BITS+BL_NOFP_BITS+BL_META_INDEX_BITS) <= 32, "function bitfields too big");
-
-/**************************************************************
- * Realtime data for a function.  These structures are created
- * when the block is created.  Later, when the function is
- * added to a realtime thread, the 'next' field is used to
- * link this structure into the list that corresponds to the
- * thread.
- */
-typedef struct bl_function_rtdata_s {
-    bl_rt_function_t *funct;
-    void *block_data;
-    struct bl_function_rtdata_s *next;
-} bl_function_rtdata_t;
+_Static_assert(sizeof(bl_function_meta_t) == BL_FUNCTION_META_SIZE, "BL_FUNCTION_META_SIZE is wrong");
 
 /**************************************************************
  * Data structure that describes a signal.  There is one list
@@ -162,6 +292,7 @@ typedef struct bl_signal_meta_s {
 
 /* Verify that bitfields fit in one uint32_t */
 _Static_assert((BL_RT_INDEX_BITS+BL_TYPE_BITS) <= 32, "sig bitfields too big");
+_Static_assert(sizeof(bl_signal_meta_t) == BL_SIGNAL_META_SIZE, "BL_SIGNAL_META_SIZE is wrong");
 
 /**************************************************************
  * Data structure that describes a thread.  There is one list
@@ -178,12 +309,45 @@ typedef struct bl_thread_meta_s {
 
 /* Verify that bitfields fit in one uint32_t */
 _Static_assert((BL_RT_INDEX_BITS+BL_NOFP_BITS) <= 32, "thread bitfields too big");
+_Static_assert(sizeof(bl_thread_meta_t) == BL_THREAD_META_SIZE, "BL_THREAD_META_SIZE is wrong");
 
-/* realtime data needed for a thread */
-typedef struct bl_thread_data_s {
-    uint32_t period_ns;
-    struct bl_function_rtdata_s *start;
-} bl_thread_data_t;
+#ifdef EBL_BATCH
+/**************************************************************
+ * A reconfiguration batch, in the RT pool.  Each operation
+ * writes one word; the thread runs through them in order,
+ * so a later operation sees the results of earlier ones.
+ * Function links and unlinks are done on the function list
+ * by bl_batch_commit(), which then builds the new dispatch
+ * table in the spare; the thread only swaps the tables.
+ */
+typedef enum {
+    BL_BATCH_OP_WORD,       // write 'value.u' to 'dest'
+    BL_BATCH_OP_PTR,        // write 'value.p' to 'dest'
+    BL_BATCH_OP_COPY,       // copy the word at 'value.src' to 'dest'
+    BL_BATCH_OP_LINK,       // link function 'dest' to the thread
+    BL_BATCH_OP_UNLINK      // unlink function 'dest' from the thread
+} bl_batch_op_kind_t;
+
+typedef struct bl_batch_op_s {
+    uint32_t kind;
+    void *dest;
+    union {
+        uint32_t u;
+        void *p;
+        void const *src;
+    } value;
+} bl_batch_op_t;
+
+typedef struct bl_batch_s {
+    struct bl_thread_meta_s const *thread;
+    struct bl_thread_data_s *thread_data;
+    volatile uint32_t status;   // a bl_batch_status_t
+    uint16_t op_count;
+    uint16_t max_ops;
+    uint32_t swap_tables;
+    bl_batch_op_t ops[];
+} bl_batch_t;
+#endif
 
 /* root of block linked list */
 extern bl_block_meta_t *block_root;
@@ -207,4 +371,16 @@ int bl_thread_meta_compare_name_key(void *node, void *key);
 int bl_pin_meta_compare_name_key(void *node, void *key);
 int bl_function_meta_compare_name_key(void *node, void *key);
 
+/* Find blocks, signals, and threads by name.  Unlike the
+ * bl_xxx_find() API functions, these return NULL without
+ * setting bl_errno if the name is not found. */
+bl_block_meta_t *bl_block_lookup(char const *name);
+bl_signal_meta_t *bl_signal_lookup(char const *name);
+bl_thread_meta_t *bl_thread_lookup(char const *name);
+
+/* If EBL_NAME_INDEX is defined, the top-level lists are not
+ * kept sorted as nodes are added.  This sorts them; anything
+ * that cares about list order must call it first. */
+void bl_sort_metadata(void);
+
 #endif // EMBLOCS_PRIV_H
@@ -0,0 +1,49 @@
+/***************************************************************
+ *
+ * emblocs_profile.c - profiling and thread statistics for EMBLOCS
+ *
+ * Most of the profiling code is inline, in emblocs_profile.h.
+ * This file has the parts that are not time critical.
+ *
+ **************************************************************/
+
+#include <emblocs_profile.h>
+
+#ifdef EBL_THREAD_STATS
+
+/* histogram edges, in percent of the thread period */
+static uint16_t const hist_edges_pct[] = { EBL_THREAD_HIST_EDGES };
+
+_Static_assert((sizeof(hist_edges_pct)/sizeof(hist_edges_pct[0]) == EBL_THREAD_HIST_EDGE_COUNT),
+                "EBL_THREAD_HIST_EDGES doesn't match EBL_THREAD_HIST_EDGE_COUNT");
+
+void bl_thread_stats_init(bl_thread_stats_t *stats)
+{
+    uint64_t budget;
+
+    // convert the nominal period to counts
+    budget = ((uint64_t)stats->period_ns * EBL_CYCLE_HZ) / 1000000000u;
+    if ( budget > EBL_CYCLE_MASK ) {
+        // can't measure anything longer than one counter wrap
+        budget = EBL_CYCLE_MASK;
+    }
+    stats->budget = (uint32_t)budget;
+    for ( uint32_t n = 0 ; n < EBL_THREAD_HIST_EDGE_COUNT ; n++ ) {
+        stats->edges[n] = (uint32_t)((budget * hist_edges_pct[n]) / 100);
+        stats->hist[n] = 0;
+    }
+    stats->hist[EBL_THREAD_HIST_EDGE_COUNT] = 0;
+    stats->running = 0;
+    stats->reentries = 0;
+    stats->overruns = 0;
+    stats->runs = 0;
+    stats->start = 0;
+    stats->period = 0;
+    stats->period_min = 0;
+    stats->period_max = 0;
+    stats->exec_time = 0;
+    stats->exec_max = 0;
+    stats->reset = 0;
+}
+
+#endif // EBL_THREAD_STATS
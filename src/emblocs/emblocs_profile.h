@@ -0,0 +1,206 @@
+/***************************************************************
+ *
+ * emblocs_profile.h - profiling and thread statistics for EMBLOCS
+ *
+ * Embedded Block-Oriented Control System
+ *
+ * Two independent features are configured in emblocs_config.h;
+ * both use the cycle counter hooks in target_hooks.h.
+ *
+ * If EBL_PROFILE is defined in emblocs_config.h, every call
+ * to a thread function is timed with EBL_CYCLE_COUNT() from
+ * target_hooks.h, and the result is accumulated in a
+ * bl_profile_t record for that function.  This applies both
+ * to bl_thread_run() and to the generated thread functions
+ * in <system>.c.
+ *
+ * If EBL_THREAD_STATS is defined, every thread keeps a
+ * bl_thread_stats_t: the actual period between runs, a
+ * histogram of execution time, and counts of overruns and
+ * re-entries.  This is meant to be cheap enough to leave
+ * enabled in production.
+ *
+ * If a feature is not enabled, its macros below expand to
+ * nothing and it costs nothing.
+ *
+ * All of this data is plain memory, so the monitor can read
+ * it directly.  Each thread also has reset flags; writing a
+ * non-zero value to one (from the monitor, or by calling a
+ * reset function) makes the thread clear that data the next
+ * time it runs.  Clearing in the thread itself means the data
+ * is never half-reset while being updated.
+ *
+ **************************************************************/
+
+#ifndef EMBLOCS_PROFILE_H
+#define EMBLOCS_PROFILE_H
+
+#include <emblocs_common.h>
+
+/**************************************************************
+ * Profile data for one function.  All times are in counts of
+ * EBL_CYCLE_COUNT().  The mean is 'total' divided by 'calls';
+ * it is left to the reader so the realtime code doesn't have
+ * to divide.  An all-zero record is a valid reset state.
+ */
+typedef struct bl_profile_s {
+    uint32_t last;      // time used by the most recent call
+    uint32_t min;       // minimum time since reset
+    uint32_t max;       // maximum time since reset
+    uint32_t calls;     // number of calls since reset
+    uint64_t total;     // sum of all times since reset
+} bl_profile_t;
+
+#ifdef EBL_PROFILE
+
+#include <target_hooks.h>
+
+static inline void bl_profile_record(bl_profile_t *prof, uint32_t time)
+{
+    prof->last = time;
+    if ( ( time < prof->min ) || ( prof->calls == 0 ) ) {
+        prof->min = time;
+    }
+    if ( time > prof->max ) {
+        prof->max = time;
+    }
+    prof->calls++;
+    prof->total += time;
+}
+
+static inline void bl_profile_clear(bl_profile_t *prof, uint32_t count)
+{
+    while ( count-- > 0 ) {
+        prof->last = 0;
+        prof->min = 0;
+        prof->max = 0;
+        prof->calls = 0;
+        prof->total = 0;
+        prof++;
+    }
+}
+
+/* Used by the generated thread functions.  BL_PROFILE_BEGIN()
+ * goes at the top of the thread, and BL_PROFILE_MARK() after
+ * each function call.  The counter is read again after each
+ * record is updated, so the bookkeeping isn't charged to the
+ * next function. */
+#define BL_PROFILE_BEGIN(profs, count, reset)                   \
+    uint32_t _bl_prof_start;                                    \
+    if ( reset ) {                                              \
+        bl_profile_clear(profs, count);                         \
+        reset = 0;                                              \
+    }                                                           \
+    _bl_prof_start = EBL_CYCLE_COUNT()
+
+#define BL_PROFILE_MARK(prof)                                   \
+    bl_profile_record(&(prof), (EBL_CYCLE_COUNT() - _bl_prof_start) & EBL_CYCLE_MASK); \
+    _bl_prof_start = EBL_CYCLE_COUNT()
+
+#else
+
+#define BL_PROFILE_BEGIN(profs, count, reset)
+#define BL_PROFILE_MARK(prof)
+
+#endif // EBL_PROFILE
+
+/**************************************************************
+ * Statistics for one thread.  Times are in counts of
+ * EBL_CYCLE_COUNT().  'period_ns' is the nominal period; when
+ * the stats are reset it is converted to counts ('budget')
+ * and used to scale the histogram edges, which are set in
+ * emblocs_config.h as percentages of the period.  A run that
+ * takes longer than 'budget' is an overrun.  hist[n] counts
+ * runs shorter than edges[n]; the last bucket counts the rest.
+ * A static initializer only needs to set 'reset' to 1 and
+ * 'period_ns'; the thread does the rest on its first run.
+ */
+#ifndef EBL_THREAD_HIST_EDGE_COUNT
+#define EBL_THREAD_HIST_EDGE_COUNT  (5)
+#define EBL_THREAD_HIST_EDGES       25, 50, 75, 90, 100
+#endif
+
+typedef struct bl_thread_stats_s {
+    volatile uint32_t reset;    // non-zero requests a reset
+    uint32_t period_ns;         // nominal thread period
+    uint32_t budget;            // nominal thread period in counts
+    uint32_t running;           // number of runs in progress
+    uint32_t reentries;         // runs started while one was in progress
+    uint32_t overruns;          // runs that took longer than 'budget'
+    uint32_t runs;              // completed runs since reset
+    uint32_t start;             // counter value at start of last run
+    uint32_t period;            // actual time between the last two starts
+    uint32_t period_min;
+    uint32_t period_max;
+    uint32_t exec_time;         // time used by the last run
+    uint32_t exec_max;
+    uint32_t edges[EBL_THREAD_HIST_EDGE_COUNT];
+    uint32_t hist[EBL_THREAD_HIST_EDGE_COUNT+1];
+} bl_thread_stats_t;
+
+#ifdef EBL_THREAD_STATS
+
+#include <target_hooks.h>
+
+/* Clears the stats and recomputes 'budget' and the histogram
+ * edges.  Defined in emblocs_profile.c, since it divides. */
+void bl_thread_stats_init(bl_thread_stats_t *stats);
+
+static inline void bl_thread_stats_begin(bl_thread_stats_t *stats)
+{
+    uint32_t now, period;
+
+    now = EBL_CYCLE_COUNT();
+    if ( stats->reset ) {
+        bl_thread_stats_init(stats);
+    } else if ( stats->runs > 0 ) {
+        period = (now - stats->start) & EBL_CYCLE_MASK;
+        stats->period = period;
+        if ( ( period < stats->period_min ) || ( stats->runs == 1 ) ) {
+            stats->period_min = period;
+        }
+        if ( period > stats->period_max ) {
+            stats->period_max = period;
+        }
+    }
+    if ( stats->running ) {
+        stats->reentries++;
+    }
+    stats->running++;
+    stats->start = now;
+}
+
+static inline void bl_thread_stats_end(bl_thread_stats_t *stats)
+{
+    uint32_t exec, n;
+
+    exec = (EBL_CYCLE_COUNT() - stats->start) & EBL_CYCLE_MASK;
+    stats->exec_time = exec;
+    if ( exec > stats->exec_max ) {
+        stats->exec_max = exec;
+    }
+    if ( exec > stats->budget ) {
+        stats->overruns++;
+    }
+    n = 0;
+    while ( ( n < EBL_THREAD_HIST_EDGE_COUNT ) && ( exec >= stats->edges[n] ) ) {
+        n++;
+    }
+    stats->hist[n]++;
+    stats->runs++;
+    stats->running--;
+}
+
+/* Used by the generated thread functions, at the very top
+ * and very bottom of the thread. */
+#define BL_THREAD_STATS_BEGIN(stats)    bl_thread_stats_begin(&(stats))
+#define BL_THREAD_STATS_END(stats)      bl_thread_stats_end(&(stats))
+
+#else
+
+#define BL_THREAD_STATS_BEGIN(stats)
+#define BL_THREAD_STATS_END(stats)
+
+#endif // EBL_THREAD_STATS
+
+#endif // EMBLOCS_PROFILE_H
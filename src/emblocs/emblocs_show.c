@@ -81,6 +81,7 @@ void bl_show_all_blocks(void)
     int ll_result;
 
     printf("List of all blocks:\n");
+    bl_sort_metadata();
     ll_result = ll_traverse((void **)(&block_root), block_meta_print_node);
     printf("Total of %d blocks\n", ll_result);
 }
@@ -168,6 +169,11 @@ void bl_show_function(bl_function_meta_t const *funct)
         thread = TO_META_ADDR(funct->thread_index);
         printf(" %s", thread->name);
     }
+#ifdef EBL_FUNCTION_ENABLE
+    if ( ! bl_function_is_enabled(funct) ) {
+        printf(" (off)");
+    }
+#endif
     printf("\n");
 #endif
 }
@@ -263,10 +269,39 @@ void bl_show_all_signals(void)
     int ll_result;
 
     printf("List of all signals:\n");
+    bl_sort_metadata();
     ll_result = ll_traverse((void **)(&signal_root), sig_meta_print_node);
     printf("Total of %d signals\n", ll_result);
 }
 
+#ifdef EBL_PROFILE
+static void bl_show_profile(bl_profile_t const *prof)
+{
+    uint32_t mean;
+
+    mean = 0;
+    if ( prof->calls > 0 ) {
+        mean = (uint32_t)(prof->total / prof->calls);
+    }
+    printf("        last %u, min %u, max %u, mean %u, %u calls\n",
+                                prof->last, prof->min, prof->max, mean, prof->calls);
+}
+#endif
+
+#ifdef EBL_THREAD_STATS
+static void bl_show_thread_stats(bl_thread_stats_t const *stats)
+{
+    printf("     %u runs, budget %u, exec %u (max %u), period %u (%u-%u)\n",
+                                stats->runs, stats->budget, stats->exec_time, stats->exec_max,
+                                stats->period, stats->period_min, stats->period_max);
+    printf("     %u overruns, %u re-entries, histogram:", stats->overruns, stats->reentries);
+    for ( uint32_t n = 0 ; n <= EBL_THREAD_HIST_EDGE_COUNT ; n++ ) {
+        printf(" %u", stats->hist[n]);
+    }
+    printf("\n");
+}
+#endif
+
 static void bl_show_function_rtdata(bl_function_rtdata_t const *rtdata)
 {
 #ifdef BL_SHOW_VERBOSE
@@ -277,7 +312,16 @@ static void bl_show_function_rtdata(bl_function_rtdata_t const *rtdata)
 
     blk = bl_find_block_by_data_addr(rtdata->block_data);
     funct = bl_find_function_def_in_block_by_address(rtdata->funct, blk);
-    printf("     %s.%s\n", blk->name, funct->name);
+    printf("     %s.%s", blk->name, funct->name);
+#ifdef EBL_FUNCTION_ENABLE
+    if ( ! rtdata->enabled ) {
+        printf(" (off)");
+    }
+#endif
+    printf("\n");
+#endif
+#ifdef EBL_PROFILE
+    bl_show_profile(&(rtdata->profile));
 #endif
 }
 
@@ -292,6 +336,12 @@ void bl_show_thread(struct bl_thread_meta_s const *thread)
     printf(" thread '%s' @[%d]=%p, no_fp = %d, period_ns = %d, RT data at [%d]=%p\n", thread->name, 
                                 TO_RT_INDEX(thread), thread, thread->nofp, data->period_ns,
                                 thread->data_index, data);
+    if ( data->table != NULL ) {
+        printf("   sealed, table @ [%d]=%p, %d entries\n", TO_RT_INDEX(data->table), data->table, data->table_size);
+    }
+#ifdef EBL_THREAD_STATS
+    bl_show_thread_stats(&(data->stats));
+#endif
     while ( funct_data != NULL ) {
         bl_show_function_rtdata(funct_data);
         funct_data = funct_data->next;
@@ -308,7 +358,11 @@ void bl_show_thread(struct bl_thread_meta_s const *thread)
     } else {
         fp_str = "has fp";
     }
-    printf("  %-12s = %s : %10u nsec\n", thread->name, fp_str, data->period_ns);
+    printf("  %-12s = %s : %10u nsec%s\n", thread->name, fp_str, data->period_ns,
+                                ( data->table != NULL ) ? " (sealed)" : "");
+#ifdef EBL_THREAD_STATS
+    bl_show_thread_stats(&(data->stats));
+#endif
     while ( funct_data != NULL ) {
         bl_show_function_rtdata(funct_data);
         funct_data = funct_data->next;
@@ -326,6 +380,7 @@ void bl_show_all_threads(void)
     int ll_result;
 
     printf("List of all threads:\n");
+    bl_sort_metadata();
     ll_result = ll_traverse((void **)(&thread_root), thread_meta_print_node);
     printf("Total of %d threads\n", ll_result);
 }
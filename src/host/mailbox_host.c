@@ -0,0 +1,208 @@
+/***************************************************************
+ *
+ * mailbox_host.c - cross-core mailbox test for a POSIX host
+ *
+ * Runs a producer and a consumer in two pthreads, standing in
+ * for the two cores of a target, and passes frames between them
+ * through a mailbox (see mailbox.h) as fast as they can go.
+ * Each thread is pinned to its own CPU when the host allows it,
+ * so the frames really do cross between cores.
+ *
+ * Every word of a frame is derived from the frame's sequence
+ * number, so the consumer can check that it never sees a frame
+ * that mixes words from two different puts, that the frames it
+ * takes are always newer than the last one, and that each is at
+ * least as new as the last frame put before the take began (an
+ * 'old' frame).  Frames are expected to be skipped, since the
+ * consumer only takes the newest one.  With a consumer delay, the
+ * consumer spins that many iterations after each take, so that
+ * the producer puts many frames per take, as a fast thread on one
+ * core feeding a slow thread on the other does.
+ *
+ * Before the threads start, the same checks are made on a fixed
+ * sequence, with ten puts per take, some of them while the
+ * consumer is still reading the frame it took.
+ *
+ * Usage: mailbox_host [frames [width [consumer_delay]]]
+ * Prints the results and returns non-zero if any check failed.
+ *
+ **************************************************************/
+
+#define _GNU_SOURCE
+#include <mailbox.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DEFAULT_FRAMES  (1000000u)
+#define DEFAULT_WIDTH   (4u)
+#define MAX_WIDTH       (64u)
+
+static uint32_t frames[MB_SLOTS*MAX_WIDTH];
+static mb_mailbox_t mbox;
+
+static uint32_t frame_count, frame_width, consumer_delay;
+
+/* results; 'put' is read by the consumer */
+static volatile uint32_t put;
+static uint32_t taken, skipped, torn, stale, old;
+
+static uint32_t frame_word(uint32_t seq, uint32_t n)
+{
+    return seq ^ (n * 0x9E3779B9u);
+}
+
+static void put_frame(uint32_t seq)
+{
+    uint32_t *frame;
+
+    frame = mb_put_begin(&mbox);
+    for ( uint32_t n = 0 ; n < frame_width ; n++ ) {
+        frame[n] = frame_word(seq, n);
+    }
+    mb_put_end(&mbox);
+}
+
+/* checks a frame that has been taken; returns its sequence number */
+static uint32_t check_frame(uint32_t const *frame, uint32_t last, uint32_t newest_put)
+{
+    uint32_t seq;
+
+    seq = frame[0];
+    for ( uint32_t n = 1 ; n < frame_width ; n++ ) {
+        if ( frame[n] != frame_word(seq, n) ) {
+            torn++;
+            break;
+        }
+    }
+    if ( seq <= last ) {
+        stale++;
+    }
+    if ( seq < newest_put ) {
+        old++;
+    }
+    return seq;
+}
+
+/* ten puts per take, with the consumer holding its frame over
+   the second half of them; every take must be the newest */
+static void check_sequence(void)
+{
+    uint32_t const *frame;
+    uint32_t seq, last;
+
+    seq = last = 0;
+    for ( uint32_t take = 0 ; take < 100 ; take++ ) {
+        for ( uint32_t n = 0 ; n < 5 ; n++ ) {
+            put_frame(++seq);
+        }
+        frame = mb_get_begin(&mbox);
+        if ( frame == NULL ) {
+            stale++;
+            continue;
+        }
+        // the held frame must survive puts
+        for ( uint32_t n = 0 ; n < 5 ; n++ ) {
+            put_frame(seq + 1 + n);
+        }
+        last = check_frame(frame, last, seq);
+        mb_get_end(&mbox);
+        seq += 5;
+    }
+    frame = mb_get_begin(&mbox);
+    if ( ( frame == NULL ) || ( check_frame(frame, last, seq) != seq ) ) {
+        old++;
+    }
+    mb_get_end(&mbox);
+    if ( mb_get_begin(&mbox) != NULL ) {
+        stale++;
+    }
+}
+
+static void pin_to_cpu(int cpu)
+{
+    cpu_set_t cpus;
+
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    // best effort; a single CPU host still runs the test
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+}
+
+static void *producer(void *arg)
+{
+    (void)arg;
+    pin_to_cpu(0);
+    for ( uint32_t seq = 1 ; seq <= frame_count ; seq++ ) {
+        put_frame(seq);
+        put = seq;
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    uint32_t const *frame;
+    uint32_t seq, last, newest_put;
+
+    (void)arg;
+    pin_to_cpu(1);
+    last = 0;
+    while ( last != frame_count ) {
+        newest_put = put;
+        frame = mb_get_begin(&mbox);
+        if ( frame == NULL ) {
+            // let the producer in if it shares our CPU
+            sched_yield();
+            continue;
+        }
+        seq = check_frame(frame, last, newest_put);
+        mb_get_end(&mbox);
+        if ( seq > last ) {
+            skipped += seq - last - 1;
+        }
+        last = seq;
+        taken++;
+        for ( volatile uint32_t n = 0 ; n < consumer_delay ; n++ ) {
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t prod, cons;
+    struct timespec start, end;
+    double ns;
+
+    frame_count = ( argc > 1 ) ? (uint32_t)strtoul(argv[1], NULL, 0) : DEFAULT_FRAMES;
+    frame_width = ( argc > 2 ) ? (uint32_t)strtoul(argv[2], NULL, 0) : DEFAULT_WIDTH;
+    consumer_delay = ( argc > 3 ) ? (uint32_t)strtoul(argv[3], NULL, 0) : 0;
+    if ( ( frame_count == 0 ) || ( frame_width == 0 ) || ( frame_width > MAX_WIDTH ) ) {
+        printf("mailbox_host: bad arguments\n");
+        return 2;
+    }
+    mbox = (mb_mailbox_t)MB_MAILBOX_INIT(frames, frame_width);
+    check_sequence();
+    printf("sequence: %u torn, %u stale, %u old\n", torn, stale, old);
+    if ( ( torn != 0 ) || ( stale != 0 ) || ( old != 0 ) ) {
+        return 1;
+    }
+    mbox = (mb_mailbox_t)MB_MAILBOX_INIT(frames, frame_width);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_create(&cons, NULL, consumer, NULL);
+    pthread_create(&prod, NULL, producer, NULL);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("mailbox: %u frames of %u words, consumer delay %u\n",
+                frame_count, frame_width, consumer_delay);
+    printf("  put %u, taken %u, skipped %u (%u by the mailbox)\n",
+                put, taken, skipped, mbox.skipped);
+    printf("  %.1f ns per frame put\n", ns / frame_count);
+    printf("  %u torn, %u stale, %u old\n", torn, stale, old);
+    return ( ( torn != 0 ) || ( stale != 0 ) || ( old != 0 ) ) ? 1 : 0;
+}
@@ -28,6 +28,65 @@ int ll_insert(void **root, void *node, ll_funct_cmp_nodes_t funct)
     } while (1);
 }
 
+void ll_push(void **root, void *node)
+{
+    void **n = node;
+
+    *n = *root;
+    *root = node;
+}
+
+void ll_sort(void **root, ll_funct_cmp_nodes_t funct)
+{
+    void *head, *tail, *left, *right, *next;
+    void **p;
+    int run, merges, lcount, rcount;
+
+    head = *root;
+    if ( head == NULL ) {
+        return;
+    }
+    run = 1;
+    // bottom-up: merge pairs of sorted runs of length 'run',
+    // doubling the run length, until only one merge is needed
+    do {
+        left = head;
+        head = NULL;
+        tail = NULL;
+        merges = 0;
+        while ( left != NULL ) {
+            merges++;
+            // split off the right run
+            right = left;
+            lcount = 0;
+            while ( ( right != NULL ) && ( lcount < run ) ) {
+                right = *(void **)right;
+                lcount++;
+            }
+            rcount = run;
+            // merge the two runs
+            while ( ( lcount > 0 ) || ( ( rcount > 0 ) && ( right != NULL ) ) ) {
+                if ( ( lcount > 0 ) && ( ( rcount == 0 ) || ( right == NULL ) || ( funct(left, right) <= 0 ) ) ) {
+                    next = left;
+                    left = *(void **)left;
+                    lcount--;
+                } else {
+                    next = right;
+                    right = *(void **)right;
+                    rcount--;
+                }
+                p = ( tail != NULL ) ? (void **)tail : &head;
+                *p = next;
+                tail = next;
+            }
+            left = right;
+        }
+        *(void **)tail = NULL;
+        run *= 2;
+    } while ( merges > 1 );
+    *root = head;
+}
+
 void *ll_find(void **root, void *key, ll_funct_cmp_node_key_t funct)
 {
     void **p = root;
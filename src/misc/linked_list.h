@@ -47,6 +47,21 @@ typedef void (*ll_funct_process_node_t)(void *node);
  */
 int ll_insert(void **root, void *node, ll_funct_cmp_nodes_t funct);
 
+/**************************************************************
+ * inserts 'node' at the head of the list based at 'root',
+ * without regard to sort order or duplicates.  Use ll_sort
+ * to restore the order later.
+ */
+void ll_push(void **root, void *node);
+
+/**************************************************************
+ * sorts the list based at 'root', using 'funct' to define the
+ * sort order.  This is a merge sort; it takes O(n log n) time
+ * and no extra memory, and nodes with equal keys keep their
+ * relative order.
+ */
+void ll_sort(void **root, ll_funct_cmp_nodes_t funct);
+
 /**************************************************************
  * finds a node that matches 'key' in the list based at
  * 'root', using 'funct' to detect the match.  Returns a
@@ -0,0 +1,73 @@
+#include "mailbox.h"
+#include <target_hooks.h>   // EBL_MEMORY_BARRIER
+
+/* 'latest' packs the number of frames put, which is allowed to
+   wrap, above the slot that holds the newest of them, so that
+   the producer publishes both with one store */
+#define SLOT_BITS       (2u)
+#define SLOT_MASK       ((1u << SLOT_BITS) - 1u)
+
+/* The consumer claims a slot by writing 'reading', then looks at
+   'latest' again; the producer publishes by writing 'latest', then
+   looks at 'reading' before it picks the next slot.  With a full
+   barrier between the write and the read on each side, either the
+   consumer sees that the frame it claimed is no longer the newest,
+   and claims again, or the producer sees the claim and keeps out
+   of that slot until it is released. */
+
+uint32_t *mb_put_begin(mb_mailbox_t *mb)
+{
+    uint32_t newest, reading, slot;
+
+    // our last 'latest' must be visible before we look at the
+    // consumer's claim, and the consumer must be done with a
+    // released slot before we write to it
+    EBL_MEMORY_BARRIER();
+    newest = mb->latest & SLOT_MASK;
+    reading = mb->reading;
+    // one of the three slots is neither the newest nor claimed
+    slot = 0;
+    while ( ( slot == newest ) || ( slot == reading ) ) {
+        slot++;
+    }
+    mb->filling = slot;
+    return mb->frames + slot * mb->width;
+}
+
+void mb_put_end(mb_mailbox_t *mb)
+{
+    uint32_t latest;
+
+    // the frame must be written before the consumer can see it
+    EBL_MEMORY_BARRIER();
+    latest = ( mb->latest & ~SLOT_MASK ) + ( 1u << SLOT_BITS );
+    mb->latest = latest | mb->filling;
+}
+
+uint32_t const *mb_get_begin(mb_mailbox_t *mb)
+{
+    uint32_t latest, claimed;
+
+    latest = mb->latest;
+    if ( latest == mb->taken ) {
+        return NULL;
+    }
+    do {
+        claimed = latest;
+        mb->reading = claimed & SLOT_MASK;
+        // the claim must be visible before we look again
+        EBL_MEMORY_BARRIER();
+        latest = mb->latest;
+    } while ( latest != claimed );
+    mb->skipped += ( ( claimed >> SLOT_BITS ) - ( mb->taken >> SLOT_BITS ) - 1u )
+                        & ( UINT32_MAX >> SLOT_BITS );
+    mb->taken = claimed;
+    return mb->frames + ( claimed & SLOT_MASK ) * mb->width;
+}
+
+void mb_get_end(mb_mailbox_t *mb)
+{
+    // finish reading the frame before the producer can reuse it
+    EBL_MEMORY_BARRIER();
+    mb->reading = MB_SLOTS;
+}
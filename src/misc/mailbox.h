@@ -0,0 +1,66 @@
+/****************************************************************
+ * Single-producer, single-consumer mailbox
+ *
+ *  - Carries fixed size frames of 32-bit words from one execution
+ *    context (the producer) to another (the consumer), typically
+ *    running on different cores
+ *  - Lock-free: neither side ever waits for the other, and no
+ *    critical regions or atomic read-modify-write instructions
+ *    are needed (the Cortex-M0+ has none); each side only writes
+ *    its own variables, and EBL_MEMORY_BARRIER() from
+ *    target_hooks.h orders them against the frame data
+ *  - The frames are a triple buffer: at any time one slot holds
+ *    the newest frame, the consumer may hold one slot while it
+ *    reads, and the producer fills the third; the caller supplies
+ *    the memory, so no heap is needed
+ *  - The consumer always takes the newest frame, however many
+ *    puts there have been since the last take; this suits
+ *    signals, where only the latest value matters, and all the
+ *    words of a frame are always from the same put
+ *  - The producer never has to drop a frame: a frame that is
+ *    replaced before the consumer takes it is counted as skipped
+ *    by the consumer
+ *
+ */
+
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* number of frames in a mailbox */
+#define MB_SLOTS        (3u)
+
+typedef struct mb_mailbox_s {
+    volatile uint32_t latest;   // producer only, frames put << 2 | slot of the newest
+    volatile uint32_t reading;  // consumer only, slot being read, or MB_SLOTS if none
+    uint32_t *frames;           // MB_SLOTS frames of 'width' words
+    uint16_t width;             // words per frame
+    uint16_t filling;           // producer only, slot being filled
+    uint32_t taken;             // consumer only, 'latest' of the frame last taken
+    uint32_t skipped;           // consumer only, frames replaced before they were taken
+} mb_mailbox_t;
+
+/* initializer for a mailbox using 'frames', an array of
+   MB_SLOTS * 'width' words */
+#define MB_MAILBOX_INIT(frames, width) { 0, MB_SLOTS, (frames), (width), 0, 0, 0 }
+
+/**************************************************************
+ * producer side: mb_put_begin() returns a pointer to a frame
+ * to fill in; it never fails.  After filling it, mb_put_end()
+ * makes it the newest frame.
+ */
+uint32_t *mb_put_begin(mb_mailbox_t *mb);
+void mb_put_end(mb_mailbox_t *mb);
+
+/**************************************************************
+ * consumer side: mb_get_begin() returns a pointer to the
+ * newest frame, or NULL if nothing new has been put.  The
+ * frame stays valid until mb_get_end() releases it back to
+ * the producer.
+ */
+uint32_t const *mb_get_begin(mb_mailbox_t *mb);
+void mb_get_end(mb_mailbox_t *mb);
+
+#endif // MAILBOX_H
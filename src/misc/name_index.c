@@ -0,0 +1,84 @@
+#include "name_index.h"
+#include <string.h>
+
+/* FNV-1a, simple and good enough for short identifiers */
+static uint32_t ni_hash(char const *name)
+{
+    uint32_t hash = 2166136261u;
+
+    while ( *name != '\0' ) {
+        hash ^= (uint8_t)(*name++);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static char const *ni_node_name(ni_index_t const *index, void *node)
+{
+    return *(char const **)((char *)node + index->name_offset);
+}
+
+int ni_full(ni_index_t const *index)
+{
+    return ( (index->count + 1) * 4 ) > ( index->size * 3 );
+}
+
+void ni_rehash(ni_index_t *index, void **slots, uint32_t size)
+{
+    void **old_slots = index->slots;
+    uint32_t old_size = index->size;
+
+    for ( uint32_t n = 0 ; n < size ; n++ ) {
+        slots[n] = NULL;
+    }
+    index->slots = slots;
+    index->size = size;
+    index->count = 0;
+    for ( uint32_t n = 0 ; n < old_size ; n++ ) {
+        if ( old_slots[n] != NULL ) {
+            ni_insert(index, old_slots[n]);
+        }
+    }
+}
+
+int ni_insert(ni_index_t *index, void *node)
+{
+    char const *name;
+    uint32_t mask, n;
+
+    if ( index->count >= index->size ) {
+        return -2;
+    }
+    name = ni_node_name(index, node);
+    mask = index->size - 1;
+    n = ni_hash(name) & mask;
+    while ( index->slots[n] != NULL ) {
+        if ( strcmp(ni_node_name(index, index->slots[n]), name) == 0 ) {
+            // duplicate
+            return -1;
+        }
+        n = (n + 1) & mask;
+    }
+    index->slots[n] = node;
+    index->count++;
+    return 0;
+}
+
+void *ni_find(ni_index_t const *index, char const *name)
+{
+    uint32_t mask, n;
+
+    if ( index->size == 0 ) {
+        return NULL;
+    }
+    mask = index->size - 1;
+    n = ni_hash(name) & mask;
+    while ( index->slots[n] != NULL ) {
+        if ( strcmp(ni_node_name(index, index->slots[n]), name) == 0 ) {
+            return index->slots[n];
+        }
+        n = (n + 1) & mask;
+    }
+    // not found
+    return NULL;
+}
@@ -0,0 +1,62 @@
+/****************************************************************
+ * Hash index of named nodes
+ *
+ *  - Nodes are structures that contain a 'char const *name'
+ *    field; the index stores pointers to the nodes, and the
+ *    nodes themselves can live anywhere (for example in a
+ *    linked list, see linked_list.h)
+ *  - The index is an open-addressing hash table with linear
+ *    probing; the caller supplies the memory for the slots,
+ *    so no heap is needed
+ *  - Nodes cannot be removed, only added
+ *  - When the index gets too full, the caller supplies a
+ *    bigger array of slots and the nodes are re-hashed into it
+ *
+ */
+
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct ni_index_s {
+    void **slots;           // array of node pointers, NULL if empty
+    uint32_t size;          // number of slots, a power of 2 (or zero)
+    uint32_t count;         // number of nodes in the index
+    uint32_t name_offset;   // offset of the name pointer in a node
+} ni_index_t;
+
+/* initializer for an empty index of 'type' nodes */
+#define NI_INDEX_INIT(type) { NULL, 0, 0, offsetof(type, name) }
+
+/**************************************************************
+ * returns non-zero if the index must be given more slots
+ * (with ni_rehash) before another node can be inserted.
+ * The index is kept no more than 3/4 full, so that searches
+ * stay short.
+ */
+int ni_full(ni_index_t const *index);
+
+/**************************************************************
+ * moves the index into 'slots', an array of 'size' node
+ * pointers; 'size' must be a power of 2 and big enough for
+ * the nodes already in the index.  The old slots are no
+ * longer used.
+ */
+void ni_rehash(ni_index_t *index, void **slots, uint32_t size);
+
+/**************************************************************
+ * inserts 'node' into the index.  Returns zero on success, -1
+ * if a node with the same name is already in the index, or -2
+ * if the index is full.
+ */
+int ni_insert(ni_index_t *index, void *node);
+
+/**************************************************************
+ * finds the node with 'name'.  Returns a pointer to the node,
+ * or NULL if there is no such node.
+ */
+void *ni_find(ni_index_t const *index, char const *name);
+
+#endif // NAME_INDEX_H
@@ -75,6 +75,24 @@
  */
 
 
+ /********************************************************************
+ *
+ * Memory barrier
+ *
+ * Critical regions only protect against interrupts on the same
+ * core.  Data shared between cores (see mailbox.h) is protected
+ * by ordering the writes instead; EBL_MEMORY_BARRIER() must make
+ * every memory access before it visible to the other core before
+ * any access after it, and must also stop the compiler from
+ * moving accesses across it.  The GCC builtin below does both on
+ * any target GCC supports (it is a 'dmb' on Cortex-M); the Pico
+ * SDK equivalent is __dmb() from hardware/sync.h.
+ *
+ */
+
+#define EBL_MEMORY_BARRIER()    __sync_synchronize()
+
+
  /********************************************************************
  *
  * Function/Data tags
@@ -92,10 +110,84 @@
 #define EBL_FAST_FUNC
 
 // --- Time-critical data (e.g., CCM/DTCM) ---
+// The RT pool is tagged as a whole.  The generated <system>.c
+// tags the signals and blocks used by threads, and defines them
+// in thread execution order; compile it with -fno-toplevel-reorder
+// to keep that order in memory.  For example, on an STM32F4:
+//      #define EBL_FAST_DATA __attribute__((section(".ccmram")))
 #define EBL_FAST_DATA
 
 // --- Init-only code/data (candidate for reclaiming after startup) ---
 #define EBL_INIT_ONLY_FUNC
 #define EBL_INIT_ONLY_DATA
 
+
+ /********************************************************************
+ *
+ * Cycle counter
+ *
+ * Only required if EBL_PROFILE or EBL_THREAD_STATS is defined
+ * in emblocs_config.h.
+ * EBL_CYCLE_COUNT() must return a uint32_t from a free running
+ * counter that counts up at a constant rate, ideally the CPU
+ * clock.  If the counter is narrower than 32 bits, EBL_CYCLE_MASK
+ * must have a 1 for each bit that it does have, so that the
+ * difference between two readings is correct across a wrap.
+ * EBL_CYCLE_HZ is the rate at which the counter counts; it is
+ * used to convert thread periods into counts.
+ * This stub always returns zero.
+ *
+ */
+
+#define EBL_CYCLE_COUNT()   (0u)
+#define EBL_CYCLE_MASK      (0xFFFFFFFFu)
+#define EBL_CYCLE_HZ        (1000000000u)
+
+/* Sample cycle counter macros
+ *
+ * Cortex-M3/M4/M7 (STM32G431 etc) have a 32 bit cycle counter
+ * in the DWT unit.  It must be enabled once at startup:
+ *
+ *      #include <stm32g4xx.h>
+ *
+ *      CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+ *      DWT->CYCCNT = 0;
+ *      DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+ *
+ *      #define EBL_CYCLE_COUNT()   (DWT->CYCCNT)
+ *      #define EBL_CYCLE_MASK      (0xFFFFFFFFu)
+ *      #define EBL_CYCLE_HZ        (170000000u)
+ *
+ * Cortex-M0+ (RP2040) has no DWT counter, but SysTick can run
+ * from the CPU clock.  It is 24 bits and counts down, so it is
+ * inverted.  It must be started once at startup:
+ *
+ *      #include "hardware/structs/systick.h"
+ *
+ *      systick_hw->rvr = 0x00FFFFFF;
+ *      systick_hw->csr = 0x5;
+ *
+ *      #define EBL_CYCLE_COUNT()   (0x00FFFFFFu - systick_hw->cvr)
+ *      #define EBL_CYCLE_MASK      (0x00FFFFFFu)
+ *      #define EBL_CYCLE_HZ        (125000000u)
+ *
+ * A POSIX host can use clock_gettime(); the counts are then
+ * nanoseconds rather than cycles:
+ *
+ *      #include <time.h>
+ *
+ *      static inline uint32_t ebl_cycle_count(void)
+ *      {
+ *          struct timespec ts;
+ *          clock_gettime(CLOCK_MONOTONIC, &ts);
+ *          return (uint32_t)(ts.tv_sec * 1000000000u + ts.tv_nsec);
+ *      }
+ *
+ *      #define EBL_CYCLE_COUNT()   ebl_cycle_count()
+ *      #define EBL_CYCLE_MASK      (0xFFFFFFFFu)
+ *      #define EBL_CYCLE_HZ        (1000000000u)
+ *
+ * end of sample macros
+ */
+
 #endif // TARGET_HOOKS_H